@@ -48,8 +48,9 @@ namespace benchmark {
         uint64_t lastCycles;
         uint64_t minCycles;
         uint64_t maxCycles;
+        uint64_t itemsPerIteration;
     public:
-        State(std::string _name, double _maxElapsed) : name(_name), maxElapsed(_maxElapsed), count(0) {
+        State(std::string _name, double _maxElapsed) : name(_name), maxElapsed(_maxElapsed), count(0), itemsPerIteration(1) {
             minTime = std::numeric_limits<double>::max();
             maxTime = std::numeric_limits<double>::min();
             minCycles = std::numeric_limits<uint64_t>::max();
@@ -58,6 +59,8 @@ namespace benchmark {
             countMaskInv = 1./(countMask + 1);
         }
         bool KeepRunning();
+        /** Work done per KeepRunning() iteration, e.g. hashes, for the items_per_second column */
+        void SetItemsPerIteration(uint64_t n) { itemsPerIteration = n; }
     };
 
     typedef std::function<void(State&)> BenchFunction;
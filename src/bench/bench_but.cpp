@@ -6,6 +6,7 @@
 
 #include <crypto/sha256.h>
 #include <key.h>
+#include <powalgo.h>
 #include <stacktraces.h>
 #include <validation.h>
 #include <util.h>
@@ -21,6 +22,7 @@ int
 main(int argc, char** argv)
 {
     SHA256AutoDetect();
+    PowAlgorithmsAutoDetect();
 
     RegisterPrettySignalHandlers();
     RegisterPrettyTerminateHander();
@@ -30,6 +30,30 @@ static void DeserializeBlockTest(benchmark::State& state)
     }
 }
 
+// A full HEADERS message worth of headers, which used to pay for a scrypt
+// hash each while being read
+static void DeserializeBlockHeadersTest(benchmark::State& state)
+{
+    CDataStream blockStream((const char*)raw_bench::block813851,
+            (const char*)&raw_bench::block813851[sizeof(raw_bench::block813851)],
+            SER_NETWORK, PROTOCOL_VERSION);
+    CBlock block;
+    blockStream >> block;
+
+    std::vector<CBlockHeader> headers(MAX_HEADERS_RESULTS, block.GetBlockHeader());
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << headers;
+    const size_t nSize = stream.size();
+    char a = '\0';
+    stream.write(&a, 1); // Prevent compaction
+
+    while (state.KeepRunning()) {
+        std::vector<CBlockHeader> result;
+        stream >> result;
+        assert(stream.Rewind(nSize));
+    }
+}
+
 static void DeserializeAndCheckBlockTest(benchmark::State& state)
 {
     CDataStream stream((const char*)raw_bench::block813851,
@@ -51,4 +75,5 @@ static void DeserializeAndCheckBlockTest(benchmark::State& state)
 }
 
 BENCHMARK(DeserializeBlockTest);
+BENCHMARK(DeserializeBlockHeadersTest);
 BENCHMARK(DeserializeAndCheckBlockTest);
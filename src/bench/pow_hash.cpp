@@ -0,0 +1,215 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <hash.h>
+#include <hash_selection.h>
+#include <powalgo.h>
+#include <uint256.h>
+#include <util.h>
+#include <utiltime.h>
+#include <crypto/common.h>
+
+#include <array>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+// Proof of work benchmarks. Every case runs single threaded (_1T) and on one
+// thread per core (_MT), each thread hashing its own input, so that the _MT
+// numbers show how an algorithm scales once threads compete for memory
+// bandwidth and cache with their scratchpads. items_per_second is the total
+// number of hashes per second over all threads.
+
+/** hash(thread, nonce) computes one hash on the given thread */
+typedef std::function<void(int, uint32_t)> ThreadHashFunction;
+
+/** Number of hashes thread 0 does in about a millisecond, so that threads rarely wait on each other */
+static uint32_t HashesPerMillisecond(const ThreadHashFunction& hash)
+{
+    const int64_t nStart = GetTimeMicros();
+    uint32_t n = 0;
+    do {
+        hash(0, n++);
+    } while (GetTimeMicros() - nStart < 1000);
+    return n;
+}
+
+static void RunHashThreads(benchmark::State& state, int nThreads, const ThreadHashFunction& hash)
+{
+    const uint32_t nPerThread = HashesPerMillisecond(hash);
+    state.SetItemsPerIteration((uint64_t)nThreads * nPerThread);
+
+    std::mutex mutex;
+    std::condition_variable cvStart, cvDone;
+    uint64_t nGeneration = 0;
+    int nBusy = 0;
+    bool fStop = false;
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < nThreads; t++) {
+        threads.emplace_back([&, t] {
+            uint64_t nSeen = 0;
+            uint32_t nNonce = 0;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cvStart.wait(lock, [&] { return fStop || nGeneration != nSeen; });
+                    if (fStop)
+                        return;
+                    nSeen = nGeneration;
+                }
+                for (uint32_t i = 0; i < nPerThread; i++)
+                    hash(t, nNonce++);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--nBusy == 0)
+                    cvDone.notify_one();
+            }
+        });
+    }
+
+    uint32_t nNonce = 0;
+    while (state.KeepRunning()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            nGeneration++;
+            nBusy = nThreads - 1;
+        }
+        cvStart.notify_all();
+        for (uint32_t i = 0; i < nPerThread; i++)
+            hash(0, nNonce++);
+        std::unique_lock<std::mutex> lock(mutex);
+        cvDone.wait(lock, [&] { return nBusy == 0; });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fStop = true;
+    }
+    cvStart.notify_all();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+static int MultiThreads()
+{
+    return std::max(GetNumCores(), 1);
+}
+
+/** What one thread hashes, padded so that threads never write to the same cache line */
+struct ThreadInput
+{
+    std::array<unsigned char, 80> header;
+    uint512 input;
+    uint512 output;
+    unsigned char padding[64];
+
+    ThreadInput() : header(), padding() {}
+};
+
+/** Every registered algorithm, hashing a header with a new nonce each time */
+static void PowAlgorithmHash(benchmark::State& state, int algo, int nThreads)
+{
+    const PowHashFunction hashFunc = GetPowAlgorithm(algo)->hash;
+    std::vector<ThreadInput> inputs(nThreads);
+    for (int t = 0; t < nThreads; t++) {
+        for (size_t i = 0; i < inputs[t].header.size(); i++)
+            inputs[t].header[i] = i + t;
+    }
+    RunHashThreads(state, nThreads, [&](int t, uint32_t nNonce) {
+        WriteLE32(inputs[t].header.data() + 76, nNonce);
+        uint256 hash;
+        hashFunc(inputs[t].header.data(), hash);
+    });
+}
+
+/**
+ * GhostRider with its rounds pinned to every core algorithm in order and
+ * CryptoNight Dark, Lite and Turtle, rather than a schedule that depends on
+ * the previous block hash, so that results stay comparable between runs and
+ * between changes to the schedule code.
+ */
+static GhostRiderSchedule FixedGhostRiderSchedule()
+{
+    static const uint8_t CN_ROUNDS[] = {0, 3, 4};
+    GhostRiderSchedule schedule;
+    int nCore = 0, nCN = 0;
+    for (int i = 0; i < GhostRiderSchedule::ROUNDS; i++)
+        schedule.algo[i] = GhostRiderSchedule::IsCryptonightRound(i) ? CN_ROUNDS[nCN++] : nCore++;
+    return schedule;
+}
+
+static void PowGhostRiderFixed(benchmark::State& state, int nThreads)
+{
+    const GhostRiderSchedule schedule = FixedGhostRiderSchedule();
+    std::vector<ThreadInput> inputs(nThreads);
+    RunHashThreads(state, nThreads, [&](int t, uint32_t nNonce) {
+        WriteLE32(inputs[t].header.data() + 76, nNonce);
+        HashGR(inputs[t].header.begin(), inputs[t].header.end(), schedule);
+    });
+}
+
+/** One GhostRider core round, coreHash() over a 64 byte hash */
+static void PowCoreHash(benchmark::State& state, int nSelection, int nThreads)
+{
+    std::vector<ThreadInput> inputs(nThreads);
+    RunHashThreads(state, nThreads, [&](int t, uint32_t nNonce) {
+        WriteLE32(inputs[t].input.begin(), nNonce);
+        coreHash(&inputs[t].input, &inputs[t].output, 64, nSelection);
+    });
+}
+
+/** One GhostRider CryptoNight round, cnHash() over a 64 byte hash */
+static void PowCryptonight(benchmark::State& state, int nVariant, int nThreads)
+{
+    std::vector<ThreadInput> inputs(nThreads);
+    RunHashThreads(state, nThreads, [&](int t, uint32_t nNonce) {
+        WriteLE32(inputs[t].input.begin(), nNonce);
+        cnHash(&inputs[t].input, &inputs[t].output, 64, nVariant);
+    });
+}
+
+static void POW_GHOSTRIDER_FIXED_1T(benchmark::State& state) { PowGhostRiderFixed(state, 1); }
+static void POW_GHOSTRIDER_FIXED_MT(benchmark::State& state) { PowGhostRiderFixed(state, MultiThreads()); }
+BENCHMARK(POW_GHOSTRIDER_FIXED_1T);
+BENCHMARK(POW_GHOSTRIDER_FIXED_MT);
+
+#define POW_BENCHMARKS(name, func, arg) \
+    static void POW_##name##_1T(benchmark::State& state) { func(state, arg, 1); } \
+    static void POW_##name##_MT(benchmark::State& state) { func(state, arg, MultiThreads()); } \
+    BENCHMARK(POW_##name##_1T); \
+    BENCHMARK(POW_##name##_MT);
+
+POW_BENCHMARKS(BUTKSCRYPT, PowAlgorithmHash, ALGO_BUTKSCRYPT)
+POW_BENCHMARKS(SHA256D, PowAlgorithmHash, ALGO_SHA256D)
+POW_BENCHMARKS(LYRA2, PowAlgorithmHash, ALGO_LYRA2)
+POW_BENCHMARKS(GHOSTRIDER, PowAlgorithmHash, ALGO_GHOSTRIDER)
+POW_BENCHMARKS(YESPOWER, PowAlgorithmHash, ALGO_YESPOWER)
+POW_BENCHMARKS(SCRYPT, PowAlgorithmHash, ALGO_SCRYPT)
+
+POW_BENCHMARKS(GR_BLAKE, PowCoreHash, 0)
+POW_BENCHMARKS(GR_BMW, PowCoreHash, 1)
+POW_BENCHMARKS(GR_GROESTL, PowCoreHash, 2)
+POW_BENCHMARKS(GR_JH, PowCoreHash, 3)
+POW_BENCHMARKS(GR_KECCAK, PowCoreHash, 4)
+POW_BENCHMARKS(GR_SKEIN, PowCoreHash, 5)
+POW_BENCHMARKS(GR_LUFFA, PowCoreHash, 6)
+POW_BENCHMARKS(GR_CUBEHASH, PowCoreHash, 7)
+POW_BENCHMARKS(GR_SHAVITE, PowCoreHash, 8)
+POW_BENCHMARKS(GR_SIMD, PowCoreHash, 9)
+POW_BENCHMARKS(GR_ECHO, PowCoreHash, 10)
+POW_BENCHMARKS(GR_HAMSI, PowCoreHash, 11)
+POW_BENCHMARKS(GR_FUGUE, PowCoreHash, 12)
+POW_BENCHMARKS(GR_SHABAL, PowCoreHash, 13)
+POW_BENCHMARKS(GR_WHIRLPOOL, PowCoreHash, 14)
+
+POW_BENCHMARKS(GR_CN_DARK, PowCryptonight, 0)
+POW_BENCHMARKS(GR_CN_DARKLITE, PowCryptonight, 1)
+POW_BENCHMARKS(GR_CN_FAST, PowCryptonight, 2)
+POW_BENCHMARKS(GR_CN_LITE, PowCryptonight, 3)
+POW_BENCHMARKS(GR_CN_TURTLE, PowCryptonight, 4)
+POW_BENCHMARKS(GR_CN_TURTLELITE, PowCryptonight, 5)
@@ -114,8 +114,13 @@ const CBlockIndex* CBlockIndex::GetAncestor(int height) const
 
 void CBlockIndex::BuildSkip()
 {
-    if (pprev)
+    static_assert(ALGO_SCRYPT < NUM_ALGOSV4, "pprevAlgo needs an entry for every algorithm");
+    if (pprev) {
         pskip = pprev->GetAncestor(GetSkipHeight(nHeight));
+        std::copy(pprev->pprevAlgo, pprev->pprevAlgo + NUM_ALGOSV4, pprevAlgo);
+        pprevAlgo[pprev->GetAlgo()] = pprev;
+        pprevSameAlgo = pprevAlgo[GetAlgo()];
+    }
 }
 
 arith_uint256 GetBlockProof(const CBlockIndex& block)
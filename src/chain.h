@@ -12,6 +12,7 @@
 #include <tinyformat.h>
 #include <uint256.h>
 
+#include <algorithm>
 #include <vector>
 
 /**
@@ -179,6 +180,12 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip;
 
+    //! pointer to the closest predecessor mined with the same algorithm as this block
+    CBlockIndex* pprevSameAlgo;
+
+    //! (memory only) pointers to the closest predecessor mined with each algorithm, indexed by algo id
+    CBlockIndex* pprevAlgo[NUM_ALGOSV4];
+
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
@@ -219,11 +226,17 @@ public:
     //! (memory only) Maximum nTime in the chain upto and including this block.
     unsigned int nTimeMax;
 
+    //! Proof of work hash of the header under its algorithm, checked when the header was
+    //! accepted (persisted as CDiskBlockIndex::hashPOWShared). Null if not known.
+    uint256 hashPoW;
+
     void SetNull()
     {
         phashBlock = nullptr;
         pprev = nullptr;
         pskip = nullptr;
+        pprevSameAlgo = nullptr;
+        std::fill(pprevAlgo, pprevAlgo + NUM_ALGOSV4, nullptr);
         nHeight = 0;
         nFile = 0;
         nDataPos = 0;
@@ -234,6 +247,7 @@ public:
         nStatus = 0;
         nSequenceId = 0;
         nTimeMax = 0;
+        hashPoW = uint256();
 
         nVersion       = 0;
         hashMerkleRoot = uint256();
@@ -295,14 +309,28 @@ public:
     }
     uint256 GetBlockPoWHash() const
     {
+        if (!hashPoW.IsNull())
+            return hashPoW;
         CBlockHeader block = GetBlockHeader();
         return block.GetPOWHash(block.GetAlgo());
     }
 
     int GetAlgo() const
     {
-        CBlockHeader block = GetBlockHeader();
-        return block.GetAlgo();
+        return GetAlgoByVersion(nVersion);
+    }
+
+    //! This block if it was mined with algo, else its closest predecessor that was, or nullptr
+    CBlockIndex* GetLastAlgo(int algo)
+    {
+        if (algo < 0 || algo >= NUM_ALGOSV4)
+            return nullptr;
+        return GetAlgo() == algo ? this : pprevAlgo[algo];
+    }
+
+    const CBlockIndex* GetLastAlgo(int algo) const
+    {
+        return const_cast<CBlockIndex*>(this)->GetLastAlgo(algo);
     }
 
     int64_t GetBlockTime() const
@@ -362,7 +390,7 @@ public:
         return false;
     }
 
-    //! Build the skiplist pointer for this entry.
+    //! Build the skiplist and same algorithm pointers for this entry.
     void BuildSkip();
 
     //! Efficiently find an ancestor of this block.
@@ -396,7 +424,7 @@ public:
     explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
         hashBlockShared = pindex->GetBlockHash();
-        hashPOWShared = uint256();
+        hashPOWShared = pindex->hashPoW;
     }
 
     ADD_SERIALIZE_METHODS;
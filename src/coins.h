@@ -12,11 +12,13 @@
 #include <hash.h>
 #include <memusage.h>
 #include <serialize.h>
+#include <support/allocators/pool.h>
 #include <uint256.h>
 
 #include <assert.h>
 #include <stdint.h>
 
+#include <functional>
 #include <unordered_map>
 
 /**
@@ -119,7 +121,18 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * The nodes of CCoinsMap come from a PoolResource instead of one malloc call
+ * each. A node holds the key and entry plus the implementation defined
+ * bookkeeping of std::unordered_map (a next pointer and, with libstdc++, the
+ * cached hash), so blocks of up to four pointers more than the pair are
+ * served from the pool; anything larger, like the bucket array, is not.
+ */
+typedef PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>,
+                      sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4> CCoinsMapAllocator;
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CCoinsMapAllocator> CCoinsMap;
+/** The pool a CCoinsMap allocates from; it has to outlive the map */
+typedef CCoinsMapAllocator::ResourceType CCoinsMapMemoryResource;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -206,6 +219,8 @@ protected:
      * declared as "const".  
      */
     mutable uint256 hashBlock;
+    /* Declared before cacheCoins, which allocates its nodes from it. */
+    mutable CCoinsMapMemoryResource cacheCoinsMemoryResource;
     mutable CCoinsMap cacheCoins;
 
     /* Cached dynamic memory usage for the inner Coin objects. */
@@ -231,6 +246,19 @@ public:
      */
     bool HaveCoinInCache(const COutPoint &outpoint) const;
 
+    /**
+     * Check if the cache has an entry for the given outpoint, also one for a
+     * spent coin, so that looking it up makes no call to the backing CCoinsView.
+     */
+    bool HaveEntryInCache(const COutPoint &outpoint) const;
+
+    /**
+     * Cache a coin that was read from the backing CCoinsView elsewhere, the way
+     * FetchCoin would have. Nothing happens if the outpoint already has an entry
+     * or if the coin is spent, i.e. the backing view did not have it.
+     */
+    void CacheFetchedCoin(const COutPoint &outpoint, Coin&& coin);
+
     /**
      * Return a reference to Coin in the cache, or a pruned one if not found. This is
      * more efficient than GetCoin.
@@ -291,6 +319,12 @@ public:
 private:
     CCoinsMap::iterator FetchCoin(const COutPoint &outpoint) const;
 
+    /**
+     * Give the memory of the empty cache back to the system. Clearing the map
+     * keeps its buckets and leaves its nodes on the free lists of the pool.
+     */
+    void ReallocateCache();
+
     /**
      * By making the copy constructor private, we prevent accidentally using it when one intends to create a cache on top of a base cache.
      */
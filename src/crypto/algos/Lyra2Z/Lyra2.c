@@ -23,6 +23,59 @@
 #include <time.h>
 #include "Lyra2.h"
 #include "Sponge.h"
+#include "crypto/pow_scratch.h"
+
+/**
+ * Memory matrix and row pointers reused by every LYRA2() call on a thread, so
+ * that hashing does not go through the allocator (same model as yespower_tls()).
+ * It only ever grows, and is freed when the thread exits; the matrix comes from
+ * pow_scratch_alloc() so that its random row accesses in the wandering phase
+ * hit huge pages where available.
+ */
+typedef struct {
+    pow_scratch_t memory;
+    uint64_t *matrix;
+    size_t matrixSize;
+    uint64_t **rows;
+    uint64_t nRows;
+} Lyra2Workspace;
+
+static __thread Lyra2Workspace lyra2_tls_workspace;
+
+static void FreeWorkspace(void)
+{
+    Lyra2Workspace *workspace = &lyra2_tls_workspace;
+    pow_scratch_free(&workspace->memory);
+    free(workspace->rows);
+    memset(workspace, 0, sizeof(*workspace));
+}
+
+static int ReserveWorkspace(Lyra2Workspace *workspace, size_t matrixSize, uint64_t nRows)
+{
+    if (workspace->matrixSize == 0 && workspace->nRows == 0) {
+        pow_scratch_at_thread_exit(FreeWorkspace);
+    }
+    if (workspace->matrixSize < matrixSize) {
+        pow_scratch_t memory;
+        if (pow_scratch_alloc(&memory, matrixSize)) {
+            return 0;
+        }
+        pow_scratch_free(&workspace->memory);
+        workspace->memory = memory;
+        workspace->matrix = (uint64_t*) memory.aligned;
+        workspace->matrixSize = matrixSize;
+    }
+    if (workspace->nRows < nRows) {
+        uint64_t **rows = malloc(nRows * sizeof (uint64_t*));
+        if (rows == NULL) {
+            return 0;
+        }
+        free(workspace->rows);
+        workspace->rows = rows;
+        workspace->nRows = nRows;
+    }
+    return 1;
+}
 
 /**
  * Executes Lyra2 based on the G function from Blake2b. This version supports salts and passwords
@@ -57,24 +110,18 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
     //==========================================================================/
 
     //========== Initializing the Memory Matrix and pointers to it =============//
-    //Tries to allocate enough space for the whole memory matrix
-
-
+    //The matrix lives in this thread's workspace. It is not cleared: every row is
+    //written before it is first read, except for the input blocks cleared below.
     const int64_t ROW_LEN_INT64 = BLOCK_LEN_INT64 * nCols;
     const int64_t ROW_LEN_BYTES = ROW_LEN_INT64 * 8;
 
-    i = (int64_t) ((int64_t) nRows * (int64_t) ROW_LEN_BYTES);
-    uint64_t *wholeMatrix = malloc(i);
-    if (wholeMatrix == NULL) {
+    Lyra2Workspace *workspace = &lyra2_tls_workspace;
+    if (!ReserveWorkspace(workspace, (size_t) nRows * (size_t) ROW_LEN_BYTES, nRows)) {
       return -1;
     }
-    memset(wholeMatrix, 0, i);
+    uint64_t *wholeMatrix = workspace->matrix;
+    uint64_t **memMatrix = workspace->rows;
 
-    //Allocates pointers to each row of the matrix
-    uint64_t **memMatrix = malloc(nRows * sizeof (uint64_t*));
-    if (memMatrix == NULL) {
-      return -1;
-    }
     //Places the pointers in the correct positions
     uint64_t *ptrWord = wholeMatrix;
     for (i = 0; i < nRows; i++) {
@@ -123,10 +170,7 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
 
     //======================= Initializing the Sponge State ====================//
     //Sponge state: 16 uint64_t, BLOCK_LEN_INT64 words of them for the bitrate (b) and the remainder for the capacity (c)
-    uint64_t *state = malloc(16 * sizeof (uint64_t));
-    if (state == NULL) {
-      return -1;
-    }
+    ALIGN uint64_t state[16];
     initState(state);
     //==========================================================================/
 
@@ -139,12 +183,12 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
     }
 
     //Initializes M[0] and M[1]
-    reducedSqueezeRow0(state, memMatrix[0], nCols); //The locally copied password is most likely overwritten here
-    reducedDuplexRow1(state, memMatrix[0], memMatrix[1], nCols);
+    spongeRowOps.squeezeRow0(state, memMatrix[0], nCols); //The locally copied password is most likely overwritten here
+    spongeRowOps.duplexRow1(state, memMatrix[0], memMatrix[1], nCols);
 
     do {
       //M[row] = rand; //M[row*] = M[row*] XOR rotW(rand)
-      reducedDuplexRowSetup(state, memMatrix[prev], memMatrix[rowa], memMatrix[row], nCols);
+      spongeRowOps.duplexRowSetup(state, memMatrix[prev], memMatrix[rowa], memMatrix[row], nCols);
 
 
       //updates the value of row* (deterministically picked during Setup))
@@ -177,7 +221,7 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
         //------------------------------------------------------------------------------------------
 
         //Performs a reduced-round duplexing operation over M[row*] XOR M[prev], updating both M[row*] and M[row]
-        reducedDuplexRow(state, memMatrix[prev], memMatrix[rowa], memMatrix[row], nCols);
+        spongeRowOps.duplexRow(state, memMatrix[prev], memMatrix[rowa], memMatrix[row], nCols);
 
         //update prev: it now points to the last row ever computed
         prev = row;
@@ -200,14 +244,8 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
     squeeze(state, K, kLen);
     //==========================================================================/
 
-    //========================= Freeing the memory =============================//
-    free(memMatrix);
-    free(wholeMatrix);
-
-    //Wiping out the sponge's internal state before freeing it
+    //Wiping out the sponge's internal state
     memset(state, 0, 16 * sizeof (uint64_t));
-    free(state);
-    //==========================================================================/
 
     return 0;
 }
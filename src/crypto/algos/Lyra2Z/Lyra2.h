@@ -43,6 +43,13 @@ extern "C" {
 
     int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols);
 
+    /**
+     * Select the fastest sponge row operations the CPU supports (AVX2, SSE2 or
+     * portable C) after checking them against the portable ones. Call once at
+     * startup, before any hashing threads run. Returns a description for the log.
+     */
+    const char* lyra2_detect_sponge(void);
+
 #ifdef __cplusplus
 }
 
@@ -18,12 +18,20 @@
  * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#if defined(HAVE_CONFIG_H)
+#include <config/but-config.h>
+#endif
+
 #include <string.h>
 #include <stdio.h>
 #include <time.h>
 #include "Sponge.h"
 #include "Lyra2.h"
 
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+#include <cpuid.h>
+#endif
+
 
 
 /**
@@ -743,3 +751,66 @@ void printArray(unsigned char *array, unsigned int size, char *name) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
+
+SpongeRowOps spongeRowOps = {reducedSqueezeRow0, reducedDuplexRow1, reducedDuplexRowSetup, reducedDuplexRow};
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+/** AVX2 support by the CPU and the OS (ymm state saved on context switches) */
+static int HaveAVX2(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int xcr0_lo, xcr0_hi;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+    if (!((ecx >> 27) & 1) || !((ecx >> 28) & 1)) // OSXSAVE, AVX
+        return 0;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 0x06) != 0x06)
+        return 0;
+    if (__get_cpuid_max(0, NULL) < 7)
+        return 0;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx >> 5) & 1;
+}
+#endif
+
+#if defined(__SSE2__) || (defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL))
+/** Check that the given row operations agree with the portable ones. */
+static int SelfTest(const SpongeRowOps* ops)
+{
+    static const SpongeRowOps portable = {reducedSqueezeRow0, reducedDuplexRow1, reducedDuplexRowSetup, reducedDuplexRow};
+    const SpongeRowOps selected = spongeRowOps;
+    unsigned char input[80];
+    unsigned char expected[32];
+    unsigned char result[32];
+    int i;
+    for (i = 0; i < 80; i++)
+        input[i] = (unsigned char)(i * 7 + 3);
+
+    spongeRowOps = portable;
+    LYRA2(expected, 32, input, 80, input, 80, 2, 16, 16);
+    spongeRowOps = *ops;
+    LYRA2(result, 32, input, 80, input, 80, 2, 16, 16);
+    spongeRowOps = selected;
+    return memcmp(expected, result, sizeof(expected)) == 0;
+}
+#endif
+
+const char* lyra2_detect_sponge(void)
+{
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    static const SpongeRowOps avx2 = {reducedSqueezeRow0_avx2, reducedDuplexRow1_avx2, reducedDuplexRowSetup_avx2, reducedDuplexRow_avx2};
+    if (HaveAVX2() && SelfTest(&avx2)) {
+        spongeRowOps = avx2;
+        return "avx2";
+    }
+#endif
+#if defined(__SSE2__)
+    static const SpongeRowOps sse2 = {reducedSqueezeRow0_sse2, reducedDuplexRow1_sse2, reducedDuplexRowSetup_sse2, reducedDuplexRow_sse2};
+    if (SelfTest(&sse2)) {
+        spongeRowOps = sse2;
+        return "sse2";
+    }
+#endif
+    return "generic";
+}
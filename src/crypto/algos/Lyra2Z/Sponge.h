@@ -92,6 +92,27 @@ void reducedDuplexRow(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint
 //---- Misc
 void printArray(unsigned char *array, unsigned int size, char *name);
 
+//---- Row operations with the sponge state kept in SIMD registers (Sponge_sse2.c, Sponge_avx2.c)
+void reducedSqueezeRow0_sse2(uint64_t* state, uint64_t* rowOut, uint64_t nCols);
+void reducedDuplexRow1_sse2(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols);
+void reducedDuplexRowSetup_sse2(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+void reducedDuplexRow_sse2(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+
+void reducedSqueezeRow0_avx2(uint64_t* state, uint64_t* rowOut, uint64_t nCols);
+void reducedDuplexRow1_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols);
+void reducedDuplexRowSetup_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+void reducedDuplexRow_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+
+//---- The row operations LYRA2() uses; portable C until lyra2_detect_sponge() picks a SIMD version
+typedef struct {
+    void (*squeezeRow0)(uint64_t* state, uint64_t* rowOut, uint64_t nCols);
+    void (*duplexRow1)(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols);
+    void (*duplexRowSetup)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+    void (*duplexRow)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+} SpongeRowOps;
+
+extern SpongeRowOps spongeRowOps;
+
 ////////////////////////////////////////////////////////////////////////////////////////////////
 
 
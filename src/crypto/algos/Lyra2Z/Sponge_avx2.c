@@ -0,0 +1,175 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// AVX2 versions of the reduced-round Lyra2 row operations in Sponge.c. The
+// sponge state is kept in four registers (one per row of the Blake2b state)
+// for the whole row; lyra2_detect_sponge() decides whether these are used.
+
+#ifdef ENABLE_AVX2
+
+#include <immintrin.h>
+
+#include "Sponge.h"
+#include "Lyra2.h"
+
+#define LOAD(p) _mm256_loadu_si256((const __m256i*)(p))
+#define STORE(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+
+#define G_AVX2(a, b, c, d, r16, r24) \
+    do { \
+        a = _mm256_add_epi64(a, b); \
+        d = _mm256_shuffle_epi32(_mm256_xor_si256(d, a), _MM_SHUFFLE(2, 3, 0, 1)); \
+        c = _mm256_add_epi64(c, d); \
+        b = _mm256_shuffle_epi8(_mm256_xor_si256(b, c), r24); \
+        a = _mm256_add_epi64(a, b); \
+        d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), r16); \
+        c = _mm256_add_epi64(c, d); \
+        b = _mm256_xor_si256(b, c); \
+        b = _mm256_xor_si256(_mm256_srli_epi64(b, 63), _mm256_add_epi64(b, b)); \
+    } while (0)
+
+/* One round of Blake2b: the column step, then the diagonal step on rotated rows */
+#define ROUND_LYRA_AVX2(a, b, c, d, r16, r24) \
+    do { \
+        G_AVX2(a, b, c, d, r16, r24); \
+        b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1)); \
+        c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2)); \
+        d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(2, 1, 0, 3)); \
+        G_AVX2(a, b, c, d, r16, r24); \
+        b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3)); \
+        c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2)); \
+        d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(0, 3, 2, 1)); \
+    } while (0)
+
+#define STATE_VARS \
+    const __m256i r16 = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, \
+                                         2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9); \
+    const __m256i r24 = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, \
+                                         3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10); \
+    __m256i s0 = LOAD(state), s1 = LOAD(state + 4), s2 = LOAD(state + 8), s3 = LOAD(state + 12)
+
+#define STATE_STORE \
+    STORE(state, s0); STORE(state + 4, s1); STORE(state + 8, s2); STORE(state + 12, s3)
+
+/* rotW(rand): the twelve rate words of the state rotated up by one word */
+#define ROTW(w0, w1, w2) \
+    __m256i t0 = _mm256_permute4x64_epi64(s0, _MM_SHUFFLE(2, 1, 0, 3)); \
+    __m256i t1 = _mm256_permute4x64_epi64(s1, _MM_SHUFFLE(2, 1, 0, 3)); \
+    __m256i t2 = _mm256_permute4x64_epi64(s2, _MM_SHUFFLE(2, 1, 0, 3)); \
+    __m256i w0 = _mm256_blend_epi32(t0, t2, 0x03); \
+    __m256i w1 = _mm256_blend_epi32(t1, t0, 0x03); \
+    __m256i w2 = _mm256_blend_epi32(t2, t1, 0x03)
+
+void reducedSqueezeRow0_avx2(uint64_t* state, uint64_t* rowOut, uint64_t nCols)
+{
+    uint64_t* ptrWord = rowOut + (nCols-1)*BLOCK_LEN_INT64;
+    uint64_t i;
+    STATE_VARS;
+
+    for (i = 0; i < nCols; i++) {
+        STORE(ptrWord, s0);
+        STORE(ptrWord + 4, s1);
+        STORE(ptrWord + 8, s2);
+        ptrWord -= BLOCK_LEN_INT64;
+
+        ROUND_LYRA_AVX2(s0, s1, s2, s3, r16, r24);
+    }
+    STATE_STORE;
+}
+
+void reducedDuplexRow1_avx2(uint64_t* state, uint64_t* rowIn, uint64_t* rowOut, uint64_t nCols)
+{
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordOut = rowOut + (nCols-1)*BLOCK_LEN_INT64;
+    uint64_t i;
+    STATE_VARS;
+
+    for (i = 0; i < nCols; i++) {
+        const __m256i in0 = LOAD(ptrWordIn), in1 = LOAD(ptrWordIn + 4), in2 = LOAD(ptrWordIn + 8);
+        s0 = _mm256_xor_si256(s0, in0);
+        s1 = _mm256_xor_si256(s1, in1);
+        s2 = _mm256_xor_si256(s2, in2);
+
+        ROUND_LYRA_AVX2(s0, s1, s2, s3, r16, r24);
+
+        STORE(ptrWordOut, _mm256_xor_si256(in0, s0));
+        STORE(ptrWordOut + 4, _mm256_xor_si256(in1, s1));
+        STORE(ptrWordOut + 8, _mm256_xor_si256(in2, s2));
+
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    STATE_STORE;
+}
+
+void reducedDuplexRowSetup_avx2(uint64_t* state, uint64_t* rowIn, uint64_t* rowInOut, uint64_t* rowOut, uint64_t nCols)
+{
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordInOut = rowInOut;
+    uint64_t* ptrWordOut = rowOut + (nCols-1)*BLOCK_LEN_INT64;
+    uint64_t i;
+    STATE_VARS;
+
+    for (i = 0; i < nCols; i++) {
+        const __m256i in0 = LOAD(ptrWordIn), in1 = LOAD(ptrWordIn + 4), in2 = LOAD(ptrWordIn + 8);
+        const __m256i io0 = LOAD(ptrWordInOut), io1 = LOAD(ptrWordInOut + 4), io2 = LOAD(ptrWordInOut + 8);
+        s0 = _mm256_xor_si256(s0, _mm256_add_epi64(in0, io0));
+        s1 = _mm256_xor_si256(s1, _mm256_add_epi64(in1, io1));
+        s2 = _mm256_xor_si256(s2, _mm256_add_epi64(in2, io2));
+
+        ROUND_LYRA_AVX2(s0, s1, s2, s3, r16, r24);
+
+        STORE(ptrWordOut, _mm256_xor_si256(in0, s0));
+        STORE(ptrWordOut + 4, _mm256_xor_si256(in1, s1));
+        STORE(ptrWordOut + 8, _mm256_xor_si256(in2, s2));
+
+        {
+            ROTW(w0, w1, w2);
+            STORE(ptrWordInOut, _mm256_xor_si256(io0, w0));
+            STORE(ptrWordInOut + 4, _mm256_xor_si256(io1, w1));
+            STORE(ptrWordInOut + 8, _mm256_xor_si256(io2, w2));
+        }
+
+        ptrWordInOut += BLOCK_LEN_INT64;
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    STATE_STORE;
+}
+
+void reducedDuplexRow_avx2(uint64_t* state, uint64_t* rowIn, uint64_t* rowInOut, uint64_t* rowOut, uint64_t nCols)
+{
+    uint64_t* ptrWordInOut = rowInOut;
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordOut = rowOut;
+    uint64_t i;
+    STATE_VARS;
+
+    for (i = 0; i < nCols; i++) {
+        s0 = _mm256_xor_si256(s0, _mm256_add_epi64(LOAD(ptrWordIn), LOAD(ptrWordInOut)));
+        s1 = _mm256_xor_si256(s1, _mm256_add_epi64(LOAD(ptrWordIn + 4), LOAD(ptrWordInOut + 4)));
+        s2 = _mm256_xor_si256(s2, _mm256_add_epi64(LOAD(ptrWordIn + 8), LOAD(ptrWordInOut + 8)));
+
+        ROUND_LYRA_AVX2(s0, s1, s2, s3, r16, r24);
+
+        STORE(ptrWordOut, _mm256_xor_si256(LOAD(ptrWordOut), s0));
+        STORE(ptrWordOut + 4, _mm256_xor_si256(LOAD(ptrWordOut + 4), s1));
+        STORE(ptrWordOut + 8, _mm256_xor_si256(LOAD(ptrWordOut + 8), s2));
+
+        {
+            // rowOut and rowInOut may be the same row, so reload after the store above
+            ROTW(w0, w1, w2);
+            STORE(ptrWordInOut, _mm256_xor_si256(LOAD(ptrWordInOut), w0));
+            STORE(ptrWordInOut + 4, _mm256_xor_si256(LOAD(ptrWordInOut + 4), w1));
+            STORE(ptrWordInOut + 8, _mm256_xor_si256(LOAD(ptrWordInOut + 8), w2));
+        }
+
+        ptrWordOut += BLOCK_LEN_INT64;
+        ptrWordInOut += BLOCK_LEN_INT64;
+        ptrWordIn += BLOCK_LEN_INT64;
+    }
+    STATE_STORE;
+}
+
+#endif // ENABLE_AVX2
@@ -0,0 +1,175 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// SSE2 versions of the reduced-round Lyra2 row operations in Sponge.c, with
+// the sponge state held in eight registers for the whole row. SSE2 is part of
+// x86-64, so this is always built there; lyra2_detect_sponge() picks it when
+// AVX2 is not available.
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#include "Sponge.h"
+#include "Lyra2.h"
+
+#define LOAD(p) _mm_loadu_si128((const __m128i*)(p))
+#define STORE(p, v) _mm_storeu_si128((__m128i*)(p), v)
+
+#define ROTR32(x) _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1))
+#define ROTR24(x) _mm_xor_si128(_mm_srli_epi64(x, 24), _mm_slli_epi64(x, 40))
+#define ROTR16(x) _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 3, 2, 1)), _MM_SHUFFLE(0, 3, 2, 1))
+#define ROTR63(x) _mm_xor_si128(_mm_srli_epi64(x, 63), _mm_add_epi64(x, x))
+
+#define G_SSE2(a, b, c, d) \
+    do { \
+        a = _mm_add_epi64(a, b); d = ROTR32(_mm_xor_si128(d, a)); \
+        c = _mm_add_epi64(c, d); b = ROTR24(_mm_xor_si128(b, c)); \
+        a = _mm_add_epi64(a, b); d = ROTR16(_mm_xor_si128(d, a)); \
+        c = _mm_add_epi64(c, d); b = ROTR63(_mm_xor_si128(b, c)); \
+    } while (0)
+
+/* [x.hi, y.lo] */
+#define HILO(x, y) _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(x), _mm_castsi128_pd(y), 1))
+
+/* One round of Blake2b on rows split in low (words 0-1) and high (words 2-3) halves */
+#define ROUND_LYRA_SSE2(al, ah, bl, bh, cl, ch, dl, dh) \
+    do { \
+        __m128i t0, t1; \
+        G_SSE2(al, bl, cl, dl); \
+        G_SSE2(ah, bh, ch, dh); \
+        t0 = HILO(bl, bh); t1 = HILO(bh, bl); bl = t0; bh = t1; \
+        t0 = cl; cl = ch; ch = t0; \
+        t0 = HILO(dh, dl); t1 = HILO(dl, dh); dl = t0; dh = t1; \
+        G_SSE2(al, bl, cl, dl); \
+        G_SSE2(ah, bh, ch, dh); \
+        t0 = HILO(bh, bl); t1 = HILO(bl, bh); bl = t0; bh = t1; \
+        t0 = cl; cl = ch; ch = t0; \
+        t0 = HILO(dl, dh); t1 = HILO(dh, dl); dl = t0; dh = t1; \
+    } while (0)
+
+#define ROUND(s) ROUND_LYRA_SSE2(s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7])
+
+#define STATE_LOAD \
+    __m128i s[8]; \
+    int k; \
+    for (k = 0; k < 8; k++) \
+        s[k] = LOAD(state + 2 * k)
+
+#define STATE_STORE \
+    for (k = 0; k < 8; k++) \
+        STORE(state + 2 * k, s[k])
+
+/* rotW(rand): the twelve rate words of the state rotated up by one word */
+#define ROTW(w) \
+    __m128i w[6]; \
+    w[0] = HILO(s[5], s[0]); \
+    for (k = 1; k < 6; k++) \
+        w[k] = HILO(s[k - 1], s[k])
+
+void reducedSqueezeRow0_sse2(uint64_t* state, uint64_t* rowOut, uint64_t nCols)
+{
+    uint64_t* ptrWord = rowOut + (nCols-1)*BLOCK_LEN_INT64;
+    uint64_t i;
+    STATE_LOAD;
+
+    for (i = 0; i < nCols; i++) {
+        for (k = 0; k < 6; k++)
+            STORE(ptrWord + 2 * k, s[k]);
+        ptrWord -= BLOCK_LEN_INT64;
+
+        ROUND(s);
+    }
+    STATE_STORE;
+}
+
+void reducedDuplexRow1_sse2(uint64_t* state, uint64_t* rowIn, uint64_t* rowOut, uint64_t nCols)
+{
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordOut = rowOut + (nCols-1)*BLOCK_LEN_INT64;
+    uint64_t i;
+    __m128i in[6];
+    STATE_LOAD;
+
+    for (i = 0; i < nCols; i++) {
+        for (k = 0; k < 6; k++) {
+            in[k] = LOAD(ptrWordIn + 2 * k);
+            s[k] = _mm_xor_si128(s[k], in[k]);
+        }
+
+        ROUND(s);
+
+        for (k = 0; k < 6; k++)
+            STORE(ptrWordOut + 2 * k, _mm_xor_si128(in[k], s[k]));
+
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    STATE_STORE;
+}
+
+void reducedDuplexRowSetup_sse2(uint64_t* state, uint64_t* rowIn, uint64_t* rowInOut, uint64_t* rowOut, uint64_t nCols)
+{
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordInOut = rowInOut;
+    uint64_t* ptrWordOut = rowOut + (nCols-1)*BLOCK_LEN_INT64;
+    uint64_t i;
+    __m128i in[6], io[6];
+    STATE_LOAD;
+
+    for (i = 0; i < nCols; i++) {
+        for (k = 0; k < 6; k++) {
+            in[k] = LOAD(ptrWordIn + 2 * k);
+            io[k] = LOAD(ptrWordInOut + 2 * k);
+            s[k] = _mm_xor_si128(s[k], _mm_add_epi64(in[k], io[k]));
+        }
+
+        ROUND(s);
+
+        for (k = 0; k < 6; k++)
+            STORE(ptrWordOut + 2 * k, _mm_xor_si128(in[k], s[k]));
+        {
+            ROTW(w);
+            for (k = 0; k < 6; k++)
+                STORE(ptrWordInOut + 2 * k, _mm_xor_si128(io[k], w[k]));
+        }
+
+        ptrWordInOut += BLOCK_LEN_INT64;
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    STATE_STORE;
+}
+
+void reducedDuplexRow_sse2(uint64_t* state, uint64_t* rowIn, uint64_t* rowInOut, uint64_t* rowOut, uint64_t nCols)
+{
+    uint64_t* ptrWordInOut = rowInOut;
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordOut = rowOut;
+    uint64_t i;
+    STATE_LOAD;
+
+    for (i = 0; i < nCols; i++) {
+        for (k = 0; k < 6; k++)
+            s[k] = _mm_xor_si128(s[k], _mm_add_epi64(LOAD(ptrWordIn + 2 * k), LOAD(ptrWordInOut + 2 * k)));
+
+        ROUND(s);
+
+        for (k = 0; k < 6; k++)
+            STORE(ptrWordOut + 2 * k, _mm_xor_si128(LOAD(ptrWordOut + 2 * k), s[k]));
+        {
+            // rowOut and rowInOut may be the same row, so reload after the store above
+            ROTW(w);
+            for (k = 0; k < 6; k++)
+                STORE(ptrWordInOut + 2 * k, _mm_xor_si128(LOAD(ptrWordInOut + 2 * k), w[k]));
+        }
+
+        ptrWordOut += BLOCK_LEN_INT64;
+        ptrWordInOut += BLOCK_LEN_INT64;
+        ptrWordIn += BLOCK_LEN_INT64;
+    }
+    STATE_STORE;
+}
+
+#endif // __SSE2__
@@ -1112,26 +1112,36 @@ int yespower(yespower_local_t *local,
 	return 0;
 }
 
+static __thread int tls_initialized = 0;
+static __thread yespower_local_t tls_local;
+
+static void yespower_tls_free(void)
+{
+	if (tls_initialized) {
+		yespower_free_local(&tls_local);
+		tls_initialized = 0;
+	}
+}
+
 /**
  * yespower_tls(src, srclen, params, dst):
  * Compute yespower(src[0 .. srclen - 1], N, r), to be checked for "< target".
- * The memory allocation is maintained internally using thread-local storage.
+ * The memory allocation is maintained internally using thread-local storage,
+ * and freed when the thread exits.
  *
  * Return 0 on success; or -1 on error.
  */
 int yespower_tls(const uint8_t *src, size_t srclen,
     const yespower_params_t *params, yespower_binary_t *dst)
 {
-	static __thread int initialized = 0;
-	static __thread yespower_local_t local;
-
-	if (!initialized) {
-		if (yespower_init_local(&local))
+	if (!tls_initialized) {
+		if (yespower_init_local(&tls_local))
 			return -1;
-		initialized = 1;
+		tls_initialized = 1;
+		pow_scratch_at_thread_exit(yespower_tls_free);
 	}
 
-	return yespower(&local, src, srclen, params, dst);
+	return yespower(&tls_local, src, srclen, params, dst);
 }
 
 int yespower_init_local(yespower_local_t *local)
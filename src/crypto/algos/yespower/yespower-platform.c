@@ -18,89 +18,47 @@
  * SUCH DAMAGE.
  */
 
-#ifdef __unix__
-#include <sys/mman.h>
-#endif
-
-#define HUGEPAGE_THRESHOLD		(12 * 1024 * 1024)
-
-#ifdef __x86_64__
-#define HUGEPAGE_SIZE			(2 * 1024 * 1024)
-#else
-#undef HUGEPAGE_SIZE
-#endif
-
-static void *alloc_region(yespower_region_t *region, size_t size)
-{
-	size_t base_size = size;
-	uint8_t *base, *aligned;
-#ifdef MAP_ANON
-	int flags =
-#ifdef MAP_NOCORE
-	    MAP_NOCORE |
-#endif
-	    MAP_ANON | MAP_PRIVATE;
-#if defined(MAP_HUGETLB) && defined(HUGEPAGE_SIZE)
-	size_t new_size = size;
-	const size_t hugepage_mask = (size_t)HUGEPAGE_SIZE - 1;
-	if (size >= HUGEPAGE_THRESHOLD && size + hugepage_mask >= size) {
-		flags |= MAP_HUGETLB;
 /*
- * Linux's munmap() fails on MAP_HUGETLB mappings if size is not a multiple of
- * huge page size, so let's round up to huge page size here.
+ * Regions come from the node's shared proof of work scratchpad allocator,
+ * which tries explicit huge pages, then transparent huge pages, then normal
+ * pages, for every size rather than only from 12 MiB up as upstream does.
  */
-		new_size = size + hugepage_mask;
-		new_size &= ~hugepage_mask;
-	}
-	base = mmap(NULL, new_size, PROT_READ | PROT_WRITE, flags, -1, 0);
-	if (base != MAP_FAILED) {
-		base_size = new_size;
-	} else if (flags & MAP_HUGETLB) {
-		flags &= ~MAP_HUGETLB;
-		base = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
-	}
-
-#else
-	base = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
-#endif
-	if (base == MAP_FAILED)
-		base = NULL;
-	aligned = base;
-#elif defined(HAVE_POSIX_MEMALIGN)
-	if ((errno = posix_memalign((void **)&base, 64, size)) != 0)
-		base = NULL;
-	aligned = base;
-#else
-	base = aligned = NULL;
-	if (size + 63 < size) {
-		errno = ENOMEM;
-	} else if ((base = malloc(size + 63)) != NULL) {
-		aligned = base + 63;
-		aligned -= (uintptr_t)aligned & 63;
-	}
-#endif
-	region->base = base;
-	region->aligned = aligned;
-	region->base_size = base ? base_size : 0;
-	region->aligned_size = base ? size : 0;
-	return aligned;
-}
+#include "crypto/pow_scratch.h"
 
 static inline void init_region(yespower_region_t *region)
 {
 	region->base = region->aligned = NULL;
 	region->base_size = region->aligned_size = 0;
+	region->mode = 0;
+}
+
+static void *alloc_region(yespower_region_t *region, size_t size)
+{
+	pow_scratch_t scratch;
+
+	if (pow_scratch_alloc(&scratch, size)) {
+		init_region(region);
+		errno = ENOMEM;
+		return NULL;
+	}
+	region->base = scratch.base;
+	region->aligned = scratch.aligned;
+	region->base_size = scratch.base_size;
+	region->aligned_size = size;
+	region->mode = scratch.mode;
+	return region->aligned;
 }
 
 static int free_region(yespower_region_t *region)
 {
 	if (region->base) {
-#ifdef MAP_ANON
-		if (munmap(region->base, region->base_size))
-			return -1;
-#else
-		free(region->base);
-#endif
+		pow_scratch_t scratch;
+		scratch.base = region->base;
+		scratch.base_size = region->base_size;
+		scratch.aligned = region->aligned;
+		scratch.size = region->aligned_size;
+		scratch.mode = (pow_scratch_mode_t)region->mode;
+		pow_scratch_free(&scratch);
 	}
 	init_region(region);
 	return 0;
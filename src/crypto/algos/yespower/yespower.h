@@ -44,6 +44,7 @@ extern "C" {
 typedef struct {
 	void *base, *aligned;
 	size_t base_size, aligned_size;
+	int mode; /* pow_scratch_mode_t */
 } yespower_region_t;
 
 /**
@@ -0,0 +1,37 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/corehash_multiway.h>
+
+namespace corehash_avx2 {
+namespace {
+
+/** Four 64 bit lanes in an AVX2 register; see corehash_multiway.h */
+struct Avx2 {
+    typedef __m256i Word;
+    static const int LANES = 4;
+
+    static inline Word Load(const uint64_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static inline void Store(uint64_t* p, Word x) { _mm256_storeu_si256((__m256i*)p, x); }
+    static inline Word Set1(uint64_t x) { return _mm256_set1_epi64x(x); }
+    static inline Word Add(Word x, Word y) { return _mm256_add_epi64(x, y); }
+    static inline Word Xor(Word x, Word y) { return _mm256_xor_si256(x, y); }
+    static inline Word AndNot(Word x, Word y) { return _mm256_andnot_si256(x, y); }
+    template <int N> static inline Word RotL(Word x) { return _mm256_or_si256(_mm256_slli_epi64(x, N), _mm256_srli_epi64(x, 64 - N)); }
+};
+
+} // namespace
+
+void Blake512_4way(unsigned char* out, const unsigned char* in) { corehash_multiway::Blake512<Avx2>(out, in); }
+void Keccak512_4way(unsigned char* out, const unsigned char* in) { corehash_multiway::Keccak512<Avx2>(out, in); }
+void Skein512_4way(unsigned char* out, const unsigned char* in) { corehash_multiway::Skein512<Avx2>(out, in); }
+
+}
+
+#endif
@@ -0,0 +1,37 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX512F
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/corehash_multiway.h>
+
+namespace corehash_avx512 {
+namespace {
+
+/** Eight 64 bit lanes in an AVX-512 register; see corehash_multiway.h */
+struct Avx512 {
+    typedef __m512i Word;
+    static const int LANES = 8;
+
+    static inline Word Load(const uint64_t* p) { return _mm512_loadu_si512((const void*)p); }
+    static inline void Store(uint64_t* p, Word x) { _mm512_storeu_si512((void*)p, x); }
+    static inline Word Set1(uint64_t x) { return _mm512_set1_epi64(x); }
+    static inline Word Add(Word x, Word y) { return _mm512_add_epi64(x, y); }
+    static inline Word Xor(Word x, Word y) { return _mm512_xor_si512(x, y); }
+    static inline Word AndNot(Word x, Word y) { return _mm512_andnot_si512(x, y); }
+    template <int N> static inline Word RotL(Word x) { return _mm512_rol_epi64(x, N); }
+};
+
+} // namespace
+
+void Blake512_8way(unsigned char* out, const unsigned char* in) { corehash_multiway::Blake512<Avx512>(out, in); }
+void Keccak512_8way(unsigned char* out, const unsigned char* in) { corehash_multiway::Keccak512<Avx512>(out, in); }
+void Skein512_8way(unsigned char* out, const unsigned char* in) { corehash_multiway::Skein512<Avx512>(out, in); }
+
+}
+
+#endif
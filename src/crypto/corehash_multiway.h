@@ -0,0 +1,313 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_COREHASH_MULTIWAY_H
+#define BITCOIN_CRYPTO_COREHASH_MULTIWAY_H
+
+#include <crypto/common.h>
+
+#include <stdint.h>
+
+/**
+ * Lane parallel versions of GhostRider core hashes for 64 byte messages, the
+ * size of every round after the first. Each 64 bit lane of a vector carries
+ * one message, so a kernel hashes V::LANES messages at once.
+ *
+ * The kernels are written once against a vector traits class V, which the
+ * per instruction set translation units (corehash_avx2.cpp,
+ * corehash_avx512.cpp) provide:
+ *
+ *   typedef ... Word;                          LANES 64 bit lanes
+ *   static const int LANES;
+ *   static Word Load(const uint64_t* p);       p[0..LANES-1] into the lanes
+ *   static void Store(uint64_t* p, Word x);
+ *   static Word Set1(uint64_t x);
+ *   static Word Add(Word x, Word y);
+ *   static Word Xor(Word x, Word y);
+ *   static Word AndNot(Word x, Word y);        ~x & y
+ *   template <int N> static Word RotL(Word x); 0 < N < 64
+ *
+ * Input and output are V::LANES consecutive 64 byte messages and digests.
+ * All input is read before any output is written, so they may overlap.
+ */
+namespace corehash_multiway {
+
+template <int N, typename V>
+inline typename V::Word RotL(typename V::Word x) { return V::template RotL<N>(x); }
+
+/** Word w of every message, read with read */
+template <typename V, uint64_t (*read)(const unsigned char*)>
+inline typename V::Word Gather(const unsigned char* in, int w)
+{
+    uint64_t tmp[V::LANES];
+    for (int l = 0; l < V::LANES; l++) {
+        tmp[l] = read(in + 64 * l + 8 * w);
+    }
+    return V::Load(tmp);
+}
+
+/** Word w of every digest, written with write */
+template <typename V, void (*write)(unsigned char*, uint64_t)>
+inline void Scatter(unsigned char* out, int w, typename V::Word x)
+{
+    uint64_t tmp[V::LANES];
+    V::Store(tmp, x);
+    for (int l = 0; l < V::LANES; l++) {
+        write(out + 64 * l + 8 * w, tmp[l]);
+    }
+}
+
+static const uint64_t KECCAK_RC[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808AULL, 0x8000000080008000ULL,
+    0x000000000000808BULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008AULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000AULL,
+    0x000000008000808BULL, 0x800000000000008BULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800AULL, 0x800000008000000AULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+/** Keccak-512 as in sph_keccak512 (the original submission padding) */
+template <typename V>
+void Keccak512(unsigned char* out, const unsigned char* in)
+{
+    typedef typename V::Word W;
+    W A[25], B[25], C[5], D[5];
+
+    // The whole message plus its padding fits in the 72 byte rate
+    for (int i = 0; i < 8; i++) {
+        A[i] = Gather<V, ReadLE64>(in, i);
+    }
+    A[8] = V::Set1(0x8000000000000001ULL);
+    for (int i = 9; i < 25; i++) {
+        A[i] = V::Set1(0);
+    }
+
+    for (int round = 0; round < 24; round++) {
+        // Spelled out: compilers do not reliably unroll these, and the state
+        // has to stay in registers for the lanes to pay off
+        C[0] = V::Xor(V::Xor(V::Xor(A[0], A[5]), V::Xor(A[10], A[15])), A[20]);
+        C[1] = V::Xor(V::Xor(V::Xor(A[1], A[6]), V::Xor(A[11], A[16])), A[21]);
+        C[2] = V::Xor(V::Xor(V::Xor(A[2], A[7]), V::Xor(A[12], A[17])), A[22]);
+        C[3] = V::Xor(V::Xor(V::Xor(A[3], A[8]), V::Xor(A[13], A[18])), A[23]);
+        C[4] = V::Xor(V::Xor(V::Xor(A[4], A[9]), V::Xor(A[14], A[19])), A[24]);
+        D[0] = V::Xor(C[4], RotL<1, V>(C[1]));
+        D[1] = V::Xor(C[0], RotL<1, V>(C[2]));
+        D[2] = V::Xor(C[1], RotL<1, V>(C[3]));
+        D[3] = V::Xor(C[2], RotL<1, V>(C[4]));
+        D[4] = V::Xor(C[3], RotL<1, V>(C[0]));
+        A[0] = V::Xor(A[0], D[0]); A[1] = V::Xor(A[1], D[1]); A[2] = V::Xor(A[2], D[2]); A[3] = V::Xor(A[3], D[3]); A[4] = V::Xor(A[4], D[4]);
+        A[5] = V::Xor(A[5], D[0]); A[6] = V::Xor(A[6], D[1]); A[7] = V::Xor(A[7], D[2]); A[8] = V::Xor(A[8], D[3]); A[9] = V::Xor(A[9], D[4]);
+        A[10] = V::Xor(A[10], D[0]); A[11] = V::Xor(A[11], D[1]); A[12] = V::Xor(A[12], D[2]); A[13] = V::Xor(A[13], D[3]); A[14] = V::Xor(A[14], D[4]);
+        A[15] = V::Xor(A[15], D[0]); A[16] = V::Xor(A[16], D[1]); A[17] = V::Xor(A[17], D[2]); A[18] = V::Xor(A[18], D[3]); A[19] = V::Xor(A[19], D[4]);
+        A[20] = V::Xor(A[20], D[0]); A[21] = V::Xor(A[21], D[1]); A[22] = V::Xor(A[22], D[2]); A[23] = V::Xor(A[23], D[3]); A[24] = V::Xor(A[24], D[4]);
+
+        B[0] = A[0]; B[10] = RotL<1, V>(A[1]); B[20] = RotL<62, V>(A[2]); B[5] = RotL<28, V>(A[3]); B[15] = RotL<27, V>(A[4]);
+        B[16] = RotL<36, V>(A[5]); B[1] = RotL<44, V>(A[6]); B[11] = RotL<6, V>(A[7]); B[21] = RotL<55, V>(A[8]); B[6] = RotL<20, V>(A[9]);
+        B[7] = RotL<3, V>(A[10]); B[17] = RotL<10, V>(A[11]); B[2] = RotL<43, V>(A[12]); B[12] = RotL<25, V>(A[13]); B[22] = RotL<39, V>(A[14]);
+        B[23] = RotL<41, V>(A[15]); B[8] = RotL<45, V>(A[16]); B[18] = RotL<15, V>(A[17]); B[3] = RotL<21, V>(A[18]); B[13] = RotL<8, V>(A[19]);
+        B[14] = RotL<18, V>(A[20]); B[24] = RotL<2, V>(A[21]); B[9] = RotL<61, V>(A[22]); B[19] = RotL<56, V>(A[23]); B[4] = RotL<14, V>(A[24]);
+
+        A[0] = V::Xor(B[0], V::AndNot(B[1], B[2])); A[1] = V::Xor(B[1], V::AndNot(B[2], B[3])); A[2] = V::Xor(B[2], V::AndNot(B[3], B[4])); A[3] = V::Xor(B[3], V::AndNot(B[4], B[0])); A[4] = V::Xor(B[4], V::AndNot(B[0], B[1]));
+        A[5] = V::Xor(B[5], V::AndNot(B[6], B[7])); A[6] = V::Xor(B[6], V::AndNot(B[7], B[8])); A[7] = V::Xor(B[7], V::AndNot(B[8], B[9])); A[8] = V::Xor(B[8], V::AndNot(B[9], B[5])); A[9] = V::Xor(B[9], V::AndNot(B[5], B[6]));
+        A[10] = V::Xor(B[10], V::AndNot(B[11], B[12])); A[11] = V::Xor(B[11], V::AndNot(B[12], B[13])); A[12] = V::Xor(B[12], V::AndNot(B[13], B[14])); A[13] = V::Xor(B[13], V::AndNot(B[14], B[10])); A[14] = V::Xor(B[14], V::AndNot(B[10], B[11]));
+        A[15] = V::Xor(B[15], V::AndNot(B[16], B[17])); A[16] = V::Xor(B[16], V::AndNot(B[17], B[18])); A[17] = V::Xor(B[17], V::AndNot(B[18], B[19])); A[18] = V::Xor(B[18], V::AndNot(B[19], B[15])); A[19] = V::Xor(B[19], V::AndNot(B[15], B[16]));
+        A[20] = V::Xor(B[20], V::AndNot(B[21], B[22])); A[21] = V::Xor(B[21], V::AndNot(B[22], B[23])); A[22] = V::Xor(B[22], V::AndNot(B[23], B[24])); A[23] = V::Xor(B[23], V::AndNot(B[24], B[20])); A[24] = V::Xor(B[24], V::AndNot(B[20], B[21]));
+        A[0] = V::Xor(A[0], V::Set1(KECCAK_RC[round]));
+    }
+
+    for (int i = 0; i < 8; i++) {
+        Scatter<V, WriteLE64>(out, i, A[i]);
+    }
+}
+
+static const uint64_t BLAKE512_IV[8] = {
+    0x6A09E667F3BCC908ULL, 0xBB67AE8584CAA73BULL, 0x3C6EF372FE94F82BULL, 0xA54FF53A5F1D36F1ULL,
+    0x510E527FADE682D1ULL, 0x9B05688C2B3E6C1FULL, 0x1F83D9ABFB41BD6BULL, 0x5BE0CD19137E2179ULL
+};
+
+static const uint64_t BLAKE512_CB[16] = {
+    0x243F6A8885A308D3ULL, 0x13198A2E03707344ULL, 0xA4093822299F31D0ULL, 0x082EFA98EC4E6C89ULL,
+    0x452821E638D01377ULL, 0xBE5466CF34E90C6CULL, 0xC0AC29B7C97C50DDULL, 0x3F84D5B5B5470917ULL,
+    0x9216D5D98979FB1BULL, 0xD1310BA698DFB5ACULL, 0x2FFD72DBD01ADFB7ULL, 0xB8E1AFED6A267E96ULL,
+    0xBA7C9045F12C7F99ULL, 0x24A19947B3916CF7ULL, 0x0801F2E2858EFC16ULL, 0x636920D871574E69ULL
+};
+
+static const uint8_t BLAKE_SIGMA[10][16] = {
+    { 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15},
+    {14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3},
+    {11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4},
+    { 7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8},
+    { 9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13},
+    { 2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9},
+    {12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11},
+    {13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10},
+    { 6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5},
+    {10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0}
+};
+
+/** One BLAKE-512 G function on (a, b, c, d), using message word pair i of sigma */
+template <typename V>
+inline void BlakeG(typename V::Word& a, typename V::Word& b, typename V::Word& c, typename V::Word& d,
+    const typename V::Word* m, const uint8_t* sigma, int i)
+{
+    const int j = sigma[2 * i], k = sigma[2 * i + 1];
+    a = V::Add(V::Add(a, b), V::Xor(m[j], V::Set1(BLAKE512_CB[k])));
+    d = RotL<32, V>(V::Xor(d, a));
+    c = V::Add(c, d);
+    b = RotL<39, V>(V::Xor(b, c));
+    a = V::Add(V::Add(a, b), V::Xor(m[k], V::Set1(BLAKE512_CB[j])));
+    d = RotL<48, V>(V::Xor(d, a));
+    c = V::Add(c, d);
+    b = RotL<53, V>(V::Xor(b, c));
+}
+
+/** BLAKE-512 as in sph_blake512 */
+template <typename V>
+void Blake512(unsigned char* out, const unsigned char* in)
+{
+    typedef typename V::Word W;
+    W m[16], v[16];
+
+    // A 64 byte message is a single block: the message, the padding bit,
+    // the final 1 bit and the 128 bit length (512)
+    for (int i = 0; i < 8; i++) {
+        m[i] = Gather<V, ReadBE64>(in, i);
+    }
+    m[8] = V::Set1(0x8000000000000000ULL);
+    for (int i = 9; i < 16; i++) {
+        m[i] = V::Set1(0);
+    }
+    m[13] = V::Set1(1);
+    m[15] = V::Set1(512);
+
+    const uint64_t t0 = 512, t1 = 0;
+    for (int i = 0; i < 8; i++) {
+        v[i] = V::Set1(BLAKE512_IV[i]);
+    }
+    for (int i = 8; i < 12; i++) {
+        v[i] = V::Set1(BLAKE512_CB[i - 8]);
+    }
+    v[12] = V::Set1(t0 ^ BLAKE512_CB[4]);
+    v[13] = V::Set1(t0 ^ BLAKE512_CB[5]);
+    v[14] = V::Set1(t1 ^ BLAKE512_CB[6]);
+    v[15] = V::Set1(t1 ^ BLAKE512_CB[7]);
+
+    for (int round = 0; round < 16; round++) {
+        const uint8_t* sigma = BLAKE_SIGMA[round % 10];
+        BlakeG<V>(v[0], v[4], v[8], v[12], m, sigma, 0);
+        BlakeG<V>(v[1], v[5], v[9], v[13], m, sigma, 1);
+        BlakeG<V>(v[2], v[6], v[10], v[14], m, sigma, 2);
+        BlakeG<V>(v[3], v[7], v[11], v[15], m, sigma, 3);
+        BlakeG<V>(v[0], v[5], v[10], v[15], m, sigma, 4);
+        BlakeG<V>(v[1], v[6], v[11], v[12], m, sigma, 5);
+        BlakeG<V>(v[2], v[7], v[8], v[13], m, sigma, 6);
+        BlakeG<V>(v[3], v[4], v[9], v[14], m, sigma, 7);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        Scatter<V, WriteBE64>(out, i, V::Xor(V::Set1(BLAKE512_IV[i]), V::Xor(v[i], v[i + 8])));
+    }
+}
+
+static const uint64_t SKEIN512_IV[8] = {
+    0x4903ADFF749C51CEULL, 0x0D95DE399746DF03ULL, 0x8FD1934127C79BCEULL, 0x9A255629FF352CB1ULL,
+    0x5DB62599DF6CA7B0ULL, 0xEABE394CA9D5C3F4ULL, 0x991112C71A75B523ULL, 0xAE18A40B660FCC33ULL
+};
+
+template <int R0, int R1, int R2, int R3, typename V>
+inline void SkeinMix8(typename V::Word* x, int p0, int p1, int p2, int p3, int p4, int p5, int p6, int p7)
+{
+    x[p0] = V::Add(x[p0], x[p1]); x[p1] = V::Xor(RotL<R0, V>(x[p1]), x[p0]);
+    x[p2] = V::Add(x[p2], x[p3]); x[p3] = V::Xor(RotL<R1, V>(x[p3]), x[p2]);
+    x[p4] = V::Add(x[p4], x[p5]); x[p5] = V::Xor(RotL<R2, V>(x[p5]), x[p4]);
+    x[p6] = V::Add(x[p6], x[p7]); x[p7] = V::Xor(RotL<R3, V>(x[p7]), x[p6]);
+}
+
+/** Add subkey S of the Threefish-512 key schedule (k[0..8], t[0..2]) */
+template <int S, typename V>
+inline void SkeinAddKey(typename V::Word* x, const typename V::Word* k, const uint64_t* t)
+{
+    x[0] = V::Add(x[0], k[(S + 0) % 9]);
+    x[1] = V::Add(x[1], k[(S + 1) % 9]);
+    x[2] = V::Add(x[2], k[(S + 2) % 9]);
+    x[3] = V::Add(x[3], k[(S + 3) % 9]);
+    x[4] = V::Add(x[4], k[(S + 4) % 9]);
+    x[5] = V::Add(x[5], V::Add(k[(S + 5) % 9], V::Set1(t[S % 3])));
+    x[6] = V::Add(x[6], V::Add(k[(S + 6) % 9], V::Set1(t[(S + 1) % 3])));
+    x[7] = V::Add(x[7], V::Add(k[(S + 7) % 9], V::Set1(S)));
+}
+
+/** Eight Threefish-512 rounds, starting with subkey S */
+template <int S, typename V>
+inline void SkeinEightRounds(typename V::Word* x, const typename V::Word* k, const uint64_t* t)
+{
+    SkeinAddKey<S, V>(x, k, t);
+    SkeinMix8<46, 36, 19, 37, V>(x, 0, 1, 2, 3, 4, 5, 6, 7);
+    SkeinMix8<33, 27, 14, 42, V>(x, 2, 1, 4, 7, 6, 5, 0, 3);
+    SkeinMix8<17, 49, 36, 39, V>(x, 4, 1, 6, 3, 0, 5, 2, 7);
+    SkeinMix8<44, 9, 54, 56, V>(x, 6, 1, 0, 7, 2, 5, 4, 3);
+    SkeinAddKey<S + 1, V>(x, k, t);
+    SkeinMix8<39, 30, 34, 24, V>(x, 0, 1, 2, 3, 4, 5, 6, 7);
+    SkeinMix8<13, 50, 10, 17, V>(x, 2, 1, 4, 7, 6, 5, 0, 3);
+    SkeinMix8<25, 29, 39, 43, V>(x, 4, 1, 6, 3, 0, 5, 2, 7);
+    SkeinMix8<8, 35, 56, 22, V>(x, 6, 1, 0, 7, 2, 5, 4, 3);
+}
+
+/** One UBI block: h = Threefish-512(key h, tweak t0/t1)(m) ^ m */
+template <typename V>
+inline void SkeinUBI(typename V::Word* h, const typename V::Word* m, uint64_t t0, uint64_t t1)
+{
+    typedef typename V::Word W;
+    W k[9], x[8];
+    const uint64_t t[3] = {t0, t1, t0 ^ t1};
+
+    k[8] = V::Set1(0x1BD11BDAA9FC1A22ULL);
+    for (int i = 0; i < 8; i++) {
+        k[i] = h[i];
+        k[8] = V::Xor(k[8], h[i]);
+        x[i] = m[i];
+    }
+
+    SkeinEightRounds<0, V>(x, k, t);
+    SkeinEightRounds<2, V>(x, k, t);
+    SkeinEightRounds<4, V>(x, k, t);
+    SkeinEightRounds<6, V>(x, k, t);
+    SkeinEightRounds<8, V>(x, k, t);
+    SkeinEightRounds<10, V>(x, k, t);
+    SkeinEightRounds<12, V>(x, k, t);
+    SkeinEightRounds<14, V>(x, k, t);
+    SkeinEightRounds<16, V>(x, k, t);
+    SkeinAddKey<18, V>(x, k, t);
+
+    for (int i = 0; i < 8; i++) {
+        h[i] = V::Xor(x[i], m[i]);
+    }
+}
+
+/** Skein-512-512 as in sph_skein512 */
+template <typename V>
+void Skein512(unsigned char* out, const unsigned char* in)
+{
+    typedef typename V::Word W;
+    W h[8], m[8];
+
+    for (int i = 0; i < 8; i++) {
+        h[i] = V::Set1(SKEIN512_IV[i]);
+        m[i] = Gather<V, ReadLE64>(in, i);
+    }
+    // The message as the first and final block, then the output block
+    SkeinUBI<V>(h, m, 64, 0xF000000000000000ULL);
+    for (int i = 0; i < 8; i++) {
+        m[i] = V::Set1(0);
+    }
+    SkeinUBI<V>(h, m, 8, 0xFF00000000000000ULL);
+
+    for (int i = 0; i < 8; i++) {
+        Scatter<V, WriteLE64>(out, i, h[i]);
+    }
+}
+
+} // namespace corehash_multiway
+
+#endif // BITCOIN_CRYPTO_COREHASH_MULTIWAY_H
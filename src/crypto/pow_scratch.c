@@ -0,0 +1,152 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "pow_scratch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#define POW_SCRATCH_HUGEPAGE_SIZE ((size_t)2 * 1024 * 1024)
+
+static volatile int use_hugepages = POW_SCRATCH_DEFAULT_HUGEPAGES;
+static size_t usage[POW_SCRATCH_NUM_MODES];
+
+void pow_scratch_set_hugepages(int enable)
+{
+    use_hugepages = enable;
+}
+
+static void account(pow_scratch_mode_t mode, size_t size, int add)
+{
+    if (add)
+        __sync_fetch_and_add(&usage[mode], size);
+    else
+        __sync_fetch_and_sub(&usage[mode], size);
+}
+
+static size_t round_hugepage(size_t size)
+{
+    return (size + POW_SCRATCH_HUGEPAGE_SIZE - 1) & ~(POW_SCRATCH_HUGEPAGE_SIZE - 1);
+}
+
+#if !defined(_WIN32) && defined(MADV_HUGEPAGE)
+/* MADV_HUGEPAGE succeeds but does nothing when THP is switched off */
+static int thp_enabled(void)
+{
+    static volatile int enabled = -1;
+    if (enabled < 0) {
+        char buf[64] = {0};
+        FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+        int result = 0;
+        if (file) {
+            if (fgets(buf, sizeof(buf), file))
+                result = strstr(buf, "[never]") == NULL;
+            fclose(file);
+        }
+        enabled = result;
+    }
+    return enabled;
+}
+#endif
+
+int pow_scratch_alloc(pow_scratch_t *scratch, size_t size)
+{
+    memset(scratch, 0, sizeof(*scratch));
+    if (size == 0 || round_hugepage(size) < size)
+        return -1;
+
+#if defined(_WIN32)
+    /* Large pages need SeLockMemoryPrivilege, which nodes never run with */
+    scratch->base = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!scratch->base)
+        return -1;
+    scratch->base_size = size;
+    scratch->aligned = (uint8_t *)scratch->base;
+    scratch->mode = POW_SCRATCH_NORMAL;
+#else
+    void *base = MAP_FAILED;
+    /* Below a huge page, rounding up would cost more memory than the TLB saves */
+    const int huge = size >= POW_SCRATCH_HUGEPAGE_SIZE;
+#if defined(MAP_HUGETLB)
+    /* munmap() of a MAP_HUGETLB mapping fails unless its size is a multiple of the huge page size */
+    if (huge && use_hugepages) {
+        base = mmap(NULL, round_hugepage(size), PROT_READ | PROT_WRITE,
+            MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+        if (base != MAP_FAILED) {
+            scratch->base_size = round_hugepage(size);
+            scratch->aligned = (uint8_t *)base;
+            scratch->mode = POW_SCRATCH_HUGETLB;
+        }
+    }
+#endif
+#if defined(MADV_HUGEPAGE)
+    /* Over-allocate so that the buffer can start on a huge page boundary, then trim */
+    if (base == MAP_FAILED && huge && thp_enabled()) {
+        const size_t map_size = round_hugepage(size) + POW_SCRATCH_HUGEPAGE_SIZE;
+        uint8_t *map = (uint8_t *)mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+        if (map != MAP_FAILED) {
+            uint8_t *aligned = (uint8_t *)(((uintptr_t)map + POW_SCRATCH_HUGEPAGE_SIZE - 1) & ~(uintptr_t)(POW_SCRATCH_HUGEPAGE_SIZE - 1));
+            const size_t head = aligned - map;
+            if (head)
+                munmap(map, head);
+            munmap(aligned + round_hugepage(size), map_size - head - round_hugepage(size));
+            base = aligned;
+            scratch->base_size = round_hugepage(size);
+            scratch->aligned = aligned;
+            scratch->mode = madvise(aligned, round_hugepage(size), MADV_HUGEPAGE) == 0 ? POW_SCRATCH_THP : POW_SCRATCH_NORMAL;
+        }
+    }
+#endif
+    if (base == MAP_FAILED) {
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+        if (base == MAP_FAILED)
+            return -1;
+        scratch->base_size = size;
+        scratch->aligned = (uint8_t *)base;
+        scratch->mode = POW_SCRATCH_NORMAL;
+    }
+    scratch->base = base;
+#endif
+    scratch->size = size;
+    account(scratch->mode, scratch->base_size, 1);
+    return 0;
+}
+
+void pow_scratch_free(pow_scratch_t *scratch)
+{
+    if (scratch->base) {
+        account(scratch->mode, scratch->base_size, 0);
+#if defined(_WIN32)
+        VirtualFree(scratch->base, 0, MEM_RELEASE);
+#else
+        munmap(scratch->base, scratch->base_size);
+#endif
+    }
+    memset(scratch, 0, sizeof(*scratch));
+}
+
+const char *pow_scratch_mode_name(pow_scratch_mode_t mode)
+{
+    switch (mode) {
+    case POW_SCRATCH_HUGETLB:
+        return "huge";
+    case POW_SCRATCH_THP:
+        return "transparent huge";
+    default:
+        return "normal";
+    }
+}
+
+void pow_scratch_usage(size_t bytes[POW_SCRATCH_NUM_MODES])
+{
+    int mode;
+    for (mode = 0; mode < POW_SCRATCH_NUM_MODES; mode++)
+        bytes[mode] = __sync_fetch_and_add(&usage[mode], 0);
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_POW_SCRATCH_H
+#define BITCOIN_CRYPTO_POW_SCRATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Whether scratchpads try explicit huge pages unless told otherwise */
+#define POW_SCRATCH_DEFAULT_HUGEPAGES 1
+
+/**
+ * How a scratchpad is backed. The memory-hard hashes (CryptoNight long_state,
+ * scrypt V, the Lyra2 matrix and yespower V) jump around a buffer of 128 KiB
+ * to 8 MiB, which with 4 KiB pages misses the TLB on nearly every access.
+ */
+typedef enum {
+    POW_SCRATCH_NORMAL = 0,  /* regular pages */
+    POW_SCRATCH_THP = 1,     /* 2 MiB aligned and madvise(MADV_HUGEPAGE)d */
+    POW_SCRATCH_HUGETLB = 2, /* MAP_HUGETLB, from the reserved huge page pool */
+    POW_SCRATCH_NUM_MODES = 3
+} pow_scratch_mode_t;
+
+typedef struct pow_scratch {
+    void *base;
+    size_t base_size;
+    uint8_t *aligned; /* at least cache line aligned, size bytes long */
+    size_t size;
+    pow_scratch_mode_t mode;
+} pow_scratch_t;
+
+/**
+ * pow_scratch_set_hugepages(enable):
+ * Whether later allocations may use explicit huge pages. Transparent huge
+ * pages are asked for either way, as the kernel falls back to normal pages on
+ * its own when it has none.
+ */
+void pow_scratch_set_hugepages(int enable);
+
+/**
+ * pow_scratch_alloc(scratch, size):
+ * Allocate size bytes backed by explicit huge pages if enabled and available,
+ * else by transparent huge pages where supported, else by normal pages.
+ * Sizes below one 2 MiB huge page always get normal pages.
+ *
+ * Return 0 on success; or -1 on error, leaving scratch zeroed.
+ */
+int pow_scratch_alloc(pow_scratch_t *scratch, size_t size);
+
+/**
+ * pow_scratch_free(scratch):
+ * Release a scratchpad from pow_scratch_alloc(), if any, and zero scratch.
+ */
+void pow_scratch_free(pow_scratch_t *scratch);
+
+/**
+ * pow_scratch_at_thread_exit(release):
+ * Have release() called when the calling thread exits, so that the thread
+ * local scratchpads of the C hashers go back with their thread. Registering
+ * the same function again on a thread has no effect.
+ */
+void pow_scratch_at_thread_exit(void (*release)(void));
+
+/* "normal", "transparent huge" or "huge" */
+const char *pow_scratch_mode_name(pow_scratch_mode_t mode);
+
+/**
+ * pow_scratch_usage(bytes):
+ * Fill bytes[mode] with the number of bytes currently allocated in each mode.
+ */
+void pow_scratch_usage(size_t bytes[POW_SCRATCH_NUM_MODES]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BITCOIN_CRYPTO_POW_SCRATCH_H
@@ -0,0 +1,34 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/pow_scratch.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+/** C has no thread local destructors, so the C hashers register theirs here */
+class ThreadReleasers
+{
+public:
+    std::vector<void (*)(void)> vRelease;
+
+    ~ThreadReleasers()
+    {
+        for (void (*release)(void) : vRelease)
+            release();
+    }
+};
+
+thread_local ThreadReleasers threadReleasers;
+
+} // namespace
+
+void pow_scratch_at_thread_exit(void (*release)(void))
+{
+    std::vector<void (*)(void)>& vRelease = threadReleasers.vRelease;
+    if (std::find(vRelease.begin(), vRelease.end(), release) == vRelease.end())
+        vRelease.push_back(release);
+}
@@ -28,6 +28,7 @@
  */
 
 #include <crypto/scrypt.h>
+#include <crypto/pow_scratch.h>
 
 #include <stdlib.h>
 #include <stdint.h>
@@ -326,8 +327,29 @@ std::string scrypt_detect_sse2()
 }
 #endif
 
+/** The scratchpad of a thread, given back when the thread exits */
+struct ScryptScratchpad
+{
+	pow_scratch_t scratch;
+
+	ScryptScratchpad() { memset(&scratch, 0, sizeof(scratch)); }
+	~ScryptScratchpad() { pow_scratch_free(&scratch); }
+};
+
+static thread_local ScryptScratchpad scrypt_tls_scratchpad;
+
 void scrypt_1024_1_1_256(const char *input, char *output)
 {
+	pow_scratch_t *scratch = &scrypt_tls_scratchpad.scratch;
+	if (scratch->base || pow_scratch_alloc(scratch, SCRYPT_SCRATCHPAD_SIZE) == 0) {
+		scrypt_1024_1_1_256_sp(input, output, (char *)scratch->aligned);
+		return;
+	}
 	char scratchpad[SCRYPT_SCRATCHPAD_SIZE];
-    scrypt_1024_1_1_256_sp(input, output, scratchpad);
+	scrypt_1024_1_1_256_sp(input, output, scratchpad);
+}
+
+void scrypt_scratchpad_free()
+{
+	pow_scratch_free(&scrypt_tls_scratchpad.scratch);
 }
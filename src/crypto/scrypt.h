@@ -6,7 +6,10 @@
 
 static const int SCRYPT_SCRATCHPAD_SIZE = 131072 + 63;
 
+/** Hash with a per-thread scratchpad from pow_scratch_alloc(), on the stack if that fails */
 void scrypt_1024_1_1_256(const char *input, char *output);
+/** Release the scratchpad of the calling thread, if any; this also happens when the thread exits */
+void scrypt_scratchpad_free();
 void scrypt_1024_1_1_256_sp_generic(const char *input, char *output, char *scratchpad);
 
 #if defined(USE_SSE2)
@@ -0,0 +1,33 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash-ops.h"
+#include "c_blake256.h"
+#include "c_groestl.h"
+#include "c_jh.h"
+#include "c_skein.h"
+
+void hash_extra_blake(const void *data, size_t length, char *hash) {
+  blake256_hash((uint8_t*)hash, data, length);
+}
+
+void hash_extra_groestl(const void *data, size_t length, char *hash) {
+  groestl(data, length * 8, (uint8_t*)hash);
+}
+
+void hash_extra_jh(const void *data, size_t length, char *hash) {
+  int r = jh_hash(HASH_SIZE * 8, data, 8 * length, (uint8_t*)hash);
+  assert(SUCCESS == r);
+  (void)r;
+}
+
+void hash_extra_skein(const void *data, size_t length, char *hash) {
+  int r = c_skein_hash(8 * HASH_SIZE, data, 8 * length, (uint8_t*)hash);
+  assert(SKEIN_SUCCESS == r);
+  (void)r;
+}
@@ -29,6 +29,14 @@ static inline void place_length(uint8_t *buffer, size_t bufsize, size_t length)
   }
 }
 
+#else
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+#endif
+
 #pragma pack(push, 1)
 union hash_state {
   uint8_t b[200];
@@ -39,8 +47,6 @@ union hash_state {
 void hash_permutation(union hash_state *state);
 void hash_process(union hash_state *state, const uint8_t *buf, size_t count);
 
-#endif
-
 enum {
   HASH_SIZE = 32,
   HASH_DATA_AREA = 136
@@ -55,3 +61,7 @@ void hash_extra_jh(const void *data, size_t length, char *hash);
 void hash_extra_skein(const void *data, size_t length, char *hash);
 
 void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash);
+
+#if defined(__cplusplus)
+}
+#endif
@@ -0,0 +1,100 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include <but-config.h>
+#endif
+
+#include <cryptonote/cryptonight_engine_impl.h>
+
+#include <cryptonote/cryptonight.h>
+#include <cryptonote/cryptonight_aesni.h>
+#include <cryptonote/cryptonight_dark.h>
+#include <cryptonote/cryptonight_dark_lite.h>
+#include <cryptonote/cryptonight_fast.h>
+#include <cryptonote/cryptonight_lite.h>
+#include <cryptonote/cryptonight_soft_shell.h>
+#include <cryptonote/cryptonight_turtle.h>
+#include <cryptonote/cryptonight_turtle_lite.h>
+
+namespace cryptonight {
+
+template <typename Config>
+void Hash(const char* input, char* output, uint32_t len, int variant, const Config& config)
+{
+#if defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (cryptonight_aesni_enabled) {
+        HashAESNI(config, input, output, len, variant);
+        return;
+    }
+#endif
+    SlowHash<SoftAES>(config, input, output, len, variant);
+}
+
+template void Hash<Original>(const char*, char*, uint32_t, int, const Original&);
+template void Hash<Dark>(const char*, char*, uint32_t, int, const Dark&);
+template void Hash<DarkLite>(const char*, char*, uint32_t, int, const DarkLite&);
+template void Hash<Fast>(const char*, char*, uint32_t, int, const Fast&);
+template void Hash<Lite>(const char*, char*, uint32_t, int, const Lite&);
+template void Hash<Turtle>(const char*, char*, uint32_t, int, const Turtle&);
+template void Hash<TurtleLite>(const char*, char*, uint32_t, int, const TurtleLite&);
+template void Hash<SoftShell>(const char*, char*, uint32_t, int, const SoftShell&);
+
+void FastHash(const char* input, char* output, uint32_t len)
+{
+    union hash_state state;
+    hash_process(&state, (const uint8_t*) input, len);
+    memcpy(output, &state, HASH_SIZE);
+}
+
+} // namespace cryptonight
+
+void cryptonight_hash(const char* input, char* output, uint32_t len, int variant)
+{
+    cryptonight::Hash<cryptonight::Original>(input, output, len, variant);
+}
+
+void cryptonightdark_hash(const char* input, char* output, uint32_t len, int variant)
+{
+    cryptonight::Hash<cryptonight::Dark>(input, output, len, variant);
+}
+
+void cryptonightdarklite_hash(const char* input, char* output, uint32_t len, int variant)
+{
+    cryptonight::Hash<cryptonight::DarkLite>(input, output, len, variant);
+}
+
+void cryptonightfast_hash(const char* input, char* output, uint32_t len, int variant)
+{
+    cryptonight::Hash<cryptonight::Fast>(input, output, len, variant);
+}
+
+void cryptonightlite_hash(const char* input, char* output, uint32_t len, int variant)
+{
+    cryptonight::Hash<cryptonight::Lite>(input, output, len, variant);
+}
+
+void cryptonightturtle_hash(const char* input, char* output, uint32_t len, int variant)
+{
+    cryptonight::Hash<cryptonight::Turtle>(input, output, len, variant);
+}
+
+void cryptonightturtlelite_hash(const char* input, char* output, uint32_t len, int variant)
+{
+    cryptonight::Hash<cryptonight::TurtleLite>(input, output, len, variant);
+}
+
+void cryptonight_soft_shell_hash(const char* input, char* output, uint32_t len, int variant, uint32_t scratchpad, uint32_t iterations)
+{
+    cryptonight::Hash(input, output, len, variant, cryptonight::SoftShell(scratchpad, iterations));
+}
+
+void cryptonight_fast_hash(const char* input, char* output, uint32_t len) { cryptonight::FastHash(input, output, len); }
+void cryptonightdark_fast_hash(const char* input, char* output, uint32_t len) { cryptonight::FastHash(input, output, len); }
+void cryptonightdarklite_fast_hash(const char* input, char* output, uint32_t len) { cryptonight::FastHash(input, output, len); }
+void cryptonightfast_fast_hash(const char* input, char* output, uint32_t len) { cryptonight::FastHash(input, output, len); }
+void cryptonightlite_fast_hash(const char* input, char* output, uint32_t len) { cryptonight::FastHash(input, output, len); }
+void cryptonightturtle_fast_hash(const char* input, char* output, uint32_t len) { cryptonight::FastHash(input, output, len); }
+void cryptonightturtlelite_fast_hash(const char* input, char* output, uint32_t len) { cryptonight::FastHash(input, output, len); }
+void cryptonight_soft_shell_fast_hash(const char* input, char* output, uint32_t len) { cryptonight::FastHash(input, output, len); }
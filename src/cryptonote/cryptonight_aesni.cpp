@@ -0,0 +1,123 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This file is only compiled with AES-NI enabled (ENABLE_AESNI); the caller
+// must check cryptonight_aesni_enabled before using it.
+
+#include <cryptonote/cryptonight_aesni.h>
+#include <cryptonote/cryptonight_engine_impl.h>
+
+#include <immintrin.h>
+
+namespace cryptonight {
+namespace {
+
+inline void Aes256Assist1(__m128i& t1, __m128i t2)
+{
+    __m128i t4;
+    t2 = _mm_shuffle_epi32(t2, 0xff);
+    t4 = _mm_slli_si128(t1, 0x04);
+    t1 = _mm_xor_si128(t1, t4);
+    t4 = _mm_slli_si128(t4, 0x04);
+    t1 = _mm_xor_si128(t1, t4);
+    t4 = _mm_slli_si128(t4, 0x04);
+    t1 = _mm_xor_si128(t1, t4);
+    t1 = _mm_xor_si128(t1, t2);
+}
+
+inline void Aes256Assist2(__m128i t1, __m128i& t3)
+{
+    __m128i t2, t4;
+    t4 = _mm_aeskeygenassist_si128(t1, 0x00);
+    t2 = _mm_shuffle_epi32(t4, 0xaa);
+    t4 = _mm_slli_si128(t3, 0x04);
+    t3 = _mm_xor_si128(t3, t4);
+    t4 = _mm_slli_si128(t4, 0x04);
+    t3 = _mm_xor_si128(t3, t4);
+    t4 = _mm_slli_si128(t4, 0x04);
+    t3 = _mm_xor_si128(t3, t4);
+    t3 = _mm_xor_si128(t3, t2);
+}
+
+/** AES-NI/SSE2 backend; see SoftAES for the interface. */
+struct HardAES {
+    typedef __m128i Block;
+
+    /** The first ten round keys of the AES-256 schedule, as used by aesb_pseudo_round */
+    class Key
+    {
+    public:
+        Key(const uint8_t* key, Scratchpad&)
+        {
+            __m128i t1 = _mm_loadu_si128((const __m128i*) key);
+            __m128i t3 = _mm_loadu_si128((const __m128i*) (key + 16));
+            k[0] = t1;
+            k[1] = t3;
+
+            Aes256Assist1(t1, _mm_aeskeygenassist_si128(t3, 0x01));
+            k[2] = t1;
+            Aes256Assist2(t1, t3);
+            k[3] = t3;
+
+            Aes256Assist1(t1, _mm_aeskeygenassist_si128(t3, 0x02));
+            k[4] = t1;
+            Aes256Assist2(t1, t3);
+            k[5] = t3;
+
+            Aes256Assist1(t1, _mm_aeskeygenassist_si128(t3, 0x04));
+            k[6] = t1;
+            Aes256Assist2(t1, t3);
+            k[7] = t3;
+
+            Aes256Assist1(t1, _mm_aeskeygenassist_si128(t3, 0x08));
+            k[8] = t1;
+            Aes256Assist2(t1, t3);
+            k[9] = t3;
+        }
+        __m128i k[10];
+    };
+
+    static inline Block Load(const uint8_t* p) { return _mm_loadu_si128((const __m128i*) p); }
+    static inline void Store(uint8_t* p, Block b) { _mm_storeu_si128((__m128i*) p, b); }
+    static inline Block Make(uint64_t lo, uint64_t hi) { return _mm_set_epi64x(hi, lo); }
+    static inline uint64_t Lo(Block b) { return _mm_cvtsi128_si64(b); }
+    static inline uint64_t Hi(Block b) { return _mm_cvtsi128_si64(_mm_srli_si128(b, 8)); }
+    static inline Block Xor(Block a, Block b) { return _mm_xor_si128(a, b); }
+    static inline Block Add(Block a, Block b) { return _mm_add_epi64(a, b); }
+    static inline Block Round(Block in, Block key) { return _mm_aesenc_si128(in, key); }
+
+    static inline Block PseudoRound(Block x, const Key& key)
+    {
+        for (int i = 0; i < 10; i++)
+            x = _mm_aesenc_si128(x, key.k[i]);
+        return x;
+    }
+
+    static inline uint64_t Sqrt(uint64_t sqrt_input)
+    {
+        uint64_t sqrt_result;
+        VARIANT2_INTEGER_MATH_SQRT_STEP_SSE2();
+        VARIANT2_INTEGER_MATH_SQRT_FIXUP(sqrt_result);
+        return sqrt_result;
+    }
+};
+
+} // namespace
+
+template <typename Config>
+void HashAESNI(const Config& config, const char* input, char* output, uint32_t len, int variant)
+{
+    SlowHash<HardAES>(config, input, output, len, variant);
+}
+
+template void HashAESNI<Original>(const Original&, const char*, char*, uint32_t, int);
+template void HashAESNI<Dark>(const Dark&, const char*, char*, uint32_t, int);
+template void HashAESNI<DarkLite>(const DarkLite&, const char*, char*, uint32_t, int);
+template void HashAESNI<Fast>(const Fast&, const char*, char*, uint32_t, int);
+template void HashAESNI<Lite>(const Lite&, const char*, char*, uint32_t, int);
+template void HashAESNI<Turtle>(const Turtle&, const char*, char*, uint32_t, int);
+template void HashAESNI<TurtleLite>(const TurtleLite&, const char*, char*, uint32_t, int);
+template void HashAESNI<SoftShell>(const SoftShell&, const char*, char*, uint32_t, int);
+
+} // namespace cryptonight
@@ -0,0 +1,28 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CRYPTONIGHT_AESNI_H
+#define CRYPTONIGHT_AESNI_H
+
+#include <stdint.h>
+#include <string>
+
+/** Set by cryptonight_detect_aesni() when the AES-NI code path may be used. */
+extern int cryptonight_aesni_enabled;
+
+namespace cryptonight {
+
+/**
+ * The CryptoNight engine instantiated with the AES-NI/SSE2 backend. Only
+ * built with ENABLE_AESNI; the caller must check cryptonight_aesni_enabled.
+ */
+template <typename Config>
+void HashAESNI(const Config& config, const char* input, char* output, uint32_t len, int variant);
+
+} // namespace cryptonight
+
+/** Select the AES-NI CryptoNight code path if the CPU supports it. */
+std::string cryptonight_detect_aesni();
+
+#endif
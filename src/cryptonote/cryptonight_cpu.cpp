@@ -0,0 +1,75 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include <but-config.h>
+#endif
+
+#include <cryptonote/cryptonight_aesni.h>
+#include <cryptonote/cryptonight_turtle.h>
+
+#include <string.h>
+
+#if defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// Portable AES until cryptonight_detect_aesni() has verified the CPU supports AES-NI
+int cryptonight_aesni_enabled = 0;
+
+#if defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL)
+/** Check that the AES-NI code path agrees with the portable one. */
+static bool SelfTest()
+{
+    char input[64];
+    char portable[32];
+    char aesni[32];
+    for (int i = 0; i < 64; i++) {
+        input[i] = (char)(i * 7 + 3);
+    }
+
+    int enabled = cryptonight_aesni_enabled;
+    cryptonight_aesni_enabled = 0;
+    cryptonightturtle_hash(input, portable, sizeof(input), 1);
+    cryptonight_aesni_enabled = 1;
+    cryptonightturtle_hash(input, aesni, sizeof(input), 1);
+    cryptonight_aesni_enabled = enabled;
+    return memcmp(portable, aesni, sizeof(portable)) == 0;
+}
+#endif
+
+std::string cryptonight_detect_aesni()
+{
+#if defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL)
+    unsigned int cpuid_ecx = 0, cpuid_edx = 0;
+#if defined(_MSC_VER)
+    int x86cpuid[4];
+    __cpuid(x86cpuid, 1);
+    cpuid_ecx = (unsigned int)x86cpuid[2];
+    cpuid_edx = (unsigned int)x86cpuid[3];
+#else
+    unsigned int eax, ebx;
+    __get_cpuid(1, &eax, &ebx, &cpuid_ecx, &cpuid_edx);
+#endif
+
+    const bool have_aes = (cpuid_ecx >> 25) & 1;
+    const bool have_sse2 = (cpuid_edx >> 26) & 1;
+    if (!have_aes || !have_sse2) {
+        cryptonight_aesni_enabled = 0;
+        return "cryptonight: using generic AES, AES-NI unavailable";
+    }
+    if (!SelfTest()) {
+        cryptonight_aesni_enabled = 0;
+        return "cryptonight: using generic AES, AES-NI self-test failed";
+    }
+    cryptonight_aesni_enabled = 1;
+    return "cryptonight: using AES-NI as detected";
+#else
+    return "cryptonight: using generic AES as built";
+#endif
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CRYPTONIGHT_ENGINE_H
+#define CRYPTONIGHT_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * All CryptoNight variants share a single hash engine. A variant is nothing
+ * more than its scratchpad size, its iteration count and whether the main
+ * loop only addresses the lower half of the scratchpad ("lite"); those are
+ * compile time parameters so each variant still gets its own fully unrolled
+ * code. The pre-2020 C entry points (cryptonightdark_hash() and friends) are
+ * thin shims over cryptonight::Hash().
+ */
+namespace cryptonight {
+
+template <size_t MEMORY, size_t ITERATIONS, bool HALF_SCRATCHPAD>
+struct Params {
+    static constexpr size_t memory = MEMORY;
+    static constexpr size_t iter_div = ITERATIONS / 2;
+    /** Number of 16 byte blocks the main loop addresses */
+    static constexpr size_t aes_init = (MEMORY / 16) / (HALF_SCRATCHPAD ? 2 : 1);
+
+    static_assert((MEMORY & (MEMORY - 1)) == 0 && MEMORY >= 128, "scratchpad must be a power of two");
+};
+
+typedef Params<2097152, 1048576, false> Original;
+typedef Params<524288, 262144, false> Dark;
+typedef Params<524288, 262144, true> DarkLite;
+typedef Params<2097152, 524288, false> Fast;
+typedef Params<1048576, 524288, false> Lite;
+typedef Params<262144, 131072, false> Turtle;
+typedef Params<262144, 131072, true> TurtleLite;
+
+/** Soft Shell picks its scratchpad and iteration count at run time. */
+struct SoftShell {
+    size_t memory;
+    size_t iter_div;
+    size_t aes_init;
+
+    SoftShell(uint32_t scratchpad, uint32_t iterations)
+        : memory(scratchpad), iter_div(iterations / 2), aes_init(scratchpad / 16 / 2) {}
+};
+
+/**
+ * Hash len bytes of input into the 32 byte output with the given parameter
+ * set. variant selects the CryptoNight v0, v1 or v2 (>= 2) main loop. Uses
+ * AES-NI when cryptonight_detect_aesni() enabled it.
+ */
+template <typename Config>
+void Hash(const char* input, char* output, uint32_t len, int variant, const Config& config = Config());
+
+/** Keccak-1600 of the input, truncated to 32 bytes. */
+void FastHash(const char* input, char* output, uint32_t len);
+
+} // namespace cryptonight
+
+#endif
@@ -0,0 +1,306 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+// Portions Copyright (c) 2018 The Monero developers
+// Portions Copyright (c) 2018 The TurtleCoin Developers
+
+#ifndef CRYPTONIGHT_ENGINE_IMPL_H
+#define CRYPTONIGHT_ENGINE_IMPL_H
+
+// Only to be included by the translation units that instantiate the engine
+// (cryptonight.cpp for the portable backend, cryptonight_aesni.cpp for AES-NI).
+
+#include <cryptonote/cryptonight_engine.h>
+#include <cryptonote/cryptonight_scratchpad.h>
+#include <cryptonote/crypto/hash-ops.h>
+#include <cryptonote/crypto/int-util.h>
+#include <cryptonote/crypto/oaes_lib.h>
+#include <cryptonote/crypto/variant2_int_sqrt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace cryptonight {
+
+static const size_t AES_BLOCK_SIZE = 16;
+static const size_t AES_KEY_SIZE = 32;
+static const size_t INIT_SIZE_BLK = 8;
+static const size_t INIT_SIZE_BYTE = INIT_SIZE_BLK * AES_BLOCK_SIZE;
+
+#pragma pack(push, 1)
+union SlowHashState {
+    union hash_state hs;
+    struct {
+        uint8_t k[64];
+        uint8_t init[INIT_SIZE_BYTE];
+    };
+};
+#pragma pack(pop)
+
+/**
+ * The long_state and AES context of one hash: the calling thread's shared
+ * scratchpad if it is big enough, a private allocation otherwise.
+ */
+class Scratchpad
+{
+public:
+    uint8_t* long_state;
+    oaes_ctx* aes_ctx;
+
+    explicit Scratchpad(size_t memory) : long_state(nullptr), aes_ctx(nullptr), owned(false)
+    {
+        cryptonight_scratchpad_t* pad = nullptr;
+        if (memory <= CRYPTONIGHT_SCRATCHPAD_SIZE)
+            pad = cryptonight_scratchpad_get();
+        if (pad != nullptr) {
+            long_state = pad->long_state;
+            aes_ctx = (oaes_ctx*) pad->aes_ctx;
+        } else {
+            owned = true;
+            long_state = (uint8_t*) malloc(memory);
+            aes_ctx = (oaes_ctx*) oaes_alloc();
+        }
+        if (long_state == nullptr || aes_ctx == nullptr) {
+            fprintf(stderr, "Cryptonight scratchpad allocation failed");
+            abort();
+        }
+    }
+
+    ~Scratchpad()
+    {
+        if (owned) {
+            oaes_free((OAES_CTX**) &aes_ctx);
+            free(long_state);
+        }
+    }
+
+private:
+    bool owned;
+
+    Scratchpad(const Scratchpad&) = delete;
+    Scratchpad& operator=(const Scratchpad&) = delete;
+};
+
+extern "C" void aesb_single_round(const uint8_t* in, uint8_t* out, uint8_t* expandedKey);
+extern "C" void aesb_pseudo_round(const uint8_t* in, uint8_t* out, uint8_t* expandedKey);
+
+/**
+ * Portable AES backend on top of the table driven aesb rounds. A backend
+ * provides a 128 bit Block type, the 10-round key schedule used by explode
+ * and implode (Key), and the handful of block operations the main loop needs.
+ */
+struct SoftAES {
+    struct Block {
+        uint64_t v[2];
+    };
+
+    class Key
+    {
+    public:
+        Key(const uint8_t* key, Scratchpad& pad)
+        {
+            oaes_key_import_data(pad.aes_ctx, key, AES_KEY_SIZE);
+            exp = pad.aes_ctx->key->exp_data;
+        }
+        uint8_t* exp;
+    };
+
+    static inline Block Load(const uint8_t* p) { Block b; memcpy(b.v, p, sizeof(b.v)); return b; }
+    static inline void Store(uint8_t* p, const Block& b) { memcpy(p, b.v, sizeof(b.v)); }
+    static inline Block Make(uint64_t lo, uint64_t hi) { Block b = {{lo, hi}}; return b; }
+    static inline uint64_t Lo(const Block& b) { return b.v[0]; }
+    static inline uint64_t Hi(const Block& b) { return b.v[1]; }
+    static inline Block Xor(const Block& a, const Block& b) { return Make(a.v[0] ^ b.v[0], a.v[1] ^ b.v[1]); }
+    static inline Block Add(const Block& a, const Block& b) { return Make(a.v[0] + b.v[0], a.v[1] + b.v[1]); }
+
+    static inline Block Round(const Block& in, const Block& key)
+    {
+        Block out;
+        aesb_single_round((const uint8_t*) in.v, (uint8_t*) out.v, (uint8_t*) key.v);
+        return out;
+    }
+
+    static inline Block PseudoRound(const Block& in, const Key& key)
+    {
+        Block out;
+        aesb_pseudo_round((const uint8_t*) in.v, (uint8_t*) out.v, key.exp);
+        return out;
+    }
+
+    static inline uint64_t Sqrt(uint64_t sqrt_input)
+    {
+        uint64_t sqrt_result;
+        VARIANT2_INTEGER_MATH_SQRT_STEP_FP64();
+        VARIANT2_INTEGER_MATH_SQRT_FIXUP(sqrt_result);
+        return sqrt_result;
+    }
+};
+
+static void (* const extra_hashes[4])(const void*, size_t, char*) = {
+    hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
+};
+
+/** Variant 2 rotates three neighbouring 16 byte chunks of the scratchpad */
+template <typename AES>
+static inline void ShuffleAdd(uint8_t* long_state, size_t offset, const typename AES::Block& a,
+                              const typename AES::Block& b0, const typename AES::Block& b1)
+{
+    const typename AES::Block chunk1 = AES::Load(long_state + (offset ^ 0x10));
+    const typename AES::Block chunk2 = AES::Load(long_state + (offset ^ 0x20));
+    const typename AES::Block chunk3 = AES::Load(long_state + (offset ^ 0x30));
+    AES::Store(long_state + (offset ^ 0x10), AES::Add(chunk3, b1));
+    AES::Store(long_state + (offset ^ 0x20), AES::Add(chunk1, b0));
+    AES::Store(long_state + (offset ^ 0x30), AES::Add(chunk2, a));
+}
+
+/** Fill the scratchpad with the repeatedly encrypted keccak state */
+template <typename AES>
+static void Explode(SlowHashState& state, Scratchpad& pad, size_t memory)
+{
+    const typename AES::Key key(state.hs.b, pad);
+    typename AES::Block x[INIT_SIZE_BLK];
+    for (size_t j = 0; j < INIT_SIZE_BLK; j++)
+        x[j] = AES::Load(state.init + j * AES_BLOCK_SIZE);
+
+    for (size_t i = 0; i < memory / INIT_SIZE_BYTE; i++) {
+        for (size_t j = 0; j < INIT_SIZE_BLK; j++)
+            x[j] = AES::PseudoRound(x[j], key);
+        for (size_t j = 0; j < INIT_SIZE_BLK; j++)
+            AES::Store(pad.long_state + i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE, x[j]);
+    }
+}
+
+/** Fold the scratchpad back into the keccak state */
+template <typename AES>
+static void Implode(SlowHashState& state, Scratchpad& pad, size_t memory)
+{
+    const typename AES::Key key(&state.hs.b[32], pad);
+    typename AES::Block x[INIT_SIZE_BLK];
+    for (size_t j = 0; j < INIT_SIZE_BLK; j++)
+        x[j] = AES::Load(state.init + j * AES_BLOCK_SIZE);
+
+    for (size_t i = 0; i < memory / INIT_SIZE_BYTE; i++) {
+        for (size_t j = 0; j < INIT_SIZE_BLK; j++) {
+            x[j] = AES::Xor(x[j], AES::Load(pad.long_state + i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE));
+            x[j] = AES::PseudoRound(x[j], key);
+        }
+    }
+
+    for (size_t j = 0; j < INIT_SIZE_BLK; j++)
+        AES::Store(state.init + j * AES_BLOCK_SIZE, x[j]);
+}
+
+template <int VARIANT, typename AES, typename Config>
+static void SlowHash(const Config& config, const char* input, char* output, uint32_t len)
+{
+    typedef typename AES::Block Block;
+
+    Scratchpad pad(config.memory);
+    uint8_t* const long_state = pad.long_state;
+    const size_t mask = (config.aes_init - 1) * AES_BLOCK_SIZE;
+    SlowHashState state;
+
+    hash_process(&state.hs, (const uint8_t*) input, len);
+
+    uint64_t tweak1_2 = 0;
+    if (VARIANT == 1) {
+        if (len < 43) {
+            fprintf(stderr, "Cryptonight variant 1 needs at least 43 bytes of data");
+            abort();
+        }
+        memcpy(&tweak1_2, (const uint8_t*) input + 35, sizeof(tweak1_2));
+        tweak1_2 ^= state.hs.w[24];
+    }
+
+    Explode<AES>(state, pad, config.memory);
+
+    Block a = AES::Xor(AES::Load(state.k), AES::Load(state.k + 32));
+    Block b0 = AES::Xor(AES::Load(state.k + 16), AES::Load(state.k + 48));
+    Block b1 = AES::Make(0, 0);
+    uint64_t division_result = 0;
+    uint64_t sqrt_result = 0;
+    if (VARIANT >= 2) {
+        b1 = AES::Make(state.hs.w[8] ^ state.hs.w[10], state.hs.w[9] ^ state.hs.w[11]);
+        division_result = state.hs.w[12];
+        sqrt_result = state.hs.w[13];
+    }
+
+    for (size_t i = 0; i < config.iter_div; i++) {
+        /* Dependency chain: address -> read value ------+
+         * written value <-+ hard function (AES or MUL) <+
+         * next address  <-+
+         */
+        /* Iteration 1 */
+        size_t j = AES::Lo(a) & mask;
+        const Block c = AES::Round(AES::Load(long_state + j), a);
+        if (VARIANT >= 2)
+            ShuffleAdd<AES>(long_state, j, a, b0, b1);
+        AES::Store(long_state + j, AES::Xor(c, b0));
+        if (VARIANT == 1) {
+            const uint8_t tmp = long_state[j + 11];
+            static const uint32_t table = 0x75310;
+            const uint8_t index = (((tmp >> 3) & 6) | (tmp & 1)) << 1;
+            long_state[j + 11] = tmp ^ ((table >> index) & 0x30);
+        }
+
+        /* Iteration 2 */
+        const uint64_t c_lo = AES::Lo(c);
+        j = c_lo & mask;
+        uint64_t* dst = (uint64_t*) (long_state + j);
+        uint64_t t0 = dst[0];
+        const uint64_t t1 = dst[1];
+
+        if (VARIANT >= 2) {
+            t0 ^= division_result ^ (sqrt_result << 32);
+            const uint64_t dividend = AES::Hi(c);
+            const uint32_t divisor = ((uint32_t) c_lo + (uint32_t) (sqrt_result << 1)) | 0x80000001UL;
+            division_result = ((uint32_t) (dividend / divisor)) + (((uint64_t) (dividend % divisor)) << 32);
+            sqrt_result = AES::Sqrt(c_lo + division_result);
+        }
+
+        uint64_t hi;
+        uint64_t lo = mul128(c_lo, t0, &hi);
+
+        if (VARIANT >= 2) {
+            uint64_t* chunk1 = (uint64_t*) (long_state + (j ^ 0x10));
+            const uint64_t* chunk2 = (const uint64_t*) (long_state + (j ^ 0x20));
+            chunk1[0] ^= hi;
+            chunk1[1] ^= lo;
+            hi ^= chunk2[0];
+            lo ^= chunk2[1];
+            ShuffleAdd<AES>(long_state, j, a, b0, b1);
+        }
+
+        const uint64_t a_lo = AES::Lo(a) + hi;
+        const uint64_t a_hi = AES::Hi(a) + lo;
+        dst[0] = a_lo;
+        dst[1] = VARIANT == 1 ? a_hi ^ tweak1_2 : a_hi;
+        a = AES::Make(a_lo ^ t0, a_hi ^ t1);
+
+        b1 = b0;
+        b0 = c;
+    }
+
+    Implode<AES>(state, pad, config.memory);
+    hash_permutation(&state.hs);
+    extra_hashes[state.hs.b[0] & 3](&state, 200, output);
+}
+
+/** Pick the main loop for variant at run time; v0, v1 and v2 (anything >= 2). */
+template <typename AES, typename Config>
+void SlowHash(const Config& config, const char* input, char* output, uint32_t len, int variant)
+{
+    if (variant == 1) {
+        SlowHash<1, AES>(config, input, output, len);
+    } else if (variant >= 2) {
+        SlowHash<2, AES>(config, input, output, len);
+    } else {
+        SlowHash<0, AES>(config, input, output, len);
+    }
+}
+
+} // namespace cryptonight
+
+#endif
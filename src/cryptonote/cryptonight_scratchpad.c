@@ -0,0 +1,59 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stdlib.h>
+#include <string.h>
+#include "cryptonight_scratchpad.h"
+#include "crypto/oaes_lib.h"
+
+#if defined(_MSC_VER)
+#define CN_THREAD_LOCAL __declspec(thread)
+#else
+#define CN_THREAD_LOCAL __thread
+#endif
+
+static CN_THREAD_LOCAL cryptonight_scratchpad_t tls_scratchpad;
+
+int cryptonight_scratchpad_init(void)
+{
+    cryptonight_scratchpad_t *pad = &tls_scratchpad;
+
+    if (pad->long_state)
+        return 0;
+
+    if (pow_scratch_alloc(&pad->memory, CRYPTONIGHT_SCRATCHPAD_SIZE))
+        return -1;
+    pow_scratch_at_thread_exit(cryptonight_scratchpad_free);
+    pad->long_state = pad->memory.aligned;
+    pad->size = CRYPTONIGHT_SCRATCHPAD_SIZE;
+
+    pad->aes_ctx = oaes_alloc();
+    if (!pad->aes_ctx) {
+        cryptonight_scratchpad_free();
+        return -1;
+    }
+
+    /* Fault the pages in now rather than in the middle of the first hash */
+    memset(pad->long_state, 0, pad->size);
+    return 0;
+}
+
+void cryptonight_scratchpad_free(void)
+{
+    cryptonight_scratchpad_t *pad = &tls_scratchpad;
+
+    if (pad->aes_ctx)
+        oaes_free(&pad->aes_ctx);
+    pow_scratch_free(&pad->memory);
+    memset(pad, 0, sizeof(*pad));
+}
+
+cryptonight_scratchpad_t *cryptonight_scratchpad_get(void)
+{
+    cryptonight_scratchpad_t *pad = &tls_scratchpad;
+
+    if (!pad->long_state && cryptonight_scratchpad_init())
+        return NULL;
+    return pad;
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CRYPTONIGHT_SCRATCHPAD_H
+#define CRYPTONIGHT_SCRATCHPAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crypto/pow_scratch.h"
+
+/* Largest long_state of any CryptoNight variant (cryptonight, cn-fast): 2 MiB - 2^21 */
+#define CRYPTONIGHT_SCRATCHPAD_SIZE 2097152
+
+/**
+ * Per-thread scratchpad shared by all CryptoNight variants. The long_state
+ * buffer comes from pow_scratch_alloc(), so it is backed by a huge page where
+ * the OS allows it.
+ * The AES context is kept alive together with it so that a hash only has to
+ * import its key instead of allocating and seeding a fresh context.
+ */
+typedef struct cryptonight_scratchpad {
+    uint8_t *long_state;
+    size_t size;
+    pow_scratch_t memory;
+    void *aes_ctx;
+} cryptonight_scratchpad_t;
+
+/**
+ * cryptonight_scratchpad_init():
+ * Allocate and pre-fault the scratchpad of the calling thread. Long-lived
+ * worker threads can call this up front so that their first hash does not pay
+ * for the allocation. Does nothing if the thread already has a scratchpad.
+ *
+ * Return 0 on success; or -1 on error.
+ */
+int cryptonight_scratchpad_init(void);
+
+/**
+ * cryptonight_scratchpad_free():
+ * Release the scratchpad of the calling thread, if any. This happens on its
+ * own when the thread exits; threads that stop hashing can call it earlier.
+ */
+void cryptonight_scratchpad_free(void);
+
+/**
+ * cryptonight_scratchpad_get():
+ * Return the scratchpad of the calling thread, lazily allocating it on first
+ * use; or NULL if it could not be allocated.
+ */
+cryptonight_scratchpad_t *cryptonight_scratchpad_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,6 +7,8 @@
 #include <crypto/hmac_sha512.h>
 #include <pubkey.h>
 
+#include <algorithm>
+
 
 inline uint32_t ROTL32(uint32_t x, int8_t r)
 {
@@ -246,3 +248,74 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint3
     SIPROUND;
     return v0 ^ v1 ^ v2 ^ v3;
 }
+
+static const size_t GR_BATCH_CHUNK = 64;
+
+/** GhostRider rounds 1..17 of count inputs whose round 0 output is in hash */
+static void HashGRBatchRounds(uint512 hash[], const GhostRiderSchedule schedule[], uint256 outputs[], size_t count)
+{
+    uint512 in[GR_BATCH_CHUNK], out[GR_BATCH_CHUNK];
+    size_t index[GR_BATCH_CHUNK];
+
+    for (int round = 1; round < GhostRiderSchedule::ROUNDS; round++) {
+        if (GhostRiderSchedule::IsCryptonightRound(round)) {
+            for (size_t i = 0; i < count; i++) {
+                // CryptoNight only writes 32 bytes, the rest must stay zero
+                uint512 cn;
+                cnHash(&hash[i], &cn, 64, schedule[i].algo[round]);
+                hash[i] = cn;
+            }
+            continue;
+        }
+        for (int algo = 0; algo < GhostRiderSchedule::CORE_ALGOS; algo++) {
+            size_t m = 0;
+            for (size_t i = 0; i < count; i++) {
+                if (schedule[i].algo[round] == algo) {
+                    in[m] = hash[i];
+                    index[m++] = i;
+                }
+            }
+            coreHashN(in, out, m, algo);
+            for (size_t j = 0; j < m; j++) {
+                hash[index[j]] = out[j];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        outputs[i] = hash[i].trim256();
+    }
+}
+
+void HashGRBatch(const void* const inputs[], size_t len, const GhostRiderSchedule schedules[], uint256 outputs[], size_t n)
+{
+    static const unsigned char blank[1] = {0};
+    uint512 hash[GR_BATCH_CHUNK];
+
+    for (size_t begin = 0; begin < n; begin += GR_BATCH_CHUNK) {
+        const size_t count = std::min(GR_BATCH_CHUNK, n - begin);
+        const GhostRiderSchedule* schedule = schedules + begin;
+
+        // Round 0 hashes the input itself, which is not 64 bytes long
+        for (size_t i = 0; i < count; i++) {
+            coreHash(len ? inputs[begin + i] : blank, &hash[i], len, schedule[i].algo[0]);
+        }
+        HashGRBatchRounds(hash, schedule, outputs + begin, count);
+    }
+}
+
+void HashGRBatch(const GhostRiderMidstate& midstate, const uint32_t nonces[], uint256 outputs[], size_t n)
+{
+    uint512 hash[GR_BATCH_CHUNK];
+    GhostRiderSchedule schedules[GR_BATCH_CHUNK];
+    std::fill(schedules, schedules + GR_BATCH_CHUNK, midstate.schedule);
+
+    for (size_t begin = 0; begin < n; begin += GR_BATCH_CHUNK) {
+        const size_t count = std::min(GR_BATCH_CHUNK, n - begin);
+        for (size_t i = 0; i < count; i++) {
+            const uint32_t nNonceLE = htole32(nonces[begin + i]);
+            midstate.first.Finalize(&nNonceLE, sizeof(nNonceLE), &hash[i]);
+        }
+        HashGRBatchRounds(hash, schedules, outputs + begin, count);
+    }
+}
@@ -302,50 +302,60 @@ uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
 uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
 
 /* ----------- Ghost Rider Hash ------------------------------------------------ */
-template<typename T1>
-inline uint256 HashGR(const T1 pbegin, const T1 pend, const uint256 PrevBlockHash)
+/** Run GhostRider rounds 1..17 on the output of round 0 in hash[0]. */
+inline uint256 HashGRRounds(uint512 (&hash)[GhostRiderSchedule::ROUNDS], const GhostRiderSchedule& schedule)
 {
-	static unsigned char pblank[1];
-
-	uint512 hash[18];
-	HashSelection hashSelection(PrevBlockHash, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14}, {0,1,2,3,4,5});
-	std::vector<int> randomCNs(hashSelection.getCnIndexes());
-	std::vector<int> coreHashIndexes(hashSelection.getAlgoIndexes());
-	for (int i=0;i<18;i++)
+	for (int i=1;i<GhostRiderSchedule::ROUNDS;i++)
 	{
-		const void *toHash;
-		int lenToHash;
-		if (i == 0) {
-			toHash = (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0]));
-			lenToHash = (pend - pbegin) * sizeof(pbegin[0]);
+		if (GhostRiderSchedule::IsCryptonightRound(i)) {
+			cnHash(&hash[i-1], &hash[i], 64, schedule.algo[i]);
 		} else {
-			toHash = static_cast<const void*>(&hash[i-1]);
-			lenToHash = 64;
-		}
-		int coreSelection;
-		int cnSelection = -1;
-		if(i < 5) {
-			coreSelection = coreHashIndexes[i];
-		} else if(i < 11) {
-			coreSelection = coreHashIndexes[i-1];
-		} else {
-			coreSelection = coreHashIndexes[i-2];
-		}
-
-		if(i==5) {
-			coreSelection = -1;
-			cnSelection = randomCNs[0];
+			coreHash(&hash[i-1], &hash[i], 64, schedule.algo[i]);
 		}
-		if(i==11) {
-			coreSelection = -1;
-			cnSelection = randomCNs[1];
-		} if(i==17) {
-			coreSelection = -1;
-			cnSelection = randomCNs[2];
-		}
-		coreHash(toHash, &hash[i], lenToHash, coreSelection);
-		cnHash(&hash[i-1], &hash[i], lenToHash, cnSelection);
 	}
-	return hash[17].trim256();;
+	return hash[GhostRiderSchedule::ROUNDS-1].trim256();
+}
+
+template<typename T1>
+inline uint256 HashGR(const T1 pbegin, const T1 pend, const GhostRiderSchedule& schedule)
+{
+	static unsigned char pblank[1];
+
+	uint512 hash[GhostRiderSchedule::ROUNDS];
+	const void *toHash = (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0]));
+	coreHash(toHash, &hash[0], (pend - pbegin) * sizeof(pbegin[0]), schedule.algo[0]);
+	return HashGRRounds(hash, schedule);
 }
+
+template<typename T1>
+inline uint256 HashGR(const T1 pbegin, const T1 pend, const uint256& PrevBlockHash)
+{
+	return HashGR(pbegin, pend, GetGhostRiderSchedule(PrevBlockHash));
+}
+
+/**
+ * GhostRider of the header midstate was built from, with its nonce replaced
+ * by nNonce. nNonce is the value of CBlockHeader::nNonce; it is serialized
+ * little-endian here, as in the header.
+ */
+inline uint256 HashGR(const GhostRiderMidstate& midstate, uint32_t nNonce)
+{
+	uint512 hash[GhostRiderSchedule::ROUNDS];
+	const uint32_t nNonceLE = htole32(nNonce);
+	midstate.first.Finalize(&nNonceLE, sizeof(nNonceLE), &hash[0]);
+	return HashGRRounds(hash, midstate.schedule);
+}
+
+/**
+ * GhostRider of n inputs of len bytes each, inputs[i] hashed with
+ * schedules[i] into outputs[i]. Each round hashes all inputs whose schedule
+ * picked the same core algorithm together with coreHashN().
+ */
+void HashGRBatch(const void* const inputs[], size_t len, const GhostRiderSchedule schedules[], uint256 outputs[], size_t n);
+
+/**
+ * HashGR(midstate, nonces[i]) into outputs[i] for n nonces, with the rounds
+ * after the first batched as in HashGRBatch().
+ */
+void HashGRBatch(const GhostRiderMidstate& midstate, const uint32_t nonces[], uint256 outputs[], size_t n);
 #endif // BITCOIN_HASH_H
@@ -6,15 +6,35 @@
  *      Author: tri
  */
 
+#if defined(HAVE_CONFIG_H)
+#include <config/but-config.h>
+#endif
+
 #include <hash_selection.h>
-#include <cryptonote/cryptonight_dark.h>
-#include <cryptonote/cryptonight_dark_lite.h>
-#include <cryptonote/cryptonight_fast.h>
-#include <cryptonote/cryptonight.h>
-#include <cryptonote/cryptonight_lite.h>
-#include <cryptonote/cryptonight_soft_shell.h>
-#include <cryptonote/cryptonight_turtle.h>
-#include <cryptonote/cryptonight_turtle_lite.h>
+#include <cryptonote/cryptonight_engine.h>
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if (defined(ENABLE_AVX2) || defined(ENABLE_AVX512F)) && !defined(BUILD_BITCOIN_INTERNAL)
+#include <cpuid.h>
+#endif
+#endif
+
+namespace corehash_avx2
+{
+void Blake512_4way(unsigned char* out, const unsigned char* in);
+void Keccak512_4way(unsigned char* out, const unsigned char* in);
+void Skein512_4way(unsigned char* out, const unsigned char* in);
+}
+
+namespace corehash_avx512
+{
+void Blake512_8way(unsigned char* out, const unsigned char* in);
+void Keccak512_8way(unsigned char* out, const unsigned char* in);
+void Skein512_8way(unsigned char* out, const unsigned char* in);
+}
 
 std::vector<std::vector<int>> GR_GROUP = {
 		{0,1,2,3,4},
@@ -22,204 +42,315 @@ std::vector<std::vector<int>> GR_GROUP = {
 		{10,11,12,13,14}
 };
 
-//int HashSelection::getHashSelection(int index) {
-//	assert(index >= 0);
-//	assert(index < size);
-//	const int startNibblesHash = 64 - size;
-//	int hashSelection = PrevBlockHash.GetNibble(startNibblesHash + index);
-//	hashSelection = hashSelection % size;
-//	return(hashSelection);
-//}
-
-//int HashSelection::getGroupHashSelection(uint256 blockHash) {
-//	return blockHash.GetNibble(60);
-//}
-
-std::vector<int> HashSelection::getRandomIndexes(std::vector<int> indexes) {
-	std::vector<int> groupIndexes;
-	unsigned int totalIndexes = indexes.size();
-	unsigned int indexCount = 0;
-	int i = 63;
-	//printf("%d index=", totalIndexes);
-	for(; i >=0; i--) {
-		unsigned int hashSelection = this->PrevBlockHash.GetNibble(i);
-		if(hashSelection >= totalIndexes) {
-			hashSelection = hashSelection % totalIndexes;
-		}
-		int index = indexes[hashSelection];
-		if(index >=0)  {
-			//printf("%d,", index);
-			groupIndexes.push_back(index);
-			indexes[hashSelection] = -1;
-			indexCount++;
+static const char* const GR_ALGO_NAMES[16] = {
+		"Blake",      //0
+		"Bmw",        //1
+		"Groestl",    //2
+		"Jh",         //3
+		"Keccak",     //4
+		"Skein",      //5
+		"Luffa",      //6
+		"Cubehash",   //7
+		"Shavite",    //8
+		"Simd",       //9
+		"Echo",       //A
+		"Jamsi",      //B
+		"Fugue",      //C
+		"Shabal",     //D
+		"Whirlpool",  //E
+		"Sha512"      //F
+};
+
+static const char* const GR_CN_NAMES[6] = {
+		"CNDark",        //0
+		"CNDarklite",    //1
+		"CNFast",        //2
+		"CNLite",        //3
+		"CNTurtle",      //4
+		"CNTurtlelite"   //5
+};
+
+/**
+ * Shuffle 0..count-1 into order: walk the nibbles of the previous block hash
+ * from the most significant one, taking each (nibble % count) that has not
+ * been taken yet, then append whatever is left in ascending order.
+ */
+static void GetRandomIndexes(const uint256& prevBlockHash, int count, uint8_t* order) {
+	bool taken[16] = {false};
+	int indexCount = 0;
+	for(int i = 63; i >= 0 && indexCount < count; i--) {
+		unsigned int hashSelection = prevBlockHash.GetNibble(i) % count;
+		if(!taken[hashSelection]) {
+			taken[hashSelection] = true;
+			order[indexCount++] = hashSelection;
 		}
-		if(indexCount == indexes.size()) {
-			break;
+	}
+	for(int j = 0; j < count && indexCount < count; j++) {
+		if(!taken[j]) {
+			order[indexCount++] = j;
 		}
 	}
-	//printf("indexCount=%d------------------------\n",indexCount);
-	if(i < 0 && indexCount < totalIndexes) {
-		for(unsigned int j=0; j<indexes.size(); j++) {
-			int index = indexes[j];
-			if(index >=0) {
-				//printf("%d,", index);
-				groupIndexes.push_back(index);
-			}
+}
+
+void ComputeGhostRiderSchedule(const uint256& prevBlockHash, GhostRiderSchedule& schedule) {
+	uint8_t cnIndexes[GhostRiderSchedule::CN_VARIANTS];
+	uint8_t algoIndexes[GhostRiderSchedule::CORE_ALGOS];
+	GetRandomIndexes(prevBlockHash, GhostRiderSchedule::CN_VARIANTS, cnIndexes);
+	GetRandomIndexes(prevBlockHash, GhostRiderSchedule::CORE_ALGOS, algoIndexes);
+
+	int core = 0, cn = 0;
+	for(int i = 0; i < GhostRiderSchedule::ROUNDS; i++) {
+		if(GhostRiderSchedule::IsCryptonightRound(i)) {
+			schedule.algo[i] = cnIndexes[cn++];
+		} else {
+			schedule.algo[i] = algoIndexes[core++];
 		}
 	}
-	return groupIndexes;
 }
 
-std::string HashSelection::getHashSelectionString() {
+GhostRiderSchedule GetGhostRiderSchedule(const uint256& prevBlockHash) {
+	// Plain data only, so that the thread_local needs no destructor
+	static thread_local uint256 cachedPrevBlockHash;
+	static thread_local GhostRiderSchedule cachedSchedule;
+	static thread_local bool cached = false;
+
+	if(!cached || cachedPrevBlockHash != prevBlockHash) {
+		ComputeGhostRiderSchedule(prevBlockHash, cachedSchedule);
+		cachedPrevBlockHash = prevBlockHash;
+		cached = true;
+	}
+	return cachedSchedule;
+}
+
+std::string GhostRiderSchedule::ToString() const {
 	std::string selectedAlgoes;
-	int i = 0;
-	for(; i < 5; i++) {
-		//int hashSelection = getHashSelection(i);
-		int selectedAlgoIndex = this->algoIndexes[i];
-		std::string selectedAlgo = this->algoMap[selectedAlgoIndex];
-		selectedAlgoes.append(selectedAlgo);
-	}
-	std::string selectedCN_1 = this->cnVariantMap[this->cnIndexes[0]];
-	selectedAlgoes.append(selectedCN_1);
-	for(; i < 10; i++) {
-		//int hashSelection = getHashSelection(i);
-		int selectedAlgoIndex = this->algoIndexes[i];
-		std::string selectedAlgo = this->algoMap[selectedAlgoIndex];
-		selectedAlgoes.append(selectedAlgo);
-	}
-	std::string selectedCN_2 =  this->cnVariantMap[this->cnIndexes[1]];
-	selectedAlgoes.append(selectedCN_2);
-	for(; i < 15; i++) {
-		//int hashSelection = getHashSelection(i);
-		int selectedAlgoIndex = this->algoIndexes[i];
-		std::string selectedAlgo = this->algoMap[selectedAlgoIndex];
-		selectedAlgoes.append(selectedAlgo);
-	}
-	std::string selectedCN_3 =  this->cnVariantMap[this->cnIndexes[2]];
-	selectedAlgoes.append(selectedCN_3);
+	for(int i = 0; i < ROUNDS; i++) {
+		selectedAlgoes.append(IsCryptonightRound(i) ? GR_CN_NAMES[algo[i]] : GR_ALGO_NAMES[algo[i]]);
+	}
 	return selectedAlgoes;
 }
+
+namespace {
+
+/** The sph streaming interface of one core algorithm */
+struct CoreHashAlgo {
+	size_t contextSize;
+	void (*init)(void *cc);
+	void (*update)(void *cc, const void *data, size_t len);
+	void (*close)(void *cc, void *dst);
+};
+
+#define CORE_HASH_ALGO(name, context) { sizeof(context), name##_init, name, name##_close }
+
+const CoreHashAlgo CORE_HASH_ALGOS[16] = {
+		CORE_HASH_ALGO(sph_blake512, sph_blake512_context),        //0
+		CORE_HASH_ALGO(sph_bmw512, sph_bmw512_context),            //1
+		CORE_HASH_ALGO(sph_groestl512, sph_groestl512_context),    //2
+		CORE_HASH_ALGO(sph_jh512, sph_jh512_context),              //3
+		CORE_HASH_ALGO(sph_keccak512, sph_keccak512_context),      //4
+		CORE_HASH_ALGO(sph_skein512, sph_skein512_context),        //5
+		CORE_HASH_ALGO(sph_luffa512, sph_luffa512_context),        //6
+		CORE_HASH_ALGO(sph_cubehash512, sph_cubehash512_context),  //7
+		CORE_HASH_ALGO(sph_shavite512, sph_shavite512_context),    //8
+		CORE_HASH_ALGO(sph_simd512, sph_simd512_context),          //9
+		CORE_HASH_ALGO(sph_echo512, sph_echo512_context),          //A
+		CORE_HASH_ALGO(sph_hamsi512, sph_hamsi512_context),        //B
+		CORE_HASH_ALGO(sph_fugue512, sph_fugue512_context),        //C
+		CORE_HASH_ALGO(sph_shabal512, sph_shabal512_context),      //D
+		CORE_HASH_ALGO(sph_whirlpool, sph_whirlpool_context),      //E
+		CORE_HASH_ALGO(sph_sha512, sph_sha512_context)             //F
+};
+
+#undef CORE_HASH_ALGO
+
+/**
+ * Every core algorithm's context right after init. They are the same for all
+ * threads, so they are built once and each hash starts from a copy.
+ */
+struct CoreHashInitStates {
+	CoreHashContext state[16];
+
+	CoreHashInitStates() {
+		for(int i = 0; i < 16; i++) {
+			CORE_HASH_ALGOS[i].init(&state[i]);
+		}
+	}
+};
+
+const CoreHashContext& GetInitState(int hashSelection) {
+	static const CoreHashInitStates initStates;
+	return initStates.state[hashSelection];
+}
+
+/** Hashes the 64 byte messages in[0..N-1] into out[0..N-1] at once */
+typedef void (*CoreHashBatch)(unsigned char* out, const unsigned char* in);
+
+/** Lane parallel kernels per core algorithm, set up by CoreHashAutoDetect() */
+CoreHashBatch coreHash4way[16] = {nullptr};
+CoreHashBatch coreHash8way[16] = {nullptr};
+
+} // namespace
+
 void coreHash(const void *toHash, uint512* hash, int lenToHash, int hashSelection) {
-	sph_blake512_context     ctx_blake;      //0
-	sph_bmw512_context       ctx_bmw;        //1
-	sph_groestl512_context   ctx_groestl;    //2
-	sph_jh512_context        ctx_jh;         //3
-	sph_keccak512_context    ctx_keccak;     //4
-	sph_skein512_context     ctx_skein;      //5
-	sph_luffa512_context     ctx_luffa;      //6
-	sph_cubehash512_context  ctx_cubehash;   //7
-	sph_shavite512_context   ctx_shavite;    //8
-	sph_simd512_context      ctx_simd;       //9
-	sph_echo512_context      ctx_echo;       //A
-	sph_hamsi512_context     ctx_hamsi;      //B
-	sph_fugue512_context     ctx_fugue;      //C
-	sph_shabal512_context    ctx_shabal;     //D
-	sph_whirlpool_context    ctx_whirlpool;  //E
-	sph_sha512_context       ctx_sha512;     //F
-	switch(hashSelection) {
-		case 0:
-			sph_blake512_init(&ctx_blake);
-			sph_blake512 (&ctx_blake, toHash, lenToHash);
-			sph_blake512_close(&ctx_blake, static_cast<void*>(hash));
-			break;
-		case 1:
-			sph_bmw512_init(&ctx_bmw);
-			sph_bmw512 (&ctx_bmw, toHash, lenToHash);
-			sph_bmw512_close(&ctx_bmw, static_cast<void*>(hash));
-			break;
-		case 2:
-			sph_groestl512_init(&ctx_groestl);
-			sph_groestl512 (&ctx_groestl, toHash, lenToHash);
-			sph_groestl512_close(&ctx_groestl, static_cast<void*>(hash));
-			break;
-		case 3:
-			sph_jh512_init(&ctx_jh);
-			sph_jh512 (&ctx_jh, toHash, lenToHash);
-			sph_jh512_close(&ctx_jh, static_cast<void*>(hash));
-			break;
-		case 4:
-			sph_keccak512_init(&ctx_keccak);
-			sph_keccak512 (&ctx_keccak, toHash, lenToHash);
-			sph_keccak512_close(&ctx_keccak, static_cast<void*>(hash));
-			break;
-		case 5:
-			sph_skein512_init(&ctx_skein);
-			sph_skein512 (&ctx_skein, toHash, lenToHash);
-			sph_skein512_close(&ctx_skein, static_cast<void*>(hash));
-			break;
-		case 6:
-			sph_luffa512_init(&ctx_luffa);
-			sph_luffa512 (&ctx_luffa, toHash, lenToHash);
-			sph_luffa512_close(&ctx_luffa, static_cast<void*>(hash));
-			break;
-		case 7:
-			sph_cubehash512_init(&ctx_cubehash);
-			sph_cubehash512 (&ctx_cubehash, toHash, lenToHash);
-			sph_cubehash512_close(&ctx_cubehash, static_cast<void*>(hash));
-			break;
-		case 8:
-			sph_shavite512_init(&ctx_shavite);
-			sph_shavite512(&ctx_shavite, toHash, lenToHash);
-			sph_shavite512_close(&ctx_shavite, static_cast<void*>(hash));
-			break;
-		case 9:
-			sph_simd512_init(&ctx_simd);
-			sph_simd512 (&ctx_simd, toHash, lenToHash);
-			sph_simd512_close(&ctx_simd, static_cast<void*>(hash));
-			break;
-		case 10:
-			sph_echo512_init(&ctx_echo);
-			sph_echo512 (&ctx_echo, toHash, lenToHash);
-			sph_echo512_close(&ctx_echo, static_cast<void*>(hash));
-			break;
-	   case 11:
-			sph_hamsi512_init(&ctx_hamsi);
-			sph_hamsi512 (&ctx_hamsi, toHash, lenToHash);
-			sph_hamsi512_close(&ctx_hamsi, static_cast<void*>(hash));
-			break;
-	   case 12:
-			sph_fugue512_init(&ctx_fugue);
-			sph_fugue512 (&ctx_fugue, toHash, lenToHash);
-			sph_fugue512_close(&ctx_fugue, static_cast<void*>(hash));
-			break;
-	   case 13:
-			sph_shabal512_init(&ctx_shabal);
-			sph_shabal512 (&ctx_shabal, toHash, lenToHash);
-			sph_shabal512_close(&ctx_shabal, static_cast<void*>(hash));
-			break;
-	   case 14:
-			sph_whirlpool_init(&ctx_whirlpool);
-			sph_whirlpool(&ctx_whirlpool, toHash, lenToHash);
-			sph_whirlpool_close(&ctx_whirlpool, static_cast<void*>(hash));
-			break;
-	   case 15:
-			sph_sha512_init(&ctx_sha512);
-			sph_sha512 (&ctx_sha512, toHash, lenToHash);
-			sph_sha512_close(&ctx_sha512, static_cast<void*>(hash));
-			break;
+	if(hashSelection < 0 || hashSelection >= 16) {
+		return;
+	}
+	const CoreHashAlgo& algo = CORE_HASH_ALGOS[hashSelection];
+	CoreHashContext ctx;
+	memcpy(&ctx, &GetInitState(hashSelection), algo.contextSize);
+	algo.update(&ctx, toHash, lenToHash);
+	algo.close(&ctx, static_cast<void*>(hash));
+}
+
+void coreHashN(const uint512* inputs, uint512* outputs, size_t n, int hashSelection) {
+	if(hashSelection < 0 || hashSelection >= 16) {
+		return;
+	}
+	size_t i = 0;
+	if(CoreHashBatch batch = coreHash8way[hashSelection]) {
+		for(; i + 8 <= n; i += 8) {
+			batch(outputs[i].begin(), inputs[i].begin());
+		}
+	}
+	if(CoreHashBatch batch = coreHash4way[hashSelection]) {
+		for(; i + 4 <= n; i += 4) {
+			batch(outputs[i].begin(), inputs[i].begin());
+		}
+	}
+	for(; i < n; i++) {
+		coreHash(&inputs[i], &outputs[i], 64, hashSelection);
+	}
+}
+
+namespace {
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if (defined(ENABLE_AVX2) || defined(ENABLE_AVX512F)) && !defined(BUILD_BITCOIN_INTERNAL)
+/** Return the XCR0 bits the OS has enabled, which say what register state it saves. */
+uint32_t GetXCR0()
+{
+	uint32_t a, d;
+	__asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+	return a;
+}
+#endif
+#endif
+
+/** Check every installed kernel against coreHash() */
+bool CoreHashSelfTest() {
+	uint512 in[8], batched[8], expected;
+	for(int i = 0; i < 8; i++) {
+		for(int j = 0; j < 64; j++) {
+			in[i].begin()[j] = (unsigned char)(i * 64 + j * 7);
+		}
 	}
+	for(int algo = 0; algo < 16; algo++) {
+		CoreHashBatch batches[2] = {coreHash4way[algo], coreHash8way[algo]};
+		int lanes[2] = {4, 8};
+		for(int b = 0; b < 2; b++) {
+			if(!batches[b]) continue;
+			batches[b](batched[0].begin(), in[0].begin());
+			for(int i = 0; i < lanes[b]; i++) {
+				coreHash(&in[i], &expected, 64, algo);
+				if(batched[i] != expected) return false;
+			}
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+std::string CoreHashAutoDetect() {
+	std::string ret = "standard";
+	for(int i = 0; i < 16; i++) {
+		coreHash4way[i] = nullptr;
+		coreHash8way[i] = nullptr;
+	}
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if (defined(ENABLE_AVX2) || defined(ENABLE_AVX512F)) && !defined(BUILD_BITCOIN_INTERNAL)
+	uint32_t eax, ebx, ecx, edx;
+	__cpuid(1, eax, ebx, ecx, edx);
+	const bool have_xsave = (ecx >> 27) & 1;
+	const bool have_avx = (ecx >> 28) & 1;
+	const uint32_t xcr0 = (have_xsave && have_avx) ? GetXCR0() : 0;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	const bool have_avx2 = ((ebx >> 5) & 1) && (xcr0 & 0x06) == 0x06;
+	const bool have_avx512f = ((ebx >> 16) & 1) && (xcr0 & 0xe6) == 0xe6;
+	(void)have_avx2;
+	(void)have_avx512f;
+
+#if defined(ENABLE_AVX2)
+	if(have_avx2) {
+		coreHash4way[0] = corehash_avx2::Blake512_4way;
+		coreHash4way[4] = corehash_avx2::Keccak512_4way;
+		coreHash4way[5] = corehash_avx2::Skein512_4way;
+		ret = "avx2(4way)";
+	}
+#endif
+#if defined(ENABLE_AVX512F)
+	if(have_avx512f) {
+		coreHash8way[0] = corehash_avx512::Blake512_8way;
+		coreHash8way[4] = corehash_avx512::Keccak512_8way;
+		coreHash8way[5] = corehash_avx512::Skein512_8way;
+		ret = (ret == "standard") ? "avx512f(8way)" : ret + ",avx512f(8way)";
+	}
+#endif
+#endif
+#endif
+
+	// A kernel that disagrees with the portable code is not used; init logs the backend
+	if(ret != "standard" && !CoreHashSelfTest()) {
+		for(int i = 0; i < 16; i++) {
+			coreHash4way[i] = nullptr;
+			coreHash8way[i] = nullptr;
+		}
+		ret = "standard, " + ret + " self-test failed";
+	}
+	return ret;
+}
+
+void CoreHashMidstate::Init(int hashSelection, const void *prefix, int lenPrefix) {
+	assert(hashSelection >= 0 && hashSelection < 16);
+	algo = hashSelection;
+	memcpy(&ctx, &GetInitState(algo), CORE_HASH_ALGOS[algo].contextSize);
+	CORE_HASH_ALGOS[algo].update(&ctx, prefix, lenPrefix);
+}
+
+void CoreHashMidstate::Finalize(const void *tail, int lenTail, uint512* hash) const {
+	assert(algo >= 0);
+	const CoreHashAlgo& coreAlgo = CORE_HASH_ALGOS[algo];
+	CoreHashContext work;
+	memcpy(&work, &ctx, coreAlgo.contextSize);
+	coreAlgo.update(&work, tail, lenTail);
+	coreAlgo.close(&work, static_cast<void*>(hash));
+}
+
+void GhostRiderMidstate::Init(const void *header, const uint256& prevBlockHash) {
+	schedule = GetGhostRiderSchedule(prevBlockHash);
+	first.Init(schedule.algo[0], header, 76);
 }
 
 void cnHash(uint512* toHash, uint512* hash, int lenToHash, int hashSelection){
 	switch(hashSelection)
 	{
 	 case 0:
-		cryptonightdark_hash(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
+		cryptonight::Hash<cryptonight::Dark>(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
 		break;
 	 case 1:
-		cryptonightdarklite_hash(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
+		cryptonight::Hash<cryptonight::DarkLite>(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
 		break;
 	 case 2:
-		cryptonightfast_hash(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
+		cryptonight::Hash<cryptonight::Fast>(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
 		break;
 	 case 3:
-		cryptonightlite_hash(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
+		cryptonight::Hash<cryptonight::Lite>(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
 		break;
 	 case 4:
-		cryptonightturtle_hash(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
+		cryptonight::Hash<cryptonight::Turtle>(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
 		break;
 	 case 5:
-		cryptonightturtlelite_hash(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
+		cryptonight::Hash<cryptonight::TurtleLite>(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
 		break;
 	}
 }
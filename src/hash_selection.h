@@ -12,6 +12,7 @@
 #define BUT_SELECTION_H_
 
 #include <uint256.h>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -36,58 +37,99 @@ extern "C" {
 
 extern std::vector<std::vector<int>> GR_GROUP;
 
+/** Room for the context of any of the core algorithms */
+union CoreHashContext {
+	sph_blake512_context     blake;      //0
+	sph_bmw512_context       bmw;        //1
+	sph_groestl512_context   groestl;    //2
+	sph_jh512_context        jh;         //3
+	sph_keccak512_context    keccak;     //4
+	sph_skein512_context     skein;      //5
+	sph_luffa512_context     luffa;      //6
+	sph_cubehash512_context  cubehash;   //7
+	sph_shavite512_context   shavite;    //8
+	sph_simd512_context      simd;       //9
+	sph_echo512_context      echo;       //A
+	sph_hamsi512_context     hamsi;      //B
+	sph_fugue512_context     fugue;      //C
+	sph_shabal512_context    shabal;     //D
+	sph_whirlpool_context    whirlpool;  //E
+	sph_sha512_context       sha512;     //F
+};
+
 void coreHash(const void *toHash, uint512* hash, int lenToHash, int hashSelection);
 void cnHash(uint512* toHash, uint512* hash, int lenToHash, int hashSelection);
 
-class HashSelection {
+/**
+ * coreHash() of n independent 64 byte messages at once: outputs[i] is the
+ * hash of inputs[i]. Blake, Keccak and Skein run 4 or 8 messages in parallel
+ * when CoreHashAutoDetect() found AVX2 or AVX-512, everything else falls back
+ * to one coreHash() per message. outputs may be the same array as inputs.
+ */
+void coreHashN(const uint512* inputs, uint512* outputs, size_t n, int hashSelection);
+
+/**
+ * Autodetect the best available coreHashN() kernels and check them against
+ * coreHash(); ones that fail are not used. Returns their name.
+ */
+std::string CoreHashAutoDetect();
+
+/**
+ * A core algorithm that has already absorbed a fixed prefix, to be finished
+ * with different tails. For an 80 byte header whose nonce is the only thing
+ * changing this skips every block that lies entirely in front of the nonce.
+ */
+class CoreHashMidstate {
 public:
-	HashSelection(const uint256 prevBlockHash, const std::vector<int> algoIndexes, std::vector<int> cnIndexes) {
-		this->PrevBlockHash = prevBlockHash;
-		this->algoMap = {
-				"Blake",      //0
-				"Bmw",        //1
-				"Groestl",    //2
-				"Jh",         //3
-				"Keccak",     //4
-				"Skein",      //5
-				"Luffa",      //6
-				"Cubehash",   //7
-				"Shavite",    //8
-				"Simd",       //9
-				"Echo",       //A
-				"Jamsi",      //B
-				"Fugue",      //C
-				"Shabal",     //D
-				"Whirlpool",  //E
-				"Sha512"     //F
-		};
-		this->cnVariantMap = {
-				"CNDark",        //0
-				"CNDarklite",    //1
-				"CNFast",        //2
-				"CNLite",        //3
-				"CNTurtle",      //4
-				"CNTurtlelite"   //5
-
-		};
-		//printf("before getRandomIndexes cnIndexes\n");
-		this->cnIndexes = this->getRandomIndexes(cnIndexes);
-		//printf("before getRandomIndexes cnIndexes\n");
-		this->algoIndexes = this->getRandomIndexes(algoIndexes);
-	}
-//	int getHashSelection(int index);
-//	static int getGroupHashSelection(uint256 blockHash);
-	std::vector<int> getRandomIndexes(std::vector<int> indexes);
-	std::string getHashSelectionString();
-	std::vector<int> getCnIndexes() {return  this->cnIndexes;}
-	std::vector<int> getAlgoIndexes() {return this->algoIndexes;}
-protected:
-	uint256 PrevBlockHash;
-	std::vector<int> algoIndexes;
-	std::vector<int> cnIndexes;
-	std::vector<std::string> cnVariantMap;
-	std::vector<std::string> algoMap;
+	CoreHashMidstate() : algo(-1) {}
+
+	void Init(int hashSelection, const void *prefix, int lenPrefix);
+	/** Hash prefix || tail into hash; the midstate itself is left untouched */
+	void Finalize(const void *tail, int lenTail, uint512* hash) const;
+
+private:
+	int algo;
+	CoreHashContext ctx;
+};
+
+/**
+ * The order in which GhostRider chains its 18 rounds: fifteen core algorithms
+ * (coreHash() 0..14) with a CryptoNight variant (cnHash() 0..5) after every
+ * fifth. It only depends on the previous block hash, so it is computed once
+ * per parent and then reused for every header built on top of it.
+ */
+struct GhostRiderSchedule {
+	static const int ROUNDS = 18;
+	static const int CORE_ALGOS = 15;
+	static const int CN_VARIANTS = 6;
+
+	/** coreHash() selection for core rounds, cnHash() selection for CryptoNight rounds */
+	uint8_t algo[ROUNDS];
+
+	static bool IsCryptonightRound(int round) { return round == 5 || round == 11 || round == 17; }
+
+	std::string ToString() const;
+};
+
+/** Build the GhostRider schedule for blocks on top of prevBlockHash. */
+void ComputeGhostRiderSchedule(const uint256& prevBlockHash, GhostRiderSchedule& schedule);
+
+/**
+ * Return the GhostRider schedule for prevBlockHash, reusing the one the
+ * calling thread computed last if it was for the same parent.
+ */
+GhostRiderSchedule GetGhostRiderSchedule(const uint256& prevBlockHash);
+
+/**
+ * GhostRider over an 80 byte block header of which only nNonce, the last
+ * four bytes, changes: the schedule plus the first round's midstate over the
+ * 76 bytes in front of the nonce. See HashGR(const GhostRiderMidstate&, uint32_t).
+ */
+struct GhostRiderMidstate {
+	GhostRiderSchedule schedule;
+	CoreHashMidstate first;
 
+	void Init(const void *header, const uint256& prevBlockHash);
 };
 
 #endif /* BUT_SELECTION_H_ */
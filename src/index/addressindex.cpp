@@ -0,0 +1,148 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addressindex.h>
+
+#include <chain.h>
+#include <hash.h>
+#include <primitives/block.h>
+#include <script/script.h>
+#include <spentindex.h>
+#include <txdb.h>
+#include <undo.h>
+#include <util.h>
+#include <validation.h>
+
+std::unique_ptr<AddressIndex> g_addressindex;
+
+int GetIndexAddress(const CScript& script, uint160& hashBytes)
+{
+    if (script.IsPayToScriptHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin()+2, script.begin()+22));
+        return 2;
+    } else if (script.IsPayToPublicKeyHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin()+3, script.begin()+23));
+        return 1;
+    } else if (script.IsPayToPublicKey()) {
+        hashBytes = Hash160(script.begin()+1, script.end()-1);
+        return 1;
+    }
+    hashBytes.SetNull();
+    return 0;
+}
+
+/**
+ * Collect the address index entries of a block and its unspent index changes,
+ * in the order ConnectBlock spends and adds coins, or with fRevert the order
+ * DisconnectBlock undoes them in. Both lists carry the same amounts either way,
+ * so that reverting a block takes back exactly what writing it added to the
+ * balance totals.
+ */
+static bool GetBlockAddressEntries(const CBlock& block, const CBlockUndo& blockundo, int nHeight, bool fRevert,
+                                   std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex,
+                                   std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& addressUnspentIndex)
+{
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block and undo data inconsistent", __func__);
+
+    for (size_t n = 0; n < block.vtx.size(); n++) {
+        const size_t i = fRevert ? block.vtx.size() - 1 - n : n;
+        const CTransaction& tx = *block.vtx[i];
+        const uint256 txhash = tx.GetHash();
+
+        auto spends = [&]() {
+            if (tx.IsCoinBase())
+                return true;
+            const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+            if (txundo.vprevout.size() != tx.vin.size())
+                return error("%s: transaction and undo data inconsistent", __func__);
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const COutPoint& prevout = tx.vin[j].prevout;
+                const Coin& coin = txundo.vprevout[j];
+                uint160 hashBytes;
+                const int addressType = GetIndexAddress(coin.out.scriptPubKey, hashBytes);
+                if (addressType == 0)
+                    continue;
+
+                // spending activity, and the output leaving (or with fRevert returning to) the unspent index
+                addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, nHeight, i, txhash, j, true), coin.out.nValue * -1));
+                addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, prevout.hash, prevout.n),
+                    fRevert ? CAddressUnspentValue(coin.out.nValue, coin.out.scriptPubKey, coin.nHeight) : CAddressUnspentValue()));
+            }
+            return true;
+        };
+
+        auto receives = [&]() {
+            for (size_t k = 0; k < tx.vout.size(); k++) {
+                const CTxOut& out = tx.vout[k];
+                uint160 hashBytes;
+                const int addressType = GetIndexAddress(out.scriptPubKey, hashBytes);
+                if (addressType == 0)
+                    continue;
+
+                // receiving activity, and the new unspent output
+                addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, nHeight, i, txhash, k, false), out.nValue));
+                addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, txhash, k),
+                    fRevert ? CAddressUnspentValue() : CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight)));
+            }
+        };
+
+        if (fRevert) {
+            receives();
+            if (!spends())
+                return false;
+        } else {
+            if (!spends())
+                return false;
+            receives();
+        }
+    }
+    return true;
+}
+
+bool AddressIndex::Init(CBlockLocator& locator)
+{
+    bool fHadBalances = false;
+    pblocktree->ReadFlag("addressbalanceindex", fHadBalances);
+
+    // The balance totals are only right if every block since genesis was added to them
+    if (fAddressBalanceIndex && !fHadBalances)
+        locator.SetNull();
+
+    if (locator.IsNull() || fHadBalances != fAddressBalanceIndex) {
+        if (locator.IsNull()) {
+            // Forget the old locator first, so that an interrupted switch still rebuilds from genesis
+            CDBBatch batch(*pblocktree);
+            pblocktree->WriteIndexLocator(batch, GetName(), locator);
+            if (!pblocktree->WriteBatch(batch))
+                return error("%s: failed to reset the %s locator", __func__, GetName());
+        }
+        LogPrintf("%s: address balance index %s\n", __func__, fAddressBalanceIndex ? "enabled, rebuilding the address index" : "disabled");
+        if (!pblocktree->EraseAddressBalances())
+            return error("%s: failed to erase the address balances", __func__);
+        if (!pblocktree->WriteFlag("addressbalanceindex", fAddressBalanceIndex))
+            return error("%s: failed to write the address balance index flag", __func__);
+    }
+    return true;
+}
+
+bool AddressIndex::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    if (!GetBlockAddressEntries(block, blockundo, pindex->nHeight, false, addressIndex, addressUnspentIndex))
+        return false;
+    pblocktree->AddressIndexesToBatch(batch, addressIndex, false, addressUnspentIndex, fAddressBalanceIndex);
+    return true;
+}
+
+bool AddressIndex::RevertBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    if (!GetBlockAddressEntries(block, blockundo, pindex->nHeight, true, addressIndex, addressUnspentIndex))
+        return false;
+    pblocktree->AddressIndexesToBatch(batch, addressIndex, true, addressUnspentIndex, fAddressBalanceIndex);
+    return true;
+}
@@ -0,0 +1,39 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_ADDRESSINDEX_H
+#define BITCOIN_INDEX_ADDRESSINDEX_H
+
+#include <index/base.h>
+
+#include <memory>
+
+class CScript;
+class uint160;
+
+/**
+ * Address type of a script for the address and spent indexes: 1 for
+ * pay-to-pubkey(-hash), 2 for pay-to-script-hash, or 0 if the script pays to
+ * no address. hashBytes is set to the hash of the address, or null.
+ */
+int GetIndexAddress(const CScript& script, uint160& hashBytes);
+
+/**
+ * -addressindex: the activity and unspent outputs of every address and, with
+ * -addressbalanceindex, their balance totals.
+ */
+class AddressIndex : public BaseIndex
+{
+protected:
+    bool Init(CBlockLocator& locator) override;
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex) override;
+    bool RevertBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex) override;
+
+public:
+    const char* GetName() const override { return "addressindex"; }
+};
+
+extern std::unique_ptr<AddressIndex> g_addressindex;
+
+#endif // BITCOIN_INDEX_ADDRESSINDEX_H
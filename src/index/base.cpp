@@ -0,0 +1,224 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/base.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <init.h>
+#include <primitives/block.h>
+#include <tinyformat.h>
+#include <txdb.h>
+#include <ui_interface.h>
+#include <undo.h>
+#include <util.h>
+#include <utiltime.h>
+#include <validation.h>
+#include <warnings.h>
+
+#include <functional>
+
+/** How long the thread sleeps between looks at the chain when nothing woke it */
+static const int64_t INDEX_IDLE_WAIT_MS = 1000;
+
+template<typename... Args>
+static void FatalError(const char* fmt, const Args&... args)
+{
+    std::string strMessage = tfm::format(fmt, args...);
+    SetMiscWarning(strMessage);
+    LogPrintf("*** %s\n", strMessage);
+    uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details"),
+        "", CClientUIInterface::MSG_ERROR);
+    StartShutdown();
+}
+
+BaseIndex::BaseIndex() : m_best_block_index(nullptr), m_synced(false), m_wake(false)
+{
+}
+
+BaseIndex::~BaseIndex()
+{
+    Interrupt();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+bool BaseIndex::Start()
+{
+    CBlockLocator locator;
+    if (!pblocktree->ReadIndexLocator(GetName(), locator)) {
+        // Earlier versions wrote the index inside ConnectBlock, so an index
+        // they built is complete up to the chainstate this node just loaded
+        bool fLegacy = false;
+        if (pblocktree->ReadFlag(GetName(), fLegacy) && fLegacy) {
+            LOCK(cs_main);
+            locator = chainActive.GetLocator();
+            CDBBatch batch(*pblocktree);
+            pblocktree->WriteIndexLocator(batch, GetName(), locator);
+            if (!pblocktree->WriteBatch(batch) || !pblocktree->WriteFlag(GetName(), false))
+                return InitError(strprintf(_("Failed to write the %s locator"), GetName()));
+        }
+    }
+
+    if (!Init(locator))
+        return false;
+
+    {
+        LOCK(cs_main);
+        if (locator.IsNull()) {
+            m_best_block_index = nullptr;
+        } else {
+            BlockMap::const_iterator it = mapBlockIndex.find(locator.vHave.front());
+            if (it == mapBlockIndex.end())
+                return InitError(strprintf(_("The best block of the %s is unknown, restart with -reindex to rebuild it"), GetName()));
+            m_best_block_index = it->second;
+        }
+    }
+    m_synced = false;
+    m_interrupt.reset();
+
+    RegisterValidationInterface(this);
+    m_thread = std::thread(&TraceThread<std::function<void()> >, GetName(),
+        std::function<void()>(std::bind(&BaseIndex::ThreadSync, this)));
+    return true;
+}
+
+void BaseIndex::Interrupt()
+{
+    m_interrupt();
+    Wake();
+}
+
+void BaseIndex::Stop()
+{
+    UnregisterValidationInterface(this);
+    Interrupt();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void BaseIndex::Wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wake = true;
+    }
+    m_cv.notify_all();
+}
+
+void BaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted)
+{
+    Wake();
+}
+
+void BaseIndex::BlockDisconnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindexDisconnected)
+{
+    Wake();
+}
+
+void BaseIndex::ThreadSync()
+{
+    int64_t nLastLog = 0;
+    while (!m_interrupt) {
+        const CBlockIndex* pindex = nullptr;
+        bool fRevert = false;
+        bool fAhead = false;
+        {
+            LOCK(cs_main);
+            const CBlockIndex* pbest = m_best_block_index;
+            if (pbest && !chainActive.Contains(pbest)) {
+                // Ahead of a chain that is being connected back up to it, as with
+                // -reindex-chainstate, the index waits; blocks that left the chain are reverted
+                fAhead = chainActive.Tip() && pbest->GetAncestor(chainActive.Height()) == chainActive.Tip() &&
+                    !(pbest->nStatus & BLOCK_FAILED_MASK);
+                if (!fAhead) {
+                    pindex = pbest;
+                    fRevert = true;
+                }
+            } else {
+                pindex = pbest ? chainActive.Next(pbest) : chainActive.Genesis();
+            }
+        }
+
+        if (!pindex) {
+            if (!m_synced && !fAhead) {
+                const CBlockIndex* pbest = m_best_block_index;
+                LogPrintf("%s is synced to height %d\n", GetName(), pbest ? pbest->nHeight : -1);
+                m_synced = true;
+            }
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait_for(lock, std::chrono::milliseconds(INDEX_IDLE_WAIT_MS), [this] { return m_wake || m_interrupt; });
+            m_wake = false;
+            continue;
+        }
+
+        if (!ProcessBlock(pindex, fRevert)) {
+            FatalError("%s: failed to %s block %s in the %s", __func__, fRevert ? "revert" : "write",
+                pindex->GetBlockHash().ToString(), GetName());
+            return;
+        }
+
+        if (!m_synced && GetTime() - nLastLog >= 30) {
+            LogPrintf("Building %s, at height %d\n", GetName(), pindex->nHeight);
+            nLastLog = GetTime();
+        }
+    }
+}
+
+bool BaseIndex::ProcessBlock(const CBlockIndex* pindex, bool fRevert)
+{
+    // The genesis block is never connected, so it has nothing to index
+    CBlock block;
+    CBlockUndo blockundo;
+    if (pindex->pprev && NeedsBlockData()) {
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
+            return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+        if (!UndoReadFromDisk(blockundo, pindex))
+            return error("%s: failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+
+    CDBBatch batch(*pblocktree);
+    if (pindex->pprev) {
+        if (fRevert ? !RevertBlock(batch, block, blockundo, pindex) : !WriteBlock(batch, block, blockundo, pindex))
+            return false;
+    }
+
+    const CBlockIndex* pbest = fRevert ? pindex->pprev : pindex;
+    {
+        LOCK(cs_main);
+        pblocktree->WriteIndexLocator(batch, GetName(), chainActive.GetLocator(pbest));
+    }
+    if (!pblocktree->WriteBatch(batch))
+        return error("%s: failed to write the %s", __func__, GetName());
+
+    m_best_block_index = pbest;
+    m_cv.notify_all();
+    return true;
+}
+
+bool BaseIndex::BlockUntilSyncedToHeight(int nHeight, int64_t nTimeoutMillis)
+{
+    const int64_t nDeadline = GetTimeMillis() + nTimeoutMillis;
+    {
+        LOCK(cs_main);
+        if (nHeight < 0 || nHeight > chainActive.Height())
+            nHeight = chainActive.Height();
+    }
+
+    while (true) {
+        {
+            LOCK(cs_main);
+            const CBlockIndex* ptarget = chainActive[nHeight];
+            const CBlockIndex* pbest = m_best_block_index;
+            // An index ahead of the chain may still hold blocks that left it
+            if (!ptarget || (pbest && chainActive.Contains(pbest) && pbest->nHeight >= ptarget->nHeight))
+                return true;
+        }
+        if (m_interrupt || GetTimeMillis() >= nDeadline)
+            return false;
+        // ProcessBlock notifies after every block; the timeout covers a notification that came before the wait
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait_for(lock, std::chrono::milliseconds(50));
+    }
+}
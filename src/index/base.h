@@ -0,0 +1,95 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_BASE_H
+#define BITCOIN_INDEX_BASE_H
+
+#include <threadinterrupt.h>
+#include <validationinterface.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class CBlock;
+class CBlockIndex;
+class CBlockUndo;
+class CDBBatch;
+struct CBlockLocator;
+
+/** How long index RPCs wait for an index to reach the height they ask about */
+static const int64_t DEFAULT_INDEX_RPC_WAIT_MS = 10000;
+
+/**
+ * An optional index of the active chain, kept in the block tree database by
+ * a thread of its own instead of inside ConnectBlock and DisconnectBlock.
+ *
+ * The thread moves the index block by block towards chainActive: it reverts
+ * blocks that left the active chain and writes the ones after its best
+ * block, reading them and their undo data back from disk. Every block goes
+ * to the database in one batch together with the new locator of the index,
+ * so an index is never ahead of or behind what its locator says, and an
+ * index can be switched on for a node that already has a chain and built
+ * while the node runs. BlockConnected and BlockDisconnected only wake the
+ * thread up; block connection no longer pays for the index writes.
+ */
+class BaseIndex : public CValidationInterface
+{
+private:
+    std::atomic<const CBlockIndex*> m_best_block_index;
+    std::atomic<bool> m_synced;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_wake;
+
+    CThreadInterrupt m_interrupt;
+    std::thread m_thread;
+
+    void ThreadSync();
+    bool ProcessBlock(const CBlockIndex* pindex, bool fRevert);
+    void Wake();
+
+protected:
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindexDisconnected) override;
+
+    /** Prepare the index before its thread starts; may clear locator to rebuild it from genesis */
+    virtual bool Init(CBlockLocator& locator) { return true; }
+    /** Whether WriteBlock and RevertBlock need the block and its undo data */
+    virtual bool NeedsBlockData() const { return true; }
+    /** Add the entries of a block connected after the best block of the index to batch */
+    virtual bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex) = 0;
+    /** Add the removal of the entries of the best block of the index to batch */
+    virtual bool RevertBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex) = 0;
+
+public:
+    BaseIndex();
+    virtual ~BaseIndex();
+
+    /** Name of the index, also the key of its locator */
+    virtual const char* GetName() const = 0;
+
+    /** Load the locator, register for validation callbacks and start the thread */
+    bool Start();
+    void Interrupt();
+    /** Stop the thread and unregister; the index stays where it got to */
+    void Stop();
+
+    /** Whether the index has caught up with the active chain since it started */
+    bool IsSynced() const { return m_synced; }
+    /** Best block of the index; nullptr before genesis */
+    const CBlockIndex* GetBestBlockIndex() const { return m_best_block_index; }
+
+    /**
+     * Wait until the index covers the block of the active chain at nHeight,
+     * or the tip if nHeight is negative or above it. Returns false if that
+     * did not happen within nTimeoutMillis.
+     */
+    bool BlockUntilSyncedToHeight(int nHeight, int64_t nTimeoutMillis);
+};
+
+#endif // BITCOIN_INDEX_BASE_H
@@ -0,0 +1,64 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/spentindex.h>
+
+#include <chain.h>
+#include <index/addressindex.h>
+#include <primitives/block.h>
+#include <spentindex.h>
+#include <txdb.h>
+#include <undo.h>
+#include <util.h>
+#include <validation.h>
+
+std::unique_ptr<SpentIndex> g_spentindex;
+
+/** The spent index entries of a block, or with fRevert null values that erase them */
+static bool GetBlockSpentEntries(const CBlock& block, const CBlockUndo& blockundo, int nHeight, bool fRevert,
+                                 std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >& spentIndex)
+{
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block and undo data inconsistent", __func__);
+
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+        if (txundo.vprevout.size() != tx.vin.size())
+            return error("%s: transaction and undo data inconsistent", __func__);
+
+        const uint256 txhash = tx.GetHash();
+        for (size_t j = 0; j < tx.vin.size(); j++) {
+            const COutPoint& prevout = tx.vin[j].prevout;
+            if (fRevert) {
+                spentIndex.push_back(std::make_pair(CSpentIndexKey(prevout.hash, prevout.n), CSpentIndexValue()));
+                continue;
+            }
+            // the txid and input that spent an output, and the amount and address of that input
+            const Coin& coin = txundo.vprevout[j];
+            uint160 hashBytes;
+            const int addressType = GetIndexAddress(coin.out.scriptPubKey, hashBytes);
+            spentIndex.push_back(std::make_pair(CSpentIndexKey(prevout.hash, prevout.n), CSpentIndexValue(txhash, j, nHeight, coin.out.nValue, addressType, hashBytes)));
+        }
+    }
+    return true;
+}
+
+bool SpentIndex::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    if (!GetBlockSpentEntries(block, blockundo, pindex->nHeight, false, spentIndex))
+        return false;
+    pblocktree->SpentIndexToBatch(batch, spentIndex);
+    return true;
+}
+
+bool SpentIndex::RevertBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    if (!GetBlockSpentEntries(block, blockundo, pindex->nHeight, true, spentIndex))
+        return false;
+    pblocktree->SpentIndexToBatch(batch, spentIndex);
+    return true;
+}
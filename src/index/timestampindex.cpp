@@ -0,0 +1,24 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/timestampindex.h>
+
+#include <chain.h>
+#include <spentindex.h>
+#include <txdb.h>
+#include <validation.h>
+
+std::unique_ptr<TimestampIndex> g_timestampindex;
+
+bool TimestampIndex::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    pblocktree->TimestampIndexToBatch(batch, CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash()), false);
+    return true;
+}
+
+bool TimestampIndex::RevertBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    pblocktree->TimestampIndexToBatch(batch, CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash()), true);
+    return true;
+}
@@ -0,0 +1,26 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_TIMESTAMPINDEX_H
+#define BITCOIN_INDEX_TIMESTAMPINDEX_H
+
+#include <index/base.h>
+
+#include <memory>
+
+/** -timestampindex: the hashes of the blocks of the active chain by block time */
+class TimestampIndex : public BaseIndex
+{
+protected:
+    bool NeedsBlockData() const override { return false; }
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex) override;
+    bool RevertBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex) override;
+
+public:
+    const char* GetName() const override { return "timestampindex"; }
+};
+
+extern std::unique_ptr<TimestampIndex> g_timestampindex;
+
+#endif // BITCOIN_INDEX_TIMESTAMPINDEX_H
@@ -19,10 +19,16 @@
 #include <checkpoints.h>
 #include <compat/sanity.h>
 #include <consensus/validation.h>
+#include <crypto/pow_scratch.h>
 #include <fs.h>
 #include <httpserver.h>
 #include <httprpc.h>
+#include <index/addressindex.h>
+#include <index/spentindex.h>
+#include <index/timestampindex.h>
 #include <key.h>
+#include <powalgo.h>
+#include <powcache.h>
 #include <validation.h>
 #include <miner.h>
 #include <rpc/mining.h>
@@ -41,6 +47,7 @@
 #include <timedata.h>
 #include <txdb.h>
 #include <txmempool.h>
+#include <stratum.h>
 #include <torcontrol.h>
 #include <ui_interface.h>
 #include <util.h>
@@ -97,10 +104,6 @@
 #include <zmq/zmqnotificationinterface.h>
 #endif
 
-#ifdef USE_SSE2
-#include <crypto/scrypt.h>
-#endif
-
 bool fFeeEstimatesInitialized = false;
 static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
@@ -206,7 +209,14 @@ void Interrupt(boost::thread_group& threadGroup)
     InterruptRPC();
     InterruptREST();
     InterruptTorControl();
+    InterruptStratumServer();
     llmq::InterruptLLMQSystem();
+    if (g_addressindex)
+        g_addressindex->Interrupt();
+    if (g_spentindex)
+        g_spentindex->Interrupt();
+    if (g_timestampindex)
+        g_timestampindex->Interrupt();
     if (g_connman)
         g_connman->Interrupt();
     threadGroup.interrupt_all();
@@ -231,6 +241,7 @@ void PrepareShutdown()
     StopREST();
     StopRPC();
     StopHTTPServer();
+    StopStratumServer();
     llmq::StopLLMQSystem();
 
     // fRPCInWarmup should be `false` if we completed the loading sequence
@@ -294,6 +305,20 @@ void PrepareShutdown()
     // CValidationInterface callbacks, flush them...
     GetMainSignals().FlushBackgroundCallbacks();
 
+    // The index threads stop where they got to and carry on from there on the next start
+    if (g_addressindex) {
+        g_addressindex->Stop();
+        g_addressindex.reset();
+    }
+    if (g_spentindex) {
+        g_spentindex->Stop();
+        g_spentindex.reset();
+    }
+    if (g_timestampindex) {
+        g_timestampindex->Stop();
+        g_timestampindex.reset();
+    }
+
     // Any future callbacks will be dropped. This should absolutely be safe - if
     // missing a callback results in an unrecoverable situation, unclean shutdown
     // would too. The only reason to do the above flushes is to let the wallet catch
@@ -309,6 +334,8 @@ void PrepareShutdown()
         pcoinsTip = nullptr;
         delete pcoinscatcher;
         pcoinscatcher = nullptr;
+        delete pcoinswriter;
+        pcoinswriter = nullptr;
         delete pcoinsdbview;
         pcoinsdbview = nullptr;
         delete pblocktree;
@@ -338,6 +365,10 @@ void PrepareShutdown()
         delete pdsNotificationInterface;
         pdsNotificationInterface = nullptr;
     }
+    if (g_blockTemplateManager) {
+        UnregisterValidationInterface(g_blockTemplateManager.get());
+        g_blockTemplateManager.reset();
+    }
     if (fSmartnodeMode) {
         UnregisterValidationInterface(activeSmartnodeManager);
     }
@@ -461,6 +492,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     if (showDebug) {
         strUsage += HelpMessageOpt("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize));
+        strUsage += HelpMessageOpt("-backgroundflush", strprintf("Write flushes of the coins cache to the database in the background; the coins being written use memory on top of -dbcache meanwhile (default: %u)", DEFAULT_BACKGROUND_FLUSH));
     }
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
@@ -473,7 +505,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-persistmempool", strprintf(_("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
     strUsage += HelpMessageOpt("-syncmempool", strprintf(_("Sync mempool from other nodes on start (default: %u)"), DEFAULT_SYNC_MEMPOOL));
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
-    strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+    strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script and header verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
@@ -489,11 +521,14 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), DEFAULT_TXINDEX));
 
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
+    strUsage += HelpMessageOpt("-addressbalanceindex", strprintf(_("Keep the balance and total received of every address in the address index, so getaddressbalance does not scan the address history (implies -addressindex, default: %u)"), DEFAULT_ADDRESSBALANCEINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
 
     strUsage += HelpMessageGroup(_("Set Algorithm:"));
     strUsage += HelpMessageOpt("-algo=<algo>", "Mining algorithms: sha256d, scrypt, ghostrider");
+    strUsage += HelpMessageOpt("-genaffinity", strprintf(_("Pin each internal miner thread to its own CPU (default: %u)"), DEFAULT_GENERATE_AFFINITY));
+    strUsage += HelpMessageOpt("-powhugepages", strprintf(_("Back proof of work scratchpads with explicit huge pages when the OS has some reserved, else with transparent huge pages where supported (default: %u)"), POW_SCRATCH_DEFAULT_HUGEPAGES));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open (see the `addnode` RPC command help for more info)"));
@@ -564,6 +599,9 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), DEFAULT_CHECKBLOCKS));
         strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
+        strUsage += HelpMessageOpt("-checkblockreadpow", strprintf("Recompute the proof of work hash of every block read from disk instead of using the one stored in the block index (default: %u)", DEFAULT_CHECKBLOCKREADPOW));
+        strUsage += HelpMessageOpt("-verifyindexpow", strprintf("Verify the proof of work of every header in the block index at startup, using all -par threads (default: %u)", DEFAULT_VERIFYINDEXPOW));
+        strUsage += HelpMessageOpt("-prefetchcoins", strprintf("Read the coins a block spends from the database on -par threads before connecting it (default: %u)", DEFAULT_PREFETCHCOINS));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", DEFAULT_DISABLE_SAFEMODE));
@@ -595,6 +633,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)");
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit sum of signature cache and script execution cache sizes to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
         strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE));
+        strUsage += HelpMessageOpt("-powcachesize=<n>", strprintf("Remember the proof of work hashes of up to <n> verified block headers (default: %u)", DEFAULT_POW_CACHE_SIZE));
     }
     strUsage += HelpMessageOpt("-maxtxfee=<amt>", strprintf(_("Maximum total fees (in %s) to use in a single wallet transaction or raw transaction; setting this too low may abort large transactions (default: %s)"),
         CURRENCY_UNIT, FormatMoney(DEFAULT_TRANSACTION_MAXFEE)));
@@ -648,6 +687,11 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug)
         strUsage += HelpMessageOpt("-blockversion=<n>", "Override block version to test forking scenarios");
 
+    strUsage += HelpMessageGroup(_("Stratum server options:"));
+    strUsage += HelpMessageOpt("-stratumbind=<addr>[:port]", strprintf(_("Serve Stratum v1 mining jobs on the given address (default port: %u). This option can be specified multiple times. Anyone who can connect can submit work, so only bind to trusted networks"), DEFAULT_STRATUM_PORT));
+    strUsage += HelpMessageOpt("-stratumaddress=<addr>", _("Address that blocks mined through the Stratum server pay to"));
+    strUsage += HelpMessageOpt("-stratumdifficulty=<n>", strprintf(_("Share difficulty sent to Stratum miners (default: %g)"), DEFAULT_STRATUM_DIFFICULTY));
+
     strUsage += HelpMessageGroup(_("RPC server options:"));
     strUsage += HelpMessageOpt("-server", _("Accept command line and JSON-RPC commands"));
     strUsage += HelpMessageOpt("-rest", strprintf(_("Accept public REST requests (default: %u)"), DEFAULT_REST_ENABLE));
@@ -897,6 +941,12 @@ bool InitSanityCheck(void)
         return false;
     }
 
+    std::string strPowError;
+    if (!PowAlgorithmsSelfTest(strPowError)) {
+        InitError(strprintf("Proof of work sanity check failure: %s. Aborting.", strPowError));
+        return false;
+    }
+
     return true;
 }
 
@@ -1006,16 +1056,10 @@ void InitParameterInteraction()
     }
 #endif // ENABLE_WALLET
 
-    // Make sure additional indexes are recalculated correctly in VerifyDB
-    // (we must reconnect blocks whenever we disconnect them for these indexes to work)
-    bool fAdditionalIndexes =
-        gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) ||
-        gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) ||
-        gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
-
-    if (fAdditionalIndexes && gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL) < 4) {
-        gArgs.ForceSetArg("-checklevel", "4");
-        LogPrintf("%s: parameter interaction: additional indexes -> setting -checklevel=4\n", __func__);
+    // -addressbalanceindex is kept from the address index entries of each block
+    if (gArgs.GetBoolArg("-addressbalanceindex", DEFAULT_ADDRESSBALANCEINDEX)) {
+        if (gArgs.SoftSetBoolArg("-addressindex", true))
+            LogPrintf("%s: parameter interaction: -addressbalanceindex=1 -> setting -addressindex=1\n", __func__);
     }
 }
 
@@ -1120,8 +1164,20 @@ bool AppInitParameterInteraction()
     if (gArgs.GetArg("-prune", 0)) {
         if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        // The index threads read every block and its undo data back from disk
+        if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) ||
+            gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX))
+            return InitError(_("Prune mode is incompatible with -addressindex, -spentindex and -timestampindex."));
     }
 
+    if (gArgs.GetBoolArg("-addressbalanceindex", DEFAULT_ADDRESSBALANCEINDEX) && !gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX))
+        return InitError(_("-addressbalanceindex requires -addressindex."));
+
+    fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
+    fAddressBalanceIndex = gArgs.GetBoolArg("-addressbalanceindex", DEFAULT_ADDRESSBALANCEINDEX);
+    fTimestampIndex = gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
+    fSpentIndex = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+
     if (gArgs.IsArgSet("-devnet")) {
         // Require setting of ports when running devnet
         if (gArgs.GetArg("-listen", DEFAULT_LISTEN) && !gArgs.IsArgSet("-port")) {
@@ -1209,6 +1265,9 @@ bool AppInitParameterInteraction()
         mempool.setSanityCheck(1.0 / ratio);
     }
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
+    fCheckBlockReadPow = gArgs.GetBoolArg("-checkblockreadpow", DEFAULT_CHECKBLOCKREADPOW);
+    fVerifyIndexPow = gArgs.GetBoolArg("-verifyindexpow", DEFAULT_VERIFYINDEXPOW);
+    fPrefetchCoins = gArgs.GetBoolArg("-prefetchcoins", DEFAULT_PREFETCHCOINS);
     fCheckpointsEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
 
     hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
@@ -1504,6 +1563,11 @@ bool AppInitSanityChecks()
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    PowAlgorithmsAutoDetect();
+    for (const PowAlgorithm& pa : GetPowAlgorithms())
+        LogPrintf("Using the '%s' %s implementation\n", pa.strBackend, pa.name);
+    pow_scratch_set_hugepages(gArgs.GetBoolArg("-powhugepages", POW_SCRATCH_DEFAULT_HUGEPAGES));
+    LogPrintf("Using %s pages for proof of work scratchpads\n", GetPowScratchMode());
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1555,11 +1619,18 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitPowCache();
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        // Headers are hashed with as many threads, which are idle outside of headers sync
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadHeaderPowCheck);
+        // And the coins of blocks about to be connected are read with as many
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadCoinPrefetch);
     }
 
     std::vector<std::string> vSporkAddresses;
@@ -1604,11 +1675,6 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             return InitError(_("Unable to start HTTP server. See debug log for details."));
     }
 
-#if defined(USE_SSE2)
-    std::string sse2detect = scrypt_detect_sse2();
-    LogPrintf("%s\n", sse2detect);
-#endif
-
     // ********************************************************* Step 5: Backup wallet and verify wallet database integrity
 #ifdef ENABLE_WALLET
     if (!CWallet::InitAutoBackup())
@@ -1715,23 +1781,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // Algo
     std::string strAlgo = gArgs.GetArg("-algo", "butkscrypt");
-    transform(strAlgo.begin(),strAlgo.end(),strAlgo.begin(),::tolower);
-    if (strAlgo == "sha" || strAlgo == "sha256" || strAlgo == "sha256d")
-        miningAlgo = ALGO_SHA256D;
-    else if (strAlgo == "butkscrypt")
-        miningAlgo = ALGO_BUTKSCRYPT;
-    else if (strAlgo == "ghostrider")
-        miningAlgo = ALGO_GHOSTRIDER;
-    else if (strAlgo == "yespower")
-        miningAlgo = ALGO_YESPOWER;
-    else if (strAlgo == "lyra2" || strAlgo == "lyra2z330")
-        miningAlgo = ALGO_LYRA2;
-    else if (strAlgo == "scrypt")
-        miningAlgo = ALGO_SCRYPT;
-    else
-        miningAlgo = ALGO_BUTKSCRYPT;
+    const PowAlgorithm* pa = GetPowAlgorithmByName(strAlgo);
+    miningAlgo = pa ? pa->algo : ALGO_BUTKSCRYPT;
 
-    LogPrintf("Selected Algo: %s\n", strAlgo);
+    LogPrintf("Selected Algo: %s\n", GetAlgoName(miningAlgo));
 
     // see Step 2: parameter interactions for more information about these
     fListen = gArgs.GetBoolArg("-listen", DEFAULT_LISTEN);
@@ -1757,6 +1810,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     pdsNotificationInterface = new CDSNotificationInterface(connman);
     RegisterValidationInterface(pdsNotificationInterface);
 
+    g_blockTemplateManager.reset(new CBlockTemplateManager(chainparams));
+    RegisterValidationInterface(g_blockTemplateManager.get());
+
     uint64_t nMaxOutboundLimit = 0; //unlimited unless -maxuploadtarget is set
     uint64_t nMaxOutboundTimeframe = MAX_UPLOAD_TIMEFRAME;
 
@@ -1824,6 +1880,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             try {
                 UnloadBlockIndex();
                 delete pcoinsTip;
+                delete pcoinswriter;
                 delete pcoinsdbview;
                 delete pcoinscatcher;
                 delete pblocktree;
@@ -1869,24 +1926,6 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
-                // Check for changed -addressindex state
-                if (fAddressIndex != gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -addressindex");
-                    break;
-                }
-
-                // Check for changed -timestampindex state
-                if (fTimestampIndex != gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -timestampindex");
-                    break;
-                }
-
-                // Check for changed -spentindex state
-                if (fSpentIndex != gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -spentindex");
-                    break;
-                }
-
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -1907,7 +1946,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 // block tree into mapBlockIndex!
 
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReset || fReindexChainState);
-                pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
+                pcoinswriter = new CCoinsViewBackgroundWriter(pcoinsdbview, gArgs.GetBoolArg("-backgroundflush", DEFAULT_BACKGROUND_FLUSH));
+                pcoinscatcher = new CCoinsViewErrorCatcher(pcoinswriter);
 
                 // If necessary, upgrade from older database format.
                 // This is a no-op if we cleared the coinsviewdb with -reindex or -reindex-chainstate
@@ -1956,7 +1996,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                         }
                     }
 
-                    if (!CVerifyDB().VerifyDB(chainparams, pcoinsdbview, gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL),
+                    if (!CVerifyDB().VerifyDB(chainparams, pcoinswriter, gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL),
                                   gArgs.GetArg("-checkblocks", DEFAULT_CHECKBLOCKS))) {
                         strLoadError = _("Corrupted block database detected");
                         break;
@@ -2010,6 +2050,23 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         ::feeEstimator.Read(est_filein);
     fFeeEstimatesInitialized = true;
 
+    // Build the optional indexes in the background, from where they got to
+    if (fAddressIndex) {
+        g_addressindex.reset(new AddressIndex());
+        if (!g_addressindex->Start())
+            return false;
+    }
+    if (fSpentIndex) {
+        g_spentindex.reset(new SpentIndex());
+        if (!g_spentindex->Start())
+            return false;
+    }
+    if (fTimestampIndex) {
+        g_timestampindex.reset(new TimestampIndex());
+        if (!g_timestampindex->Start())
+            return false;
+    }
+
     // ********************************************************* Step 8: load wallet
 #ifdef ENABLE_WALLET
     if (!CWallet::InitLoadWallet())
@@ -2296,6 +2353,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         return false;
     }
 
+    if (gArgs.IsArgSet("-stratumbind") && !StartStratumServer()) {
+        return InitError(_("Unable to start Stratum server. See debug log for details."));
+    }
+
     // ********************************************************* Step 13: finished
 
     SetRPCWarmupFinished();
@@ -15,6 +15,8 @@
 #include <consensus/tx_verify.h>
 #include <consensus/merkle.h>
 #include <consensus/validation.h>
+#include <crypto/scrypt.h>
+#include <cryptonote/cryptonight_scratchpad.h>
 #include <hash.h>
 #include <validation.h>
 #include <net.h>
@@ -42,6 +44,7 @@
 
 #include <boost/thread.hpp>
 #include <algorithm>
+#include <atomic>
 #include <queue>
 #include <utility>
 
@@ -58,9 +61,6 @@
 
 uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockSize = 0;
-uint64_t nMiningTimeStart = 0;
-double nHashesPerSec = 0;
-uint64_t nHashesDone = 0;
 std::string alsoHashString;
 
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev, int algo)
@@ -123,6 +123,35 @@ void BlockAssembler::resetBlock()
     nFees = 0;
 }
 
+static int32_t ComputeTemplateVersion(const CChainParams& chainparams, const CBlockIndex* pindexPrev, int algo)
+{
+    int32_t nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus(), algo, chainparams.BIP9CheckSmartnodesUpgraded());
+    // -regtest only: allow overriding block.nVersion with
+    // -blockversion=N to test forking scenarios
+    if (chainparams.MineBlocksOnDemand())
+        nVersion = gArgs.GetArg("-blockversion", nVersion);
+    return nVersion;
+}
+
+/** Pay the block subsidy plus nFees to the miner, smartnode, superblock and founder payees */
+static void FillCoinbase(const CChainParams& chainparams, CBlockTemplate& tmpl, int nHeight, CAmount nFees)
+{
+    CMutableTransaction coinbaseTx(tmpl.coinbaseTxUnpaid);
+    const CAmount blockReward = nFees + tmpl.nBlockSubsidy;
+    coinbaseTx.vout[0].nValue = blockReward;
+
+    // Update coinbase transaction with additional info about smartnode and governance payments,
+    // get some info back to pass to getblocktemplate
+    tmpl.voutSmartnodePayments.clear();
+    tmpl.voutSuperblockPayments.clear();
+    FillBlockPayments(coinbaseTx, nHeight, blockReward, tmpl.voutSmartnodePayments, tmpl.voutSuperblockPayments);
+    FounderPayment founderPayment = chainparams.GetConsensus().nFounderPayment;
+    founderPayment.FillFounderPayment(coinbaseTx, nHeight, blockReward, tmpl.block.txoutFounder);
+    tmpl.block.vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
+    tmpl.vTxFees[0] = -nFees;
+    tmpl.vTxSigOps[0] = GetLegacySigOpCount(*tmpl.block.vtx[0]);
+}
+
 std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, int algo)
 {
     int64_t nTimeStart = GetTimeMicros();
@@ -148,11 +177,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     bool fDIP0003Active_context = chainparams.GetConsensus().DIP0003Enabled;
     bool fDIP0008Active_context = chainparams.GetConsensus().DIP0008Enabled;
 
-    pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus(),algo, chainparams.BIP9CheckSmartnodesUpgraded());
-    // -regtest only: allow overriding block.nVersion with
-    // -blockversion=N to test forking scenarios
-    if (chainparams.MineBlocksOnDemand())
-        pblock->nVersion = gArgs.GetArg("-blockversion", pblock->nVersion);
+    pblock->nVersion = ComputeTemplateVersion(chainparams, pindexPrev, algo);
 
     pblock->nTime = GetAdjustedTime();
     const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
@@ -192,10 +217,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
 
     // NOTE: unlike in bitcoin, we need to pass PREVIOUS block height here
-    CAmount blockReward = nFees + GetBlockSubsidy(pindexPrev->nBits, pindexPrev->nHeight, Params().GetConsensus());
-
-    // Compute regular coinbase transaction.
-    coinbaseTx.vout[0].nValue = blockReward;
+    pblocktemplate->nBlockSubsidy = GetBlockSubsidy(pindexPrev->nBits, pindexPrev->nHeight, Params().GetConsensus());
 
     if (!fDIP0003Active_context) {
         coinbaseTx.vin[0].scriptSig = CScript() << nHeight << OP_0;
@@ -222,13 +244,8 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
         SetTxPayload(coinbaseTx, cbTx);
     }
 
-    // Update coinbase transaction with additional info about smartnode and governance payments,
-    // get some info back to pass to getblocktemplate
-    FillBlockPayments(coinbaseTx, nHeight, blockReward, pblocktemplate->voutSmartnodePayments, pblocktemplate->voutSuperblockPayments);
-    FounderPayment founderPayment = chainparams.GetConsensus().nFounderPayment;
-	founderPayment.FillFounderPayment(coinbaseTx, nHeight, blockReward, pblock->txoutFounder);
-    pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
-    pblocktemplate->vTxFees[0] = -nFees;
+    pblocktemplate->coinbaseTxUnpaid = coinbaseTx;
+    FillCoinbase(chainparams, *pblocktemplate, nHeight, nFees);
 
     // Fill in header
     pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
@@ -236,7 +253,6 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus(), algo);
     pblock->nNonce         = 0;
     pblocktemplate->nPrevBits = pindexPrev->nBits;
-    pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(*pblock->vtx[0]);
 
     CValidationState state;
     if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
@@ -497,6 +513,162 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
     }
 }
 
+std::unique_ptr<CBlockTemplateManager> g_blockTemplateManager;
+
+CBlockTemplateManager::CBlockTemplateManager(const CChainParams& params) :
+    chainparams(params), pindexPrev(nullptr), nCreated(0), nTransactionsUpdated(0),
+    nBlockMaxSize(0), nBlockSize(0), nBlockSigOps(0), nFees(0), nLockTimeCutoff(0),
+    fInvalid(false), fMissedTx(false)
+{
+    mempool.NotifyEntryRemoved.connect(boost::bind(&CBlockTemplateManager::TransactionRemovedFromMempool, this, _1, _2));
+}
+
+CBlockTemplateManager::~CBlockTemplateManager()
+{
+    mempool.NotifyEntryRemoved.disconnect(boost::bind(&CBlockTemplateManager::TransactionRemovedFromMempool, this, _1, _2));
+}
+
+void CBlockTemplateManager::CreateTemplate(int algo)
+{
+    AssertLockHeld(cs);
+
+    // Clear pindexPrev so future calls make a new block, despite any failures from here on
+    pindexPrev = nullptr;
+    mapAlgoTemplates.clear();
+    setInBlock.clear();
+
+    // Store the chainActive.Tip() used before CreateNewBlock, to avoid races
+    nTransactionsUpdated = mempool.GetTransactionsUpdated();
+    const CBlockIndex* pindexPrevNew = chainActive.Tip();
+    nCreated = GetTime();
+
+    CScript scriptDummy = CScript() << OP_TRUE;
+    const BlockAssembler::Options options = DefaultOptions(chainparams);
+    pblocktemplate = BlockAssembler(chainparams, options).CreateNewBlock(scriptDummy, algo);
+    if (!pblocktemplate)
+        return;
+
+    // Pick up where BlockAssembler stopped, so that AppendTransaction applies the same limits
+    const CBlock& block = pblocktemplate->block;
+    nBlockMaxSize = std::max((unsigned int)1000, std::min((unsigned int)(MaxBlockSize(fDIP0001ActiveAtTip) - 1000), (unsigned int)options.nBlockMaxSize));
+    blockMinFeeRate = options.blockMinFeeRate;
+    nBlockSize = 1000;
+    nBlockSigOps = 100;
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        nBlockSize += block.vtx[i]->GetTotalSize();
+        nBlockSigOps += pblocktemplate->vTxSigOps[i];
+        setInBlock.insert(block.vtx[i]->GetHash());
+    }
+    nFees = -pblocktemplate->vTxFees[0];
+    nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
+                       ? pindexPrevNew->GetMedianTimePast()
+                       : block.GetBlockTime();
+    fInvalid = false;
+    fMissedTx = false;
+
+    // Need to update only after we know CreateNewBlock succeeded
+    pindexPrev = pindexPrevNew;
+}
+
+bool CBlockTemplateManager::AppendTransaction(CTxMemPool::txiter it)
+{
+    AssertLockHeld(cs);
+    const CTransaction& tx = it->GetTx();
+
+    // Special transactions feed the merkle roots in the coinbase payload
+    if (tx.nType != TRANSACTION_NORMAL)
+        return false;
+    // The template only grows at the end, so all parents must already be in it
+    for (const CTxMemPool::txiter parent : mempool.GetMemPoolParents(it)) {
+        if (!setInBlock.count(parent->GetTx().GetHash()))
+            return false;
+    }
+    if (nBlockSize + it->GetTxSize() >= nBlockMaxSize)
+        return false;
+    if (nBlockSigOps + it->GetSigOpCount() >= MaxBlockSigOps(fDIP0001ActiveAtTip))
+        return false;
+    if (it->GetModifiedFee() < blockMinFeeRate.GetFee(it->GetTxSize()))
+        return false;
+    if (!IsFinalTx(tx, pindexPrev->nHeight + 1, nLockTimeCutoff))
+        return false;
+    if (!llmq::chainLocksHandler->IsTxSafeForMining(tx.GetHash()))
+        return false;
+
+    pblocktemplate->block.vtx.emplace_back(it->GetSharedTx());
+    pblocktemplate->vTxFees.push_back(it->GetFee());
+    pblocktemplate->vTxSigOps.push_back(it->GetSigOpCount());
+    nBlockSize += it->GetTxSize();
+    nBlockSigOps += it->GetSigOpCount();
+    nFees += it->GetFee();
+    setInBlock.insert(tx.GetHash());
+    return true;
+}
+
+std::shared_ptr<CBlockTemplate> CBlockTemplateManager::GetBlockTemplate(int algo, unsigned int& nTransactionsUpdatedRet)
+{
+    LOCK2(cs_main, mempool.cs);
+    LOCK(cs);
+
+    // Transactions that could not be appended are picked up by a full rebuild,
+    // at most every 5 seconds like before
+    if (!pblocktemplate || fInvalid || pindexPrev != chainActive.Tip() ||
+        (fMissedTx && GetTime() - nCreated > 5)) {
+        CreateTemplate(algo);
+        if (!pblocktemplate)
+            return nullptr;
+    } else if (nFees != -pblocktemplate->vTxFees[0]) {
+        // Transactions were appended since the payments were last split
+        FillCoinbase(chainparams, *pblocktemplate, pindexPrev->nHeight + 1, nFees);
+    }
+    nTransactionsUpdatedRet = nTransactionsUpdated;
+
+    std::shared_ptr<CBlockTemplate>& algoTemplate = mapAlgoTemplates[algo];
+    if (!algoTemplate) {
+        algoTemplate = std::make_shared<CBlockTemplate>(*pblocktemplate);
+        CBlock& block = algoTemplate->block;
+        block.nVersion = ComputeTemplateVersion(chainparams, pindexPrev, algo);
+        UpdateTime(&block, chainparams.GetConsensus(), pindexPrev, algo);
+        block.nBits = GetNextWorkRequired(pindexPrev, &block, chainparams.GetConsensus(), algo);
+    }
+    return algoTemplate;
+}
+
+void CBlockTemplateManager::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+{
+    LOCK(cs);
+    // The next request builds on the new tip
+    pblocktemplate.reset();
+    mapAlgoTemplates.clear();
+    setInBlock.clear();
+    pindexPrev = nullptr;
+}
+
+void CBlockTemplateManager::TransactionAddedToMempool(const CTransactionRef& ptx, int64_t nAcceptTime)
+{
+    LOCK2(cs_main, mempool.cs);
+    LOCK(cs);
+    if (!pblocktemplate || fInvalid || pindexPrev != chainActive.Tip())
+        return;
+
+    CTxMemPool::txiter it = mempool.mapTx.find(ptx->GetHash());
+    if (it == mempool.mapTx.end())
+        return;
+    if (AppendTransaction(it)) {
+        mapAlgoTemplates.clear();
+        if (!fMissedTx)
+            nTransactionsUpdated = mempool.GetTransactionsUpdated();
+    } else {
+        fMissedTx = true;
+    }
+}
+
+void CBlockTemplateManager::TransactionRemovedFromMempool(CTransactionRef ptx, MemPoolRemovalReason reason)
+{
+    LOCK(cs);
+    if (setInBlock.count(ptx->GetHash()))
+        fInvalid = true;
+}
+
 static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainparams, uint256& hash)
 {
     LogPrintf("%s\n", pblock->ToString());
@@ -535,43 +707,177 @@ CWallet *GetFirstWallet() {
     return(NULL);
 }
 
-void static ButMiner(const CChainParams& chainparams)
+namespace {
+
+/** Block template shared by every miner thread until the tip or mempool moves on */
+struct CMinerTemplate
 {
-    LogPrintf("ButMiner -- started\n");
-    SetThreadPriority(THREAD_PRIORITY_LOWEST);
-    RenameThread("but-miner");
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+    const CBlockIndex* pindexPrev;
+    unsigned int nTransactionsUpdated;
+    int64_t nCreated;
+    uint64_t nGeneration;
+    // Threads take distinct extranonces from here, so their nonce spaces never overlap
+    std::atomic<unsigned int> nExtraNonce{0};
+
+    bool IsStale() const
+    {
+        if (pindexPrev != chainActive.Tip())
+            return true;
+        return mempool.GetTransactionsUpdated() != nTransactionsUpdated && GetTime() - nCreated > 60;
+    }
+};
 
-    unsigned int nExtraNonce = 0;
+/** Lock-free counters of one miner thread, each on its own cache line */
+struct alignas(64) CMinerThreadCounters
+{
+    std::atomic<uint64_t> nHashes{0};
+    std::atomic<int> nAlgo{-1};
+    std::atomic<int> nCpu{-1};
+};
 
+/** State shared by the threads started by one GenerateButs() call */
+class CMinerContext
+{
+public:
+    const int64_t nStartMicros;
+    std::vector<std::unique_ptr<CMinerThreadCounters>> vCounters;
+    std::atomic<uint64_t> nGeneration{0};
 
-    CWallet * pWallet = NULL;
+    explicit CMinerContext(int nThreads) : nStartMicros(GetTimeMicros())
+    {
+        for (int i = 0; i < nThreads; i++)
+            vCounters.emplace_back(new CMinerThreadCounters());
+    }
 
-    #ifdef ENABLE_WALLET
+    /** Reserve the coinbase script once for all threads; null if there is no wallet */
+    std::shared_ptr<CReserveScript> GetCoinbaseScript()
+    {
+        LOCK(cs);
+        if (fHaveScript)
+            return coinbaseScript;
+
+        CWallet* pWallet = NULL;
+#ifdef ENABLE_WALLET
         pWallet = GetFirstWallet();
-    #endif
+#endif
+        if (!EnsureWalletIsAvailable(pWallet, false)) {
+            LogPrintf("ButMiner -- Wallet not available\n");
+        }
+        if (pWallet == NULL) {
+            LogPrintf("pWallet is NULL\n");
+            return nullptr;
+        }
 
-    if (!EnsureWalletIsAvailable(pWallet, false)) {
-        LogPrintf("ButMiner -- Wallet not available\n");
+        pWallet->GetScriptForMining(coinbaseScript);
+        if (!coinbaseScript)
+            LogPrintf("coinbaseScript is NULL\n");
+        else if (coinbaseScript->reserveScript.empty())
+            LogPrintf("coinbaseScript is empty\n");
+        fHaveScript = true;
+        return coinbaseScript;
     }
 
-    if (pWallet == NULL)
+    /** Return the current template, building a new one if it has gone stale */
+    std::shared_ptr<CMinerTemplate> GetTemplate(const CScript& scriptPubKey, const CChainParams& chainparams)
     {
-        LogPrintf("pWallet is NULL\n");
-        return;
+        LOCK(cs);
+        if (tmpl && !tmpl->IsStale())
+            return tmpl;
+
+        std::shared_ptr<CMinerTemplate> next = std::make_shared<CMinerTemplate>();
+        next->nTransactionsUpdated = mempool.GetTransactionsUpdated();
+        next->pindexPrev = chainActive.Tip();
+        if (!next->pindexPrev)
+            return nullptr;
+        next->pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKey, miningAlgo);
+        if (!next->pblocktemplate)
+            return nullptr;
+        next->nCreated = GetTime();
+        next->nGeneration = ++nGeneration;
+
+        alsoHashString = GetGhostRiderSchedule(next->pblocktemplate->block.hashPrevBlock).ToString();
+        LogPrintf("Algos: %s\n", alsoHashString);
+        LogPrintf("ButMiner -- Running miner with %u transactions in block (%u bytes)\n", next->pblocktemplate->block.vtx.size(),
+            ::GetSerializeSize(next->pblocktemplate->block, SER_NETWORK, PROTOCOL_VERSION));
+
+        tmpl = next;
+        return tmpl;
     }
 
+    std::vector<MinerThreadStats> GetStats() const
+    {
+        std::vector<MinerThreadStats> vStats;
+        const double dElapsed = (GetTimeMicros() - nStartMicros) / 1000000.0;
+        for (size_t i = 0; i < vCounters.size(); i++) {
+            MinerThreadStats stats;
+            stats.nThread = i;
+            stats.nAlgo = vCounters[i]->nAlgo.load(std::memory_order_relaxed);
+            stats.nCpu = vCounters[i]->nCpu.load(std::memory_order_relaxed);
+            stats.nHashes = vCounters[i]->nHashes.load(std::memory_order_relaxed);
+            stats.dHashesPerSec = dElapsed > 0 ? stats.nHashes / dElapsed : 0;
+            vStats.push_back(stats);
+        }
+        return vStats;
+    }
 
+private:
+    CCriticalSection cs;
+    bool fHaveScript{false};
     std::shared_ptr<CReserveScript> coinbaseScript;
+    std::shared_ptr<CMinerTemplate> tmpl;
+};
 
-    pWallet->GetScriptForMining(coinbaseScript);
+CCriticalSection cs_minerThreads;
+boost::thread_group* minerThreads = NULL;
+std::shared_ptr<CMinerContext> minerContext;
 
-    //GetMainSignals().ScriptForMining(coinbaseScript);
+/** Log the hash rate of all threads; called by the first thread, outside the nonce loop */
+void LogMinerStats(const CMinerContext& context)
+{
+    double dTotal = 0;
+    for (const MinerThreadStats& stats : context.GetStats())
+        dTotal += stats.dHashesPerSec;
+    LogPrintf("ButMiner -- %u threads, hashrate %f\n", context.vCounters.size(), dTotal);
+}
 
-    if (!coinbaseScript)
-        LogPrintf("coinbaseScript is NULL\n");
+} // namespace
 
-    if (coinbaseScript->reserveScript.empty())
-        LogPrintf("coinbaseScript is empty\n");
+static void SetExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int nExtraNonce)
+{
+    unsigned int nHeight = pindexPrev->nHeight+1; // Height first in coinbase required for block.version=2
+    CMutableTransaction txCoinbase(*pblock->vtx[0]);
+    txCoinbase.vin[0].scriptSig = (CScript() << nHeight << CScriptNum(nExtraNonce)) + COINBASE_FLAGS;
+    assert(txCoinbase.vin[0].scriptSig.size() <= 100);
+
+    pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
+    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+}
+
+void static ButMiner(const CChainParams& chainparams, std::shared_ptr<CMinerContext> context, int nThread, bool fAffinity)
+{
+    LogPrintf("ButMiner -- thread %d started\n", nThread);
+    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+    RenameThread(strprintf("but-miner-%d", nThread).c_str());
+
+    CMinerThreadCounters& counters = *context->vCounters[nThread];
+    counters.nAlgo = miningAlgo;
+    if (fAffinity) {
+        // Keep each thread on its own CPU so the CryptoNight scratchpads stay in that core's cache
+        const int nCpu = nThread % std::max(1, (int)boost::thread::hardware_concurrency());
+        if (SetThreadAffinity(nCpu))
+            counters.nCpu = nCpu;
+    }
+
+    std::shared_ptr<CReserveScript> coinbaseScript = context->GetCoinbaseScript();
+
+    // Pre-warm this thread's CryptoNight scratchpad and release it and the scrypt one when mining stops
+    struct ScratchpadGuard {
+        ScratchpadGuard() { cryptonight_scratchpad_init(); }
+        ~ScratchpadGuard() { cryptonight_scratchpad_free(); scrypt_scratchpad_free(); }
+    } scratchpadGuard;
+
+    int64_t nLastLog = GetTimeMicros();
 
     try {
         // Throw an error if no script was provided.  This can happen
@@ -599,67 +905,54 @@ void static ButMiner(const CChainParams& chainparams)
 
 
             //
-            // Create new block
+            // Take the shared block and give it an extranonce no other thread uses
             //
-            unsigned int nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-            CBlockIndex* pindexPrev = chainActive.Tip();
-            if(!pindexPrev) break;
-
-
-
-            std::unique_ptr<CBlockTemplate> pblocktemplate(BlockAssembler(Params()).CreateNewBlock(coinbaseScript->reserveScript, miningAlgo));
-
-            if (!pblocktemplate.get())
+            std::shared_ptr<CMinerTemplate> tmpl = context->GetTemplate(coinbaseScript->reserveScript, chainparams);
+            if (!tmpl)
             {
                 LogPrintf("ButMiner -- Keypool ran out, please call keypoolrefill before restarting the mining thread\n");
                 return;
             }
-            CBlock *pblock = &pblocktemplate->block;
-            HashSelection hashSelection(pblock->hashPrevBlock, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14}, {0, 1, 2, 3, 4, 5});
-			alsoHashString.clear();
-			alsoHashString.append(hashSelection.getHashSelectionString());
-			LogPrintf("Algos: %s\n",hashSelection.getHashSelectionString());
-            IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
-
-            LogPrintf("ButMiner -- Running miner with %u transactions in block (%u bytes)\n", pblock->vtx.size(),
-                ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION));
+            const CBlockIndex* pindexPrev = tmpl->pindexPrev;
+            CBlock block = tmpl->pblocktemplate->block;
+            CBlock *pblock = &block;
+            SetExtraNonce(pblock, pindexPrev, ++tmpl->nExtraNonce);
 
             //
             // Search
             //
-            int64_t nStart = GetTime();
             arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
             while (true)
             {
 
+                // Scan up to the next multiple of 256 so the checks below run regularly
                 uint256 hash;
-                while (true)
+                const uint32_t nNonceStart = pblock->nNonce;
+                const uint32_t nCount = 0x100 - (nNonceStart & 0xFF);
+                uint32_t nNonceFound;
+                const bool fFound = ScanNonces(*pblock, nNonceStart, nCount, hashTarget, pblock->GetAlgo(), nNonceFound, hash);
+                pblock->nNonce = fFound ? nNonceFound : nNonceStart + nCount;
+                counters.nHashes.fetch_add(fFound ? nNonceFound - nNonceStart + 1 : nCount, std::memory_order_relaxed);
+
+                if (fFound)
                 {
-                    hash = pblock->GetPOWHash(pblock->GetAlgo());
-                    if (UintToArith256(hash) <= hashTarget)
-                    {
-                        // Found a solution
-                        SetThreadPriority(THREAD_PRIORITY_NORMAL);
-                        LogPrintf("ButMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
-                        ProcessBlockFound(pblock, chainparams, hash);
-                        SetThreadPriority(THREAD_PRIORITY_LOWEST);
-                        coinbaseScript->KeepScript();
-                        // In regression test mode, stop mining after a block is found. This
-                        // allows developers to controllably generate a block on demand.
-                        if (chainparams.MineBlocksOnDemand())
-                            throw boost::thread_interrupted();
+                    // Found a solution
+                    SetThreadPriority(THREAD_PRIORITY_NORMAL);
+                    LogPrintf("ButMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
+                    ProcessBlockFound(pblock, chainparams, hash);
+                    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+                    coinbaseScript->KeepScript();
+                    // In regression test mode, stop mining after a block is found. This
+                    // allows developers to controllably generate a block on demand.
+                    if (chainparams.MineBlocksOnDemand())
+                        throw boost::thread_interrupted();
 
-                        break;
-                    }
-                    pblock->nNonce += 1;
-                    nHashesDone += 1;
-                    if (nHashesDone % 1000 == 0) {   //Calculate hashing speed
-                        nHashesPerSec = nHashesDone / (((GetTimeMicros() - nMiningTimeStart) / 1000000.00) + 1);
-                        LogPrintf("nNonce: %d, hashRate %f\n",pblock->nNonce, nHashesPerSec);
-                        //LogPrintf("ButMiner:\n  proof-of-work in progress \n  hash: %s\n  target: %s\n, different=%s\n", hash.GetHex(), hashTarget.GetHex(), (UintToArith256(hash) - hashTarget));
-                    }
-                    if ((pblock->nNonce & 0xFF) == 0)
-                        break;
+                    break;
+                }
+
+                if (nThread == 0 && GetTimeMicros() - nLastLog > 60 * 1000000) {
+                    LogMinerStats(*context);
+                    nLastLog = GetTimeMicros();
                 }
 
                 // Check for stop or if block needs to be rebuilt
@@ -669,9 +962,7 @@ void static ButMiner(const CChainParams& chainparams)
                 //    break;
                 if (pblock->nNonce >= 0xffff0000)
                     break;
-                if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 60)
-                    break;
-                if (pindexPrev != chainActive.Tip())
+                if (context->nGeneration != tmpl->nGeneration || tmpl->IsStale())
                     break;
 
                 // Update nTime every few seconds
@@ -688,7 +979,7 @@ void static ButMiner(const CChainParams& chainparams)
     }
     catch (const boost::thread_interrupted&)
     {
-        LogPrintf("ButMiner -- terminated\n");
+        LogPrintf("ButMiner -- thread %d terminated\n", nThread);
         throw;
     }
     catch (const std::runtime_error &e)
@@ -700,8 +991,7 @@ void static ButMiner(const CChainParams& chainparams)
 
 int GenerateButs(bool fGenerate, int nThreads, const CChainParams& chainparams)
 {
-
-    static boost::thread_group* minerThreads = NULL;
+    LOCK(cs_minerThreads);
 
     int numCores = GetNumCores();
     if (nThreads < 0)
@@ -713,24 +1003,35 @@ int GenerateButs(bool fGenerate, int nThreads, const CChainParams& chainparams)
         delete minerThreads;
         minerThreads = NULL;
     }
+    // Threads still winding down keep their own reference to the old context
+    minerContext.reset();
 
     if (nThreads == 0 || !fGenerate)
         return numCores;
 
     minerThreads = new boost::thread_group();
+    minerContext = std::make_shared<CMinerContext>(nThreads);
 
-    //Reset metrics
-    nMiningTimeStart = GetTimeMicros();
-    nHashesDone = 0;
-    nHashesPerSec = 0;
-
+    const bool fAffinity = gArgs.GetBoolArg("-genaffinity", DEFAULT_GENERATE_AFFINITY);
     for (int i = 0; i < nThreads; i++){
-        minerThreads->create_thread(boost::bind(&ButMiner, boost::cref(chainparams)));
+        minerThreads->create_thread(boost::bind(&ButMiner, boost::cref(chainparams), minerContext, i, fAffinity));
     }
 
     return(numCores);
 }
 
+std::vector<MinerThreadStats> GetMinerStats()
+{
+    std::shared_ptr<CMinerContext> context;
+    {
+        LOCK(cs_minerThreads);
+        context = minerContext;
+    }
+    if (!context)
+        return std::vector<MinerThreadStats>();
+    return context->GetStats();
+}
+
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
 {
     // Update nExtraNonce
@@ -741,11 +1042,5 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
         hashPrevBlock = pblock->hashPrevBlock;
     }
     ++nExtraNonce;
-    unsigned int nHeight = pindexPrev->nHeight+1; // Height first in coinbase required for block.version=2
-    CMutableTransaction txCoinbase(*pblock->vtx[0]);
-    txCoinbase.vin[0].scriptSig = (CScript() << nHeight << CScriptNum(nExtraNonce)) + COINBASE_FLAGS;
-    assert(txCoinbase.vin[0].scriptSig.size() <= 100);
-
-    pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
-    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+    SetExtraNonce(pblock, pindexPrev, nExtraNonce);
 }
@@ -7,7 +7,9 @@
 #define BITCOIN_MINER_H
 
 #include <primitives/block.h>
+#include <sync.h>
 #include <txmempool.h>
+#include <validationinterface.h>
 
 #include <stdint.h>
 #include <memory>
@@ -22,6 +24,8 @@ class CScript;
 namespace Consensus { struct Params; };
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Pin each internal miner thread to its own CPU */
+static const bool DEFAULT_GENERATE_AFFINITY = true;
 
 struct CBlockTemplate
 {
@@ -31,6 +35,8 @@ struct CBlockTemplate
     uint32_t nPrevBits; // nBits of previous block (for subsidy calculation)
     std::vector<CTxOut> voutSmartnodePayments; // smartnode payment
     std::vector<CTxOut> voutSuperblockPayments; // superblock payment
+    CMutableTransaction coinbaseTxUnpaid; // coinbase before the block reward was filled in
+    CAmount nBlockSubsidy;
 };
 
 // Container for tracking updates to ancestor feerate as we include (parent)
@@ -203,9 +209,77 @@ private:
     int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set &mapModifiedTx);
 };
 
+/**
+ * Serves getblocktemplate. The transactions and coinbase of a template do
+ * not depend on the algorithm, so they are assembled once per tip and then
+ * extended in place as transactions enter the mempool; every algorithm only
+ * gets its own copy with its version and bits filled in.
+ */
+class CBlockTemplateManager final : public CValidationInterface
+{
+private:
+    CCriticalSection cs;
+    const CChainParams& chainparams;
+
+    // Template shared by all algorithms, with the header of the last one built
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+    const CBlockIndex* pindexPrev;
+    std::map<int, std::shared_ptr<CBlockTemplate>> mapAlgoTemplates;
+    std::set<uint256> setInBlock;
+    int64_t nCreated;
+    unsigned int nTransactionsUpdated;
+
+    // Incremental state of the template, as BlockAssembler left it
+    unsigned int nBlockMaxSize;
+    CFeeRate blockMinFeeRate;
+    uint64_t nBlockSize;
+    unsigned int nBlockSigOps;
+    CAmount nFees;
+    int64_t nLockTimeCutoff;
+
+    /** A template transaction left the mempool, so the template must be rebuilt */
+    bool fInvalid;
+    /** The mempool has transactions that could not be appended to the template */
+    bool fMissedTx;
+
+public:
+    explicit CBlockTemplateManager(const CChainParams& params);
+    ~CBlockTemplateManager();
+
+    /**
+     * Template for the next block mined with algo. nTransactionsUpdatedRet is
+     * the mempool update count the template reflects, for longpolling.
+     */
+    std::shared_ptr<CBlockTemplate> GetBlockTemplate(int algo, unsigned int& nTransactionsUpdatedRet);
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+    void TransactionAddedToMempool(const CTransactionRef &ptxn, int64_t nAcceptTime) override;
+
+private:
+    void TransactionRemovedFromMempool(CTransactionRef ptx, MemPoolRemovalReason reason);
+    void CreateTemplate(int algo);
+    bool AppendTransaction(CTxMemPool::txiter it);
+};
+
+extern std::unique_ptr<CBlockTemplateManager> g_blockTemplateManager;
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev, int algo);
 int GenerateButs(bool fGenerate, int nThreads, const CChainParams& chainparams);
 
+/** Hash counters of one internal miner thread */
+struct MinerThreadStats
+{
+    int nThread;
+    int nAlgo;
+    int nCpu; // -1 if the thread is not pinned to a CPU
+    uint64_t nHashes;
+    double dHashesPerSec;
+};
+
+/** Snapshot the counters of the running GenerateButs() threads */
+std::vector<MinerThreadStats> GetMinerStats();
+
 #endif // BITCOIN_MINER_H
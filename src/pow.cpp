@@ -259,10 +259,8 @@ bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&
 
 const CBlockIndex* GetLastBlockIndexForAlgo(const CBlockIndex* pindex, const Consensus::Params& params, int algo)
 {
-    for (; pindex; pindex = pindex->pprev)
+    for (pindex = pindex ? pindex->GetLastAlgo(algo) : nullptr; pindex; pindex = pindex->pprevSameAlgo)
     {
-        if (pindex->GetAlgo() != algo)
-            continue;
         // ignore special min-difficulty testnet blocks
         if (params.fPowAllowMinDifficultyBlocks &&
             pindex->pprev &&
@@ -277,22 +275,9 @@ const CBlockIndex* GetLastBlockIndexForAlgo(const CBlockIndex* pindex, const Con
 
 unsigned int GetAlgoWeight(int algo)
 {
-    switch (algo)
-    {
-        case ALGO_SHA256D:
-            return (unsigned int)(0.005 * 100000);
-        case ALGO_YESPOWER:
-            return (unsigned int)(0.00015 * 100000);
-        case ALGO_GHOSTRIDER:
-            return (unsigned int)(6 * 100000);
-        case ALGO_LYRA2:
-            return (unsigned int)(6 * 100000);
-        case ALGO_BUTKSCRYPT:
-            return (unsigned int)(1.4 * 100000);
-        case ALGO_SCRYPT:
-            return (unsigned int)(1.2 * 100000);
-        default: // Lowest
-            printf("GetAlgoWeight(): can't find algo %d", algo);
-            return (unsigned int)(0.00015 * 100000);
-    }
+    if (const PowAlgorithm* pa = GetPowAlgorithm(algo))
+        return pa->nWeight;
+    // Lowest
+    printf("GetAlgoWeight(): can't find algo %d", algo);
+    return (unsigned int)(0.00015 * 100000);
 }
@@ -0,0 +1,214 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <powalgo.h>
+
+#include <hash.h>
+#include <hash_selection.h>
+#include <tinyformat.h>
+#include <crypto/common.h>
+#include <crypto/pow_scratch.h>
+#include <crypto/scrypt.h>
+#include <crypto/sha256.h>
+#include <crypto/algos/yespower/yespower.h>
+#include <crypto/algos/Lyra2Z/Lyra2.h>
+#include <cryptonote/cryptonight_aesni.h>
+
+#include <algorithm>
+#include <string.h>
+
+namespace {
+
+const size_t HEADER_SIZE = 80;
+const size_t NONCE_OFFSET = 76;
+
+void HashSHA256D(const unsigned char* header, uint256& hash)
+{
+    CHash256().Write(header, HEADER_SIZE).Finalize(hash.begin());
+}
+
+void HashSHA256DBatch(const unsigned char* header, const uint32_t nonces[], uint256 hashes[], size_t n)
+{
+    // The nonce is in the second SHA256 block, so the first one is absorbed once
+    CSHA256 midstate;
+    midstate.Write(header, 64);
+    unsigned char tail[HEADER_SIZE - 64];
+    memcpy(tail, header + 64, sizeof(tail));
+    for (size_t i = 0; i < n; i++) {
+        WriteLE32(tail + NONCE_OFFSET - 64, nonces[i]);
+        CSHA256(midstate).Write(tail, sizeof(tail)).Finalize(hashes[i].begin());
+        CSHA256().Write(hashes[i].begin(), CSHA256::OUTPUT_SIZE).Finalize(hashes[i].begin());
+    }
+}
+
+uint256 HashPrevBlock(const unsigned char* header)
+{
+    uint256 hashPrevBlock;
+    memcpy(hashPrevBlock.begin(), header + 4, hashPrevBlock.size());
+    return hashPrevBlock;
+}
+
+void HashGhostRider(const unsigned char* header, uint256& hash)
+{
+    hash = HashGR(header, header + HEADER_SIZE, HashPrevBlock(header));
+}
+
+void HashGhostRiderBatch(const unsigned char* header, const uint32_t nonces[], uint256 hashes[], size_t n)
+{
+    GhostRiderMidstate midstate;
+    midstate.Init(header, HashPrevBlock(header));
+    HashGRBatch(midstate, nonces, hashes, n);
+}
+
+void HashYespower(const unsigned char* header, uint256& hash)
+{
+    yespower_hash((const char*)header, (char*)hash.begin());
+}
+
+void HashLyra2(const unsigned char* header, uint256& hash)
+{
+    LYRA2(hash.begin(), 32, header, HEADER_SIZE, header, HEADER_SIZE, 2, 330, 256);
+}
+
+void HashScrypt(const unsigned char* header, uint256& hash)
+{
+    scrypt_1024_1_1_256((const char*)header, (char*)hash.begin());
+}
+
+std::vector<PowAlgorithm>& Registry()
+{
+    // ButKScrypt blocks have always been checked against the SHA256d header
+    // hash, and the weights must stay the exact same truncated doubles
+    static std::vector<PowAlgorithm> vAlgorithms = {
+        {ALGO_BUTKSCRYPT, "butkscrypt", {}, BLOCK_VERSION_BUTKSCRYPT, nullptr,
+            (unsigned int)(1.4 * 100000), HashSHA256D, HashSHA256DBatch, 64,
+            "e40105b4d7aff1df002bf704c28f346695527bda3bf62f120705b04f04982c85", ""},
+        {ALGO_SHA256D, "sha256d", {"sha", "sha256"}, BLOCK_VERSION_SHA256D, nullptr,
+            (unsigned int)(0.005 * 100000), HashSHA256D, HashSHA256DBatch, 64,
+            "e40105b4d7aff1df002bf704c28f346695527bda3bf62f120705b04f04982c85", ""},
+        {ALGO_LYRA2, "lyra2", {"lyra", "lyra2re", "lyra2v2", "lyra2rev2", "lyra2z330"}, BLOCK_VERSION_LYRA2, &Consensus::Params::AlgoChangeHeight,
+            (unsigned int)(6 * 100000), HashLyra2, nullptr, 1,
+            "b04ad54800c38b7868e5defd73e1d273652c66aad27f230523ef6e850873c0bb", ""},
+        {ALGO_GHOSTRIDER, "ghostrider", {}, BLOCK_VERSION_GHOSTRIDER, nullptr,
+            (unsigned int)(6 * 100000), HashGhostRider, HashGhostRiderBatch, 8,
+            "77ca899639387b77297ea4755ac8eb70a3cfd70135209fa24beea6302176ec9d", ""},
+        {ALGO_YESPOWER, "yespower", {}, BLOCK_VERSION_YESPOWER, &Consensus::Params::v2DiffChangeHeight,
+            (unsigned int)(0.00015 * 100000), HashYespower, nullptr, 1,
+            "89e3e5a116e6ba03af75aa0ad024052bb7efa5e2465b0d714fe2c9c3a9035992", ""},
+        {ALGO_SCRYPT, "scrypt", {}, BLOCK_VERSION_SCRYPT, &Consensus::Params::nSwitchHeight,
+            (unsigned int)(1.2 * 100000), HashScrypt, nullptr, 1,
+            "d2a91baa45263cfd16c4fef0fb0776382d0e011ec70530496ef91d801a0a54bc", ""},
+    };
+    return vAlgorithms;
+}
+
+} // namespace
+
+const std::vector<PowAlgorithm>& GetPowAlgorithms()
+{
+    return Registry();
+}
+
+const PowAlgorithm* GetPowAlgorithm(int algo)
+{
+    const std::vector<PowAlgorithm>& vAlgorithms = Registry();
+    if (algo < 0 || algo >= (int)vAlgorithms.size())
+        return nullptr;
+    return &vAlgorithms[algo];
+}
+
+const PowAlgorithm* GetPowAlgorithmByVersion(int32_t nVersion)
+{
+    for (const PowAlgorithm& pa : Registry()) {
+        if ((nVersion & BLOCK_VERSION_ALGO) == pa.nVersionBits)
+            return &pa;
+    }
+    return nullptr;
+}
+
+const PowAlgorithm* GetPowAlgorithmByName(const std::string& strName)
+{
+    std::string strLower(strName);
+    std::transform(strLower.begin(), strLower.end(), strLower.begin(), ::tolower);
+    for (const PowAlgorithm& pa : Registry()) {
+        if (strLower == pa.name || std::count(pa.vAliases.begin(), pa.vAliases.end(), strLower))
+            return &pa;
+    }
+    return nullptr;
+}
+
+void PowAlgorithmsAutoDetect()
+{
+    std::vector<PowAlgorithm>& vAlgorithms = Registry();
+
+    const std::string strSHA256 = SHA256AutoDetect();
+    vAlgorithms[ALGO_SHA256D].strBackend = strSHA256;
+    vAlgorithms[ALGO_BUTKSCRYPT].strBackend = strSHA256;
+
+    cryptonight_detect_aesni();
+    vAlgorithms[ALGO_GHOSTRIDER].strBackend = strprintf("core %s, cryptonight %s", CoreHashAutoDetect(),
+        cryptonight_aesni_enabled ? "aes-ni" : "generic");
+
+    vAlgorithms[ALGO_LYRA2].strBackend = lyra2_detect_sponge();
+
+#if defined(__XOP__)
+    vAlgorithms[ALGO_YESPOWER].strBackend = "xop";
+#elif defined(__AVX__)
+    vAlgorithms[ALGO_YESPOWER].strBackend = "avx";
+#elif defined(__SSE2__)
+    vAlgorithms[ALGO_YESPOWER].strBackend = "sse2";
+#else
+    vAlgorithms[ALGO_YESPOWER].strBackend = "generic";
+#endif
+
+#if defined(USE_SSE2)
+    scrypt_detect_sse2();
+#if defined(USE_SSE2_ALWAYS)
+    vAlgorithms[ALGO_SCRYPT].strBackend = "sse2";
+#else
+    vAlgorithms[ALGO_SCRYPT].strBackend = scrypt_1024_1_1_256_sp_detected == &scrypt_1024_1_1_256_sp_sse2 ? "sse2" : "generic";
+#endif
+#else
+    vAlgorithms[ALGO_SCRYPT].strBackend = "generic";
+#endif
+}
+
+bool PowAlgorithmsSelfTest(std::string& strError)
+{
+    // Bytes 0..79, with the nonce of the batched hashes in the last four
+    unsigned char header[HEADER_SIZE];
+    for (size_t i = 0; i < HEADER_SIZE; i++)
+        header[i] = i;
+    const uint32_t nNonce = ReadLE32(header + NONCE_OFFSET);
+
+    for (const PowAlgorithm& pa : Registry()) {
+        const uint256 expected = uint256S(pa.strKnownAnswer);
+        uint256 hash;
+        pa.hash(header, hash);
+        if (hash != expected) {
+            strError = strprintf("%s self-test failed: got %s, expected %s", pa.name, hash.ToString(), expected.ToString());
+            return false;
+        }
+        if (pa.batchHash) {
+            const uint32_t nonces[] = {nNonce + 1, nNonce};
+            uint256 hashes[2];
+            pa.batchHash(header, nonces, hashes, 2);
+            if (hashes[1] != expected) {
+                strError = strprintf("%s batched self-test failed: got %s, expected %s", pa.name, hashes[1].ToString(), expected.ToString());
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::string GetPowScratchMode()
+{
+    pow_scratch_t probe;
+    if (pow_scratch_alloc(&probe, 2 * 1024 * 1024))
+        return "none";
+    const std::string strMode = pow_scratch_mode_name(probe.mode);
+    pow_scratch_free(&probe);
+    return strMode;
+}
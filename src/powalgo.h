@@ -0,0 +1,125 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_POWALGO_H
+#define BITCOIN_POWALGO_H
+
+#include <consensus/params.h>
+#include <uint256.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum
+{
+    ALGO_BUTKSCRYPT  = 0,
+    ALGO_SHA256D     = 1,
+    ALGO_LYRA2       = 2,
+    ALGO_GHOSTRIDER  = 3,
+    ALGO_YESPOWER    = 4,
+    ALGO_SCRYPT      = 5
+};
+
+const int NUM_ALGOS   = 3;
+const int NUM_ALGOSV2 = 4;
+const int NUM_ALGOSV3 = 5;
+const int NUM_ALGOSV4 = 6;
+enum
+{
+    // primary version
+BLOCK_VERSION_DEFAULT = 2,
+
+    // algo
+    BLOCK_VERSION_ALGO_BROKEN    = (10 << 11), //'101000000000000' 10 (broken bitmask)
+    BLOCK_VERSION_ALGO           = (15 << 11), //'111100000000000' 15 (bitmask)
+    BLOCK_VERSION_BUTKSCRYPT     = (1  << 11), //'000100000000000' 1
+    BLOCK_VERSION_SHA256D        = (2  << 11), //'001000000000000' 2
+    BLOCK_VERSION_GHOSTRIDER     = (3  << 11), //'001100000000000' 3
+    BLOCK_VERSION_YESPOWER 	 = (4  << 11), //'010000000000000' 4
+    BLOCK_VERSION_LYRA2 	 = (10 << 11), //'101000000000000' 10
+    BLOCK_VERSION_SCRYPT         = (5  << 11),
+};
+
+/** Proof of work hash of an 80 byte block header */
+typedef void (*PowHashFunction)(const unsigned char* header, uint256& hash);
+/** Proof of work hashes of an 80 byte block header with each of n nonces */
+typedef void (*PowBatchHashFunction)(const unsigned char* header, const uint32_t nonces[], uint256 hashes[], size_t n);
+
+/**
+ * Everything the node knows about one mining algorithm. Code that hashes,
+ * weighs, names or versions blocks goes through this table instead of
+ * switching on the algorithm itself.
+ */
+struct PowAlgorithm
+{
+    int algo;
+    const char* name;
+    /** Other names accepted by -algo and getblocktemplate */
+    std::vector<std::string> vAliases;
+    int32_t nVersionBits;
+    /** Height after which blocks may use nVersionBits, or null if always */
+    int Consensus::Params::*pActivationHeight;
+    unsigned int nWeight;
+    PowHashFunction hash;
+    /** Faster path for many nonces of one header, or null */
+    PowBatchHashFunction batchHash;
+    /** Nonces per batchHash call, the granularity at which ScanNonces stops */
+    uint32_t nBatchSize;
+    /** Expected hash of the self-test header */
+    const char* strKnownAnswer;
+    /** Implementation picked by PowAlgorithmsAutoDetect() */
+    std::string strBackend;
+
+    /** Whether a block on top of a block at nPrevHeight may use this algorithm's version bits */
+    bool IsActive(int nPrevHeight, const Consensus::Params& params) const
+    {
+        return !pActivationHeight || nPrevHeight >= params.*pActivationHeight;
+    }
+};
+
+/** All algorithms, ordered by ALGO_* id */
+const std::vector<PowAlgorithm>& GetPowAlgorithms();
+/** The entry of algo, or null if there is none */
+const PowAlgorithm* GetPowAlgorithm(int algo);
+/** The algorithm the version bits select, or null if they select none */
+const PowAlgorithm* GetPowAlgorithmByVersion(int32_t nVersion);
+/** The algorithm called strName or one of its aliases, case insensitive, or null */
+const PowAlgorithm* GetPowAlgorithmByName(const std::string& strName);
+
+/**
+ * Pick the fastest implementation of every algorithm this CPU supports and
+ * record it in strBackend. Call once at startup, before hashing.
+ */
+void PowAlgorithmsAutoDetect();
+/** Check every algorithm, scalar and batched, against its known answer */
+bool PowAlgorithmsSelfTest(std::string& strError);
+
+/**
+ * How a scratchpad allocated now would be backed: "huge", "transparent huge"
+ * or "normal" pages, see crypto/pow_scratch.h. Probes with a 2 MiB mapping,
+ * so the answer follows -powhugepages and the state of the huge page pool.
+ */
+std::string GetPowScratchMode();
+
+static inline int GetAlgoByVersion(int nVersion)
+{
+    const PowAlgorithm* pa = GetPowAlgorithmByVersion(nVersion);
+    return pa ? pa->algo : ALGO_BUTKSCRYPT;
+}
+
+static inline int GetAlgoByName(const std::string& strAlgo)
+{
+    const PowAlgorithm* pa = GetPowAlgorithmByName(strAlgo);
+    return pa ? pa->algo : ALGO_BUTKSCRYPT;
+}
+
+static inline std::string GetAlgoName(int algo)
+{
+    const PowAlgorithm* pa = GetPowAlgorithm(algo);
+    return pa ? pa->name : "unknown";
+}
+
+#endif // BITCOIN_POWALGO_H
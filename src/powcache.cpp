@@ -0,0 +1,169 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <powcache.h>
+
+#include <hash.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <sync.h>
+#include <util.h>
+#include <utilstrencodings.h>
+
+#include <array>
+#include <limits>
+#include <list>
+#include <string.h>
+#include <unordered_map>
+
+namespace {
+
+typedef std::array<unsigned char, CBlockHeader::HEADER_SIZE> HeaderBytes;
+
+class SaltedHeaderHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedHeaderHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+    size_t operator()(const HeaderBytes& header) const {
+        return CSipHasher(k0, k1).Write(header.data(), header.size()).Finalize();
+    }
+};
+
+class CPowCache
+{
+private:
+    typedef std::list<std::pair<HeaderBytes, uint256>> list_type;
+
+    CCriticalSection cs;
+    //! Most recently used first
+    list_type lruEntries;
+    std::unordered_map<HeaderBytes, list_type::iterator, SaltedHeaderHasher> mapEntries;
+    size_t nMaxEntries;
+    uint64_t nHits;
+    uint64_t nMisses;
+
+public:
+    CPowCache() : nMaxEntries(DEFAULT_POW_CACHE_SIZE), nHits(0), nMisses(0) {}
+
+    bool Get(const HeaderBytes& header, uint256& hashPoW)
+    {
+        LOCK(cs);
+        auto it = mapEntries.find(header);
+        if (it == mapEntries.end()) {
+            nMisses++;
+            return false;
+        }
+        nHits++;
+        lruEntries.splice(lruEntries.begin(), lruEntries, it->second);
+        hashPoW = it->second->second;
+        return true;
+    }
+
+    void Set(const HeaderBytes& header, const uint256& hashPoW)
+    {
+        LOCK(cs);
+        auto it = mapEntries.find(header);
+        if (it != mapEntries.end()) {
+            lruEntries.splice(lruEntries.begin(), lruEntries, it->second);
+            return;
+        }
+        if (nMaxEntries == 0)
+            return;
+        while (mapEntries.size() >= nMaxEntries) {
+            mapEntries.erase(lruEntries.back().first);
+            lruEntries.pop_back();
+        }
+        lruEntries.emplace_front(header, hashPoW);
+        mapEntries.emplace(header, lruEntries.begin());
+    }
+
+    void SetMaxEntries(size_t n)
+    {
+        LOCK(cs);
+        nMaxEntries = n;
+        while (mapEntries.size() > nMaxEntries) {
+            mapEntries.erase(lruEntries.back().first);
+            lruEntries.pop_back();
+        }
+    }
+
+    void GetStats(PowCacheStats& stats)
+    {
+        LOCK(cs);
+        stats.nEntries = mapEntries.size();
+        stats.nMaxEntries = nMaxEntries;
+        stats.nHits = nHits;
+        stats.nMisses = nMisses;
+    }
+
+    void Clear()
+    {
+        LOCK(cs);
+        mapEntries.clear();
+        lruEntries.clear();
+        nHits = 0;
+        nMisses = 0;
+    }
+};
+
+CPowCache powCache;
+
+/** Whether header's PoW hash is worth remembering, see powcache.h */
+bool IsCacheable(const CBlockHeader& header)
+{
+    const int algo = header.GetAlgo();
+    return algo != ALGO_SHA256D && algo != ALGO_BUTKSCRYPT;
+}
+
+HeaderBytes GetHeaderBytes(const CBlockHeader& header)
+{
+    HeaderBytes bytes;
+    memcpy(bytes.data(), BEGIN(header.nVersion), bytes.size());
+    return bytes;
+}
+
+} // namespace
+
+void InitPowCache()
+{
+    const size_t nMaxEntries = std::max((int64_t)0, gArgs.GetArg("-powcachesize", DEFAULT_POW_CACHE_SIZE));
+    powCache.SetMaxEntries(nMaxEntries);
+    LogPrintf("Using a proof of work cache of %u headers\n", nMaxEntries);
+}
+
+bool LookupPowCache(const CBlockHeader& header, uint256& hashPoW)
+{
+    if (!IsCacheable(header))
+        return false;
+    return powCache.Get(GetHeaderBytes(header), hashPoW);
+}
+
+void InsertPowCache(const CBlockHeader& header, const uint256& hashPoW)
+{
+    if (IsCacheable(header))
+        powCache.Set(GetHeaderBytes(header), hashPoW);
+}
+
+uint256 GetPowHashCached(const CBlockHeader& header)
+{
+    uint256 hashPoW;
+    if (!LookupPowCache(header, hashPoW))
+        hashPoW = header.GetPOWHash(header.GetAlgo());
+    return hashPoW;
+}
+
+void GetPowCacheStats(PowCacheStats& stats)
+{
+    powCache.GetStats(stats);
+}
+
+void ClearPowCache()
+{
+    powCache.Clear();
+}
@@ -0,0 +1,44 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_POWCACHE_H
+#define BITCOIN_POWCACHE_H
+
+#include <uint256.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+class CBlockHeader;
+
+/** Default number of verified headers to remember */
+static const unsigned int DEFAULT_POW_CACHE_SIZE = 4096;
+
+struct PowCacheStats
+{
+    size_t nEntries;
+    size_t nMaxEntries;
+    uint64_t nHits;
+    uint64_t nMisses;
+};
+
+/**
+ * Headers whose proof of work has been verified, with their PoW hash, so
+ * that a header relayed by many peers, announced again in a compact block or
+ * resubmitted by a pool is GhostRider/yespower/Lyra2/scrypt hashed only
+ * once. Entries are keyed by all 80 header bytes, so siblings with the same
+ * hashPrevBlock never share one. Algorithms whose PoW hash is plain SHA256d
+ * are not cached: hashing them again is as cheap as the lookup.
+ */
+void InitPowCache();
+/** Whether header was verified before; hashPoW is set if so */
+bool LookupPowCache(const CBlockHeader& header, uint256& hashPoW);
+/** Remember that hashPoW is the PoW hash of header and satisfies its nBits */
+void InsertPowCache(const CBlockHeader& header, const uint256& hashPoW);
+/** header.GetPOWHash(header.GetAlgo()), from the cache if header was verified before */
+uint256 GetPowHashCached(const CBlockHeader& header);
+void GetPowCacheStats(PowCacheStats& stats);
+void ClearPowCache();
+
+#endif // BITCOIN_POWCACHE_H
@@ -5,14 +5,15 @@
 
 #include <primitives/block.h>
 
+#include <arith_uint256.h>
 #include <hash.h>
 #include <streams.h>
 #include <tinyformat.h>
 #include <utilstrencodings.h>
 #include <crypto/common.h>
-#include <crypto/scrypt.h>
-#include <crypto/algos/yespower/yespower.h>
-#include <crypto/algos/Lyra2Z/Lyra2.h>
+
+#include <algorithm>
+#include <string.h>
 
 int ALGO = ALGO_BUTKSCRYPT;
 
@@ -27,45 +28,133 @@ uint256 CBlockHeader::GetSerializedHash() const
     return SerializeHash(*this);
 }
 
-uint256 CBlockHeader::GetPOWHash(int algo) const
+namespace {
+
+/**
+ * The last few proof of work hashes computed on this thread, with the
+ * algorithm and the header bytes they were computed from, for the validation
+ * paths that hash the same header more than once. A header that changed in
+ * between simply misses. Kept per thread rather than in CBlockHeader, so that
+ * headers stay small and lookups need no lock.
+ */
+class CPowHashMemo
 {
-    uint256 thash;
-    switch (algo)
+private:
+    static const size_t ENTRIES = 4;
+
+    struct Entry {
+        int algo;
+        unsigned char header[CBlockHeader::HEADER_SIZE];
+        uint256 hash;
+    };
+
+    Entry entries[ENTRIES];
+    size_t nNext;
+
+public:
+    CPowHashMemo() : nNext(0)
     {
-        case ALGO_SHA256D:
-        {
-            return GetSerializedHash();
-        }
-        case ALGO_GHOSTRIDER:
-        {
-            return HashGR(BEGIN(nVersion), END(nNonce), hashPrevBlock);
-        }
-        case ALGO_YESPOWER:
-        {
-            uint256 thash;
-            yespower_hash(BEGIN(nVersion), BEGIN(thash));
-            return thash;
-        }
-        case ALGO_LYRA2:
-        {
-            uint256 powHash;
-            LYRA2(BEGIN(powHash), 32, BEGIN(nVersion), 80, BEGIN(nVersion), 80, 2, 330, 256);
-            return powHash;
-        }
-        case ALGO_SCRYPT:
-        {
-            uint256 thash;
-            scrypt_1024_1_1_256(BEGIN(nVersion), BEGIN(thash));
-            return thash;
+        for (Entry& entry : entries)
+            entry.algo = -1;
+    }
+
+    bool Get(int algo, const void* header, uint256& hash) const
+    {
+        for (const Entry& entry : entries) {
+            if (entry.algo == algo && memcmp(entry.header, header, sizeof(entry.header)) == 0) {
+                hash = entry.hash;
+                return true;
+            }
         }
-        case ALGO_BUTKSCRYPT:
-        default:
-            scrypt_1024_1_1_256(BEGIN(nVersion), BEGIN(thash));
+        return false;
+    }
 
+    void Set(int algo, const void* header, const uint256& hash)
+    {
+        Entry& entry = entries[nNext];
+        nNext = (nNext + 1) % ENTRIES;
+        entry.algo = algo;
+        memcpy(entry.header, header, sizeof(entry.header));
+        entry.hash = hash;
     }
-    return GetHash();
+};
+
+thread_local CPowHashMemo powHashMemo;
+
+} // namespace
+
+uint256 CBlockHeader::GetPOWHash(int algo) const
+{
+    // SHA256d is cheap enough that remembering it does not pay off
+    if (algo == ALGO_SHA256D)
+        return GetSerializedHash();
+
+    uint256 thash;
+    if (powHashMemo.Get(algo, BEGIN(nVersion), thash))
+        return thash;
+    thash = ComputePOWHash(algo);
+    powHashMemo.Set(algo, BEGIN(nVersion), thash);
+    return thash;
 }
 
+uint256 CBlockHeader::ComputePOWHash(int algo) const
+{
+    // ButKScrypt blocks are checked against the SHA256d header hash
+    const PowAlgorithm* pa = GetPowAlgorithm(algo);
+    if (!pa)
+        return GetHash();
+    uint256 thash;
+    pa->hash((const unsigned char*)BEGIN(nVersion), thash);
+    return thash;
+}
+
+bool ScanNonces(const CBlockHeader& header, uint32_t nNonceStart, uint32_t nCount, const arith_uint256& target, int algo, uint32_t& nNonceOut, uint256& hashOut)
+{
+    static const size_t NONCE_OFFSET = 76;
+    static const uint32_t MAX_BATCH = 64;
+    static_assert(CBlockHeader::HEADER_SIZE == NONCE_OFFSET + 4, "nNonce must be the last header field");
+
+    unsigned char buf[CBlockHeader::HEADER_SIZE];
+    memcpy(buf, BEGIN(header.nVersion), sizeof(buf));
+
+    // Anything unknown is checked against the SHA256d hash, see ComputePOWHash
+    const PowAlgorithm* pa = GetPowAlgorithm(algo);
+    if (!pa)
+        pa = GetPowAlgorithm(ALGO_SHA256D);
+
+    if (pa->batchHash) {
+        const uint32_t nBatch = std::min(pa->nBatchSize, MAX_BATCH);
+        uint32_t nonces[MAX_BATCH];
+        uint256 hashes[MAX_BATCH];
+        for (uint32_t begin = 0; begin < nCount; begin += nBatch) {
+            const uint32_t n = std::min(nBatch, nCount - begin);
+            for (uint32_t i = 0; i < n; i++)
+                nonces[i] = nNonceStart + begin + i;
+            pa->batchHash(buf, nonces, hashes, n);
+            for (uint32_t i = 0; i < n; i++) {
+                if (UintToArith256(hashes[i]) <= target) {
+                    nNonceOut = nonces[i];
+                    hashOut = hashes[i];
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    for (uint32_t i = 0; i < nCount; i++) {
+        const uint32_t nNonce = nNonceStart + i;
+        WriteLE32(buf + NONCE_OFFSET, nNonce);
+        uint256 hash;
+        pa->hash(buf, hash);
+        if (UintToArith256(hash) <= target) {
+            nNonceOut = nNonce;
+            hashOut = hash;
+            return true;
+        }
+    }
+    return false;
+}
 
 std::string CBlock::ToString() const
 {
@@ -6,76 +6,11 @@
 #ifndef BITCOIN_PRIMITIVES_BLOCK_H
 #define BITCOIN_PRIMITIVES_BLOCK_H
 
+#include <powalgo.h>
 #include <primitives/transaction.h>
 #include <serialize.h>
 #include <uint256.h>
 
-enum
-{
-    ALGO_BUTKSCRYPT  = 0,
-    ALGO_SHA256D     = 1,
-    ALGO_LYRA2       = 2,
-    ALGO_GHOSTRIDER  = 3,
-    ALGO_YESPOWER    = 4,
-    ALGO_SCRYPT      = 5
-};
-
-const int NUM_ALGOS   = 3;
-const int NUM_ALGOSV2 = 4;
-const int NUM_ALGOSV3 = 5;
-const int NUM_ALGOSV4 = 6;
-enum
-{
-    // primary version
-BLOCK_VERSION_DEFAULT = 2,
-
-    // algo
-    BLOCK_VERSION_ALGO_BROKEN    = (10 << 11), //'101000000000000' 10 (broken bitmask)
-    BLOCK_VERSION_ALGO           = (15 << 11), //'111100000000000' 15 (bitmask)
-    BLOCK_VERSION_BUTKSCRYPT     = (1  << 11), //'000100000000000' 1
-    BLOCK_VERSION_SHA256D        = (2  << 11), //'001000000000000' 2
-    BLOCK_VERSION_GHOSTRIDER     = (3  << 11), //'001100000000000' 3
-    BLOCK_VERSION_YESPOWER 	 = (4  << 11), //'010000000000000' 4
-    BLOCK_VERSION_LYRA2 	 = (10 << 11), //'101000000000000' 10
-    BLOCK_VERSION_SCRYPT         = (5  << 11),
-};
-
-static inline int GetAlgoByName(std::string strAlgo){
-    if (strAlgo == "butkscrypt")
-        return ALGO_BUTKSCRYPT;
-    if (strAlgo == "sha" || strAlgo == "sha256" || strAlgo == "sha256d")
-        return ALGO_SHA256D;
-    if (strAlgo == "ghostrider")
-	    return ALGO_GHOSTRIDER;
-    if (strAlgo == "lyra" || strAlgo == "lyra2re" || strAlgo == "lyra2v2" || strAlgo == "lyra2" || strAlgo == "lyra2rev2")
-	    return ALGO_LYRA2;
-    if (strAlgo == "yespower")
-            return ALGO_YESPOWER;
-    if (strAlgo == "scrypt")
-            return ALGO_SCRYPT;
-    return ALGO_BUTKSCRYPT;
-}
-
-static inline std::string GetAlgoName(int algo)
-{
-    switch (algo)
-    {
-        case ALGO_SCRYPT:
-            return std::string("scrypt");
-        case ALGO_BUTKSCRYPT:
-            return std::string("butkscrypt");
-        case ALGO_SHA256D:
-            return std::string("sha256d");
-        case ALGO_LYRA2:
-            return std::string("lyra2");
-        case ALGO_YESPOWER:
-            return std::string("yespower");
-        case ALGO_GHOSTRIDER:
-            return std::string("ghostrider");
-    }
-    return std::string("unknown");
-}
-
 /**
  * Current default algo to use from multi algo
  */
@@ -91,6 +26,9 @@ extern int ALGO;
 class CBlockHeader
 {
 public:
+    //! Size of the serialized header, all of which the proof of work hashes cover
+    static const size_t HEADER_SIZE = 80;
+
     // header
     int32_t nVersion;
     uint256 hashPrevBlock;
@@ -98,7 +36,6 @@ public:
     uint32_t nTime;
     uint32_t nBits;
     uint32_t nNonce;
-    uint256 hash;
 
     CBlockHeader()
     {
@@ -115,9 +52,6 @@ public:
         READWRITE(nTime);
         READWRITE(nBits);
         READWRITE(nNonce);
-        if(ser_action.ForRead()){
-            this->hash = GetPOWHash(ALGO_SCRYPT);
-        }
     }
 
     void SetNull()
@@ -137,27 +71,12 @@ public:
 
     uint256 GetSerializedHash() const;
     uint256 GetHash() const;
+    /** Proof of work hash with the given algorithm; the last few computed on a thread are remembered */
     uint256 GetPOWHash(int algo) const;
 
     int GetAlgo() const
     {
-        switch (nVersion & BLOCK_VERSION_ALGO)
-        {
-            case BLOCK_VERSION_SCRYPT:
-                return ALGO_SCRYPT;
-            case BLOCK_VERSION_BUTKSCRYPT:
-                return ALGO_BUTKSCRYPT;
-            case BLOCK_VERSION_SHA256D:
-                return ALGO_SHA256D;
-            case BLOCK_VERSION_LYRA2:
-                return ALGO_LYRA2;
-            case BLOCK_VERSION_GHOSTRIDER:
-                return ALGO_GHOSTRIDER;
-            case BLOCK_VERSION_YESPOWER:
-                return ALGO_YESPOWER;
-        }
-
-        return ALGO_BUTKSCRYPT;
+        return GetAlgoByVersion(nVersion);
     }
 
     std::string GetAlgoName() const
@@ -169,6 +88,9 @@ public:
     {
         return (int64_t)nTime;
     }
+
+private:
+    uint256 ComputePOWHash(int algo) const;
 };
 
 
@@ -224,6 +146,17 @@ public:
     std::string ToString() const;
 };
 
+class arith_uint256;
+
+/**
+ * Search nNonce = nNonceStart .. nNonceStart + nCount - 1 of header (all
+ * other fields unchanged) for a proof of work hash with the given algorithm
+ * at or below target. The 76 bytes in front of the nonce are absorbed once
+ * where the algorithm allows it. On success nNonceOut and hashOut are set to
+ * the first winning nonce and its hash, which equals GetPOWHash(algo).
+ */
+bool ScanNonces(const CBlockHeader& header, uint32_t nNonceStart, uint32_t nCount, const arith_uint256& target, int algo, uint32_t& nNonceOut, uint256& hashOut);
+
 
 /** Describes a place in the block chain to another node such that if the
  * other node doesn't have the same branch, it can find a recent common trunk.
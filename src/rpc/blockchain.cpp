@@ -18,6 +18,7 @@
 #include <core_io.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
+#include <powcache.h>
 #include <primitives/transaction.h>
 #include <rpc/server.h>
 #include <streams.h>
@@ -27,6 +28,9 @@
 #include <util.h>
 #include <utilstrencodings.h>
 #include <hash.h>
+#include <index/addressindex.h>
+#include <index/spentindex.h>
+#include <index/timestampindex.h>
 
 #include <evo/specialtx.h>
 #include <evo/cbtx.h>
@@ -56,9 +60,11 @@ static CUpdatedBlock latestblock;
 
 CBlockIndex* GetLastBlockIndex4Algo(CBlockIndex* pindex, int algo)
 {
-    while (pindex && pindex->pprev && pindex->GetBlockHeader().GetAlgo() != algo)
-        pindex = pindex->pprev;
-    return pindex;
+    if (!pindex)
+        return nullptr;
+    // Genesis if no block was mined with algo
+    CBlockIndex* plast = pindex->GetLastAlgo(algo);
+    return plast ? plast : pindex->GetAncestor(0);
 }
 
 double GetDifficulty(int algo){
@@ -131,7 +137,7 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
 {
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
-    result.pushKV("pow_hash", block.GetPOWHash(block.GetAlgo()).GetHex());
+    result.pushKV("pow_hash", blockindex->GetBlockPoWHash().GetHex());
     result.pushKV("algo", GetAlgoName(block.GetAlgo()));
 
     int confirmations = -1;
@@ -671,6 +677,16 @@ UniValue getmempoolentry(const JSONRPCRequest& request)
     return info;
 }
 
+void WaitForIndex(BaseIndex* index, int nHeight)
+{
+    if (!index)
+        return;
+    if (!index->BlockUntilSyncedToHeight(nHeight, DEFAULT_INDEX_RPC_WAIT_MS)) {
+        const CBlockIndex* pbest = index->GetBestBlockIndex();
+        throw JSONRPCError(RPC_MISC_ERROR, strprintf("The %s is still being built, it is at height %d", index->GetName(), pbest ? pbest->nHeight : -1));
+    }
+}
+
 UniValue getblockhashes(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 2)
@@ -693,6 +709,8 @@ UniValue getblockhashes(const JSONRPCRequest& request)
     unsigned int low = request.params[1].get_int();
     std::vector<uint256> blockHashes;
 
+    WaitForIndex(g_timestampindex.get(), -1);
+
     if (!GetTimestampIndex(high, low, blockHashes)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for block hashes");
     }
@@ -1681,6 +1699,67 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
     return mempoolInfoToJSON();
 }
 
+UniValue getpowcacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getpowcacheinfo\n"
+            "\nReturns details on the cache of block headers whose proof of work was already verified.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"size\": xxxxx,               (numeric) Current number of cached headers\n"
+            "  \"maxsize\": xxxxx,            (numeric) Maximum number of cached headers (-powcachesize)\n"
+            "  \"hits\": xxxxx,               (numeric) Headers whose proof of work was not hashed again\n"
+            "  \"misses\": xxxxx              (numeric) Headers that had to be hashed\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getpowcacheinfo", "")
+            + HelpExampleRpc("getpowcacheinfo", "")
+        );
+
+    PowCacheStats stats;
+    GetPowCacheStats(stats);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("size", (uint64_t)stats.nEntries);
+    ret.pushKV("maxsize", (uint64_t)stats.nMaxEntries);
+    ret.pushKV("hits", stats.nHits);
+    ret.pushKV("misses", stats.nMisses);
+    return ret;
+}
+
+UniValue getindexinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getindexinfo\n"
+            "\nReturns the state of the optional indexes, which are built in the background.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": {                   (object) One entry for every enabled index\n"
+            "    \"synced\": true|false,      (boolean) Whether the index has caught up with the active chain\n"
+            "    \"best_block_height\": xxxxx (numeric) Height of the last block in the index\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getindexinfo", "")
+            + HelpExampleRpc("getindexinfo", "")
+        );
+
+    UniValue ret(UniValue::VOBJ);
+    for (const BaseIndex* index : std::vector<const BaseIndex*>{g_addressindex.get(), g_spentindex.get(), g_timestampindex.get()}) {
+        if (!index)
+            continue;
+        const CBlockIndex* pbest = index->GetBestBlockIndex();
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("synced", index->IsSynced());
+        entry.pushKV("best_block_height", pbest ? pbest->nHeight : -1);
+        ret.pushKV(index->GetName(), entry);
+    }
+    return ret;
+}
+
 UniValue preciousblock(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -2235,6 +2314,8 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  true,  {"txid","verbose"} },
     { "blockchain",         "getmempoolentry",        &getmempoolentry,        true,  {"txid"} },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  {} },
+    { "blockchain",         "getpowcacheinfo",        &getpowcacheinfo,        true,  {} },
+    { "blockchain",         "getindexinfo",           &getindexinfo,           true,  {} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true,  {"verbose"} },
     { "blockchain",         "getspecialtxes",         &getspecialtxes,         true,  {"blockhash", "type", "count", "skip", "verbosity"} },
     { "blockchain",         "gettxout",               &gettxout,               true,  {"txid","n","include_mempool"} },
@@ -5,6 +5,7 @@
 #ifndef BITCOIN_RPC_BLOCKCHAIN_H
 #define BITCOIN_RPC_BLOCKCHAIN_H
 
+class BaseIndex;
 class CBlock;
 class CBlockIndex;
 class UniValue;
@@ -35,6 +36,13 @@ UniValue mempoolToJSON(bool fVerbose = false);
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* blockindex);
 
+/**
+ * Wait for an optional index to reach the block of the active chain at nHeight
+ * (the tip if negative), so that it answers for the chain the caller sees.
+ * Throws if it does not get there in time; does nothing for a disabled index.
+ */
+void WaitForIndex(BaseIndex* index, int nHeight);
+
 CBlockIndex* GetLastBlockIndex4Algo(CBlockIndex* pindex, int algo);
 
 #endif
@@ -13,6 +13,7 @@
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <crypto/pow_scratch.h>
 #include <init.h>
 #include <validation.h>
 #include <miner.h>
@@ -42,7 +43,6 @@
 
 #include <univalue.h>
 
-extern double nHashesPerSec;
 extern std::string alsoHashString;
 
 unsigned int ParseConfirmTarget(const UniValue& value)
@@ -182,7 +182,20 @@ UniValue generateBlocks(std::shared_ptr<CReserveScript> coinbaseScript, int nGen
             LOCK(cs_main);
             IncrementExtraNonce(pblock, chainActive.Tip(), nExtraNonce);
         }
-        while (nMaxTries > 0 && pblock->nNonce < nInnerLoopCount && !CheckProofOfWork(pblock->GetPOWHash(pblock->GetAlgo()), pblock->nBits, Params().GetConsensus())) {
+        const arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
+        while (nMaxTries > 0 && pblock->nNonce < nInnerLoopCount) {
+            const uint32_t nCount = std::min<uint64_t>(nMaxTries, nInnerLoopCount - pblock->nNonce);
+            uint32_t nNonceFound;
+            uint256 hash;
+            if (!ScanNonces(*pblock, pblock->nNonce, nCount, hashTarget, pblock->GetAlgo(), nNonceFound, hash)) {
+                pblock->nNonce += nCount;
+                nMaxTries -= nCount;
+                continue;
+            }
+            nMaxTries -= nNonceFound - pblock->nNonce;
+            pblock->nNonce = nNonceFound;
+            if (CheckProofOfWork(hash, pblock->nBits, Params().GetConsensus()))
+                break;
             ++pblock->nNonce;
             --nMaxTries;
         }
@@ -256,6 +269,29 @@ UniValue getmininginfo(const JSONRPCRequest& request)
             "  \"errors\": \"...\"            (string) Current errors\n"
             "  \"networkhashps\": nnn,      (numeric) The network hashes per second\n"
 			"  \"hashespersec\": nnn,       (numeric) Your current hashes per second\n"
+            "  \"hashespersec_algos\": {     (json object) Your current hashes per second by algorithm\n"
+            "     \"algo\": nnn,\n"
+            "     ...\n"
+            "  },\n"
+            "  \"minerthreads\": [           (array) One entry per internal miner thread\n"
+            "     {\n"
+            "       \"thread\": n,            (numeric) Thread index\n"
+            "       \"algo\": \"xxxx\",         (string) Algorithm the thread is mining\n"
+            "       \"cpu\": n,               (numeric) CPU the thread is pinned to, -1 if none\n"
+            "       \"hashes\": n,            (numeric) Hashes computed since mining started\n"
+            "       \"hashespersec\": nnn     (numeric) Average hashes per second of the thread\n"
+            "     }, ...\n"
+            "  ],\n"
+            "  \"powbackends\": {           (json object) Proof of work implementation selected for each algorithm\n"
+            "     \"algo\": \"xxxx\",\n"
+            "     ...\n"
+            "  },\n"
+            "  \"powscratchpads\": {        (json object) Memory of the proof of work scratchpads (-powhugepages)\n"
+            "     \"mode\": \"xxxx\",          (string) Pages a new scratchpad gets: huge, transparent huge or normal\n"
+            "     \"hugebytes\": n,           (numeric) Bytes allocated from explicit huge pages\n"
+            "     \"transparenthugebytes\": n, (numeric) Bytes allocated with transparent huge pages asked for\n"
+            "     \"normalbytes\": n          (numeric) Bytes allocated from normal pages\n"
+            "  },\n"
 			"  \"algos\": nnn,              (string) Current solving block algos orders\n"
             "  \"pooledtx\": n              (numeric) The size of the mempool\n"
             "  \"chain\": \"xxxx\",           (string) current network name as defined in BIP70 (main, test, regtest)\n"
@@ -281,7 +317,39 @@ UniValue getmininginfo(const JSONRPCRequest& request)
     obj.pushKV("networkhashps_sha256d",    GetNetworkHashPS(120, -1, ALGO_SHA256D));
     obj.pushKV("networkhashps_scrypt",     GetNetworkHashPS(120, -1, ALGO_SCRYPT));
     obj.pushKV("networkhashps_butkscrypt", GetNetworkHashPS(120, -1, ALGO_BUTKSCRYPT));
-    obj.push_back(Pair("hashespersec",     (double)nHashesPerSec));
+
+    double dHashesPerSec = 0;
+    std::map<std::string, double> mapAlgoHashesPerSec;
+    UniValue threads(UniValue::VARR);
+    for (const MinerThreadStats& stats : GetMinerStats()) {
+        dHashesPerSec += stats.dHashesPerSec;
+        mapAlgoHashesPerSec[GetAlgoName(stats.nAlgo)] += stats.dHashesPerSec;
+        UniValue thread(UniValue::VOBJ);
+        thread.pushKV("thread", stats.nThread);
+        thread.pushKV("algo", GetAlgoName(stats.nAlgo));
+        thread.pushKV("cpu", stats.nCpu);
+        thread.pushKV("hashes", stats.nHashes);
+        thread.pushKV("hashespersec", stats.dHashesPerSec);
+        threads.push_back(thread);
+    }
+    UniValue algos(UniValue::VOBJ);
+    for (const auto& pair : mapAlgoHashesPerSec)
+        algos.pushKV(pair.first, pair.second);
+    obj.push_back(Pair("hashespersec",     dHashesPerSec));
+    obj.pushKV("hashespersec_algos",       algos);
+    obj.pushKV("minerthreads",             threads);
+    UniValue backends(UniValue::VOBJ);
+    for (const PowAlgorithm& pa : GetPowAlgorithms())
+        backends.pushKV(pa.name, pa.strBackend);
+    obj.pushKV("powbackends",              backends);
+    size_t nScratchBytes[POW_SCRATCH_NUM_MODES];
+    pow_scratch_usage(nScratchBytes);
+    UniValue scratchpads(UniValue::VOBJ);
+    scratchpads.pushKV("mode", GetPowScratchMode());
+    scratchpads.pushKV("hugebytes", (uint64_t)nScratchBytes[POW_SCRATCH_HUGETLB]);
+    scratchpads.pushKV("transparenthugebytes", (uint64_t)nScratchBytes[POW_SCRATCH_THP]);
+    scratchpads.pushKV("normalbytes", (uint64_t)nScratchBytes[POW_SCRATCH_NORMAL]);
+    obj.pushKV("powscratchpads",           scratchpads);
 	obj.push_back(Pair("algos",            (std::string)alsoHashString));
 	obj.push_back(Pair("pooledtx",         (uint64_t)mempool.size()));
 	obj.push_back(Pair("chain",            Params().NetworkIDString()));
@@ -510,20 +578,8 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     }
     int algo = miningAlgo;
     if (!request.params[1].isNull()) {
-        std::string strAlgo = request.params[1].get_str();
-        transform(strAlgo.begin(),strAlgo.end(),strAlgo.begin(),::tolower);
-        if (strAlgo == "sha" || strAlgo == "sha256" || strAlgo == "sha256d")
-            algo = ALGO_SHA256D;
-        else if (strAlgo == "butkscrypt")
-            algo = ALGO_BUTKSCRYPT;
-        else if (strAlgo == "scrypt")
-            algo = ALGO_SCRYPT;
-        else if (strAlgo == "ghostrider")
-            algo = ALGO_GHOSTRIDER;
-        else if (strAlgo == "yespower")
-            algo = ALGO_YESPOWER;
-        else if (strAlgo == "lyra2" || strAlgo == "lyra2z330")
-            algo = ALGO_LYRA2;
+        if (const PowAlgorithm* pa = GetPowAlgorithmByName(request.params[1].get_str()))
+            algo = pa->algo;
     }
 
     if (strMode != "template")
@@ -598,31 +654,12 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     }
 
     // Update block
-    static CBlockIndex* pindexPrev;
-    static int64_t nStart;
-    static std::unique_ptr<CBlockTemplate> pblocktemplate;
-    static int lastAlgo;
-    if (pindexPrev != chainActive.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5) || algo != lastAlgo)
-    {
-        // Clear pindexPrev so future calls make a new block, despite any failures from here on
-        pindexPrev = nullptr;
-
-        // Store the chainActive.Tip() used before CreateNewBlock, to avoid races
-        nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-        CBlockIndex* pindexPrevNew = chainActive.Tip();
-        nStart = GetTime();
-	lastAlgo = algo;
-
-        // Create new block
-        CScript scriptDummy = CScript() << OP_TRUE;
-        pblocktemplate = BlockAssembler(Params()).CreateNewBlock(scriptDummy, algo);
-        if (!pblocktemplate)
-            throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
-
-        // Need to update only after we know CreateNewBlock succeeded
-        pindexPrev = pindexPrevNew;
-    }
+    if (!g_blockTemplateManager)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block template manager not available");
+    std::shared_ptr<CBlockTemplate> pblocktemplate = g_blockTemplateManager->GetBlockTemplate(algo, nTransactionsUpdatedLast);
+    if (!pblocktemplate)
+        throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
+    CBlockIndex* const pindexPrev = chainActive.Tip();
     CBlock* pblock = &pblocktemplate->block; // pointer for convenience
     const Consensus::Params& consensusParams = Params().GetConsensus();
 
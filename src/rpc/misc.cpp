@@ -11,6 +11,8 @@
 #include <core_io.h>
 #include <init.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
+#include <index/spentindex.h>
 #include <net.h>
 #include <netbase.h>
 #include <rpc/blockchain.h>
@@ -843,6 +845,8 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    WaitForIndex(g_addressindex.get(), -1);
+
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
@@ -927,6 +931,8 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    WaitForIndex(g_addressindex.get(), start > 0 && end > 0 ? end : -1);
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
@@ -968,6 +974,7 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         throw std::runtime_error(
             "getaddressbalance\n"
             "\nReturns the balance for an address(es) (requires addressindex to be enabled).\n"
+            "With -addressbalanceindex this is a lookup of the stored totals rather than a scan of the address history.\n"
             "\nArguments:\n"
             "{\n"
             "  \"addresses\"\n"
@@ -992,6 +999,27 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    WaitForIndex(g_addressindex.get(), -1);
+
+    CAmount balance = 0;
+    CAmount received = 0;
+
+    if (fAddressBalanceIndex) {
+        for (const auto& address : addresses) {
+            CAddressBalanceValue value;
+            if (!GetAddressBalance(address.first, address.second, value)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+            balance += value.balance;
+            received += value.received;
+        }
+
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("balance", balance));
+        result.push_back(Pair("received", received));
+        return result;
+    }
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
@@ -1000,9 +1028,6 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         }
     }
 
-    CAmount balance = 0;
-    CAmount received = 0;
-
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
         if (it->second > 0) {
             received += it->second;
@@ -1061,6 +1086,8 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         }
     }
 
+    WaitForIndex(g_addressindex.get(), start > 0 && end > 0 ? end : -1);
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
@@ -1133,6 +1160,8 @@ UniValue getspentinfo(const JSONRPCRequest& request)
     uint256 txid = ParseHashV(txidValue, "txid");
     int outputIndex = indexValue.get_int();
 
+    WaitForIndex(g_spentindex.get(), -1);
+
     CSpentIndexKey key(txid, outputIndex);
     CSpentIndexValue value;
 
@@ -0,0 +1,649 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stratum.h>
+
+#include <arith_uint256.h>
+#include <base58.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <hash.h>
+#include <miner.h>
+#include <netbase.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <sync.h>
+#include <timedata.h>
+#include <txmempool.h>
+#include <util.h>
+#include <utilstrencodings.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <univalue.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <set>
+#include <thread>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+
+namespace {
+
+/** Bytes of the coinbase extranonce chosen by the server, one value per connection */
+const size_t EXTRANONCE1_SIZE = 4;
+/** Bytes of the coinbase extranonce chosen by the miner */
+const size_t EXTRANONCE2_SIZE = 4;
+/** Maximum length of an incoming line, to protect against memory exhaustion */
+const size_t MAX_LINE_LENGTH = 16 * 1024;
+/** Number of jobs for the current tip that shares are still accepted for */
+const size_t MAX_JOBS = 16;
+/** Shares remembered per job to reject duplicates, about 10 MB over MAX_JOBS jobs */
+const size_t MAX_JOB_SHARES = 8192;
+
+/** A block template with its coinbase split around the extranonces */
+struct StratumJob
+{
+    std::string strId;
+    CBlock block;
+    int64_t nMinTime;
+    unsigned int nTransactionsUpdated;
+    int64_t nCreated;
+    std::vector<unsigned char> vCoinbase1;
+    std::vector<unsigned char> vCoinbase2;
+    /** Hashes to combine with the coinbase txid, bottom up, to get the merkle root */
+    std::vector<uint256> vMerkleBranch;
+    /** Block hashes of the valid shares submitted so far, to reject duplicates */
+    std::set<uint256> setShares;
+};
+
+struct StratumClient
+{
+    struct bufferevent* bev;
+    std::string strPeer;
+    uint32_t nExtraNonce1;
+    bool fSubscribed;
+    bool fAuthorized;
+};
+
+/** Stratum error triple: [code, message, traceback] */
+UniValue StratumError(int nCode, const std::string& strMessage)
+{
+    UniValue error(UniValue::VARR);
+    error.push_back(nCode);
+    error.push_back(strMessage);
+    error.push_back(NullUniValue);
+    return error;
+}
+
+bool ParseHex32(const UniValue& value, uint32_t& n)
+{
+    if (!value.isStr() || value.get_str().size() != 8 || !IsHex(value.get_str()))
+        return false;
+    n = strtoul(value.get_str().c_str(), nullptr, 16);
+    return true;
+}
+
+/** The previous block hash as miners expect it: our byte order with every 32-bit word swapped */
+std::string PrevHashHex(const uint256& hash)
+{
+    std::vector<unsigned char> v(hash.begin(), hash.end());
+    for (size_t i = 0; i < v.size(); i += 4)
+        std::reverse(v.begin() + i, v.begin() + i + 4);
+    return HexStr(v);
+}
+
+/**
+ * Target of a difficulty 1 share. Miners measure SHA256d shares against the
+ * Bitcoin difficulty 1 target and everything else against the one scrypt
+ * pools use, which is 65536 times easier.
+ */
+arith_uint256 Diff1Target(int algo)
+{
+    return arith_uint256().SetCompact(algo == ALGO_SHA256D ? 0x1d00ffff : 0x1f00ffff);
+}
+
+arith_uint256 ShareTarget(int algo, double dDifficulty)
+{
+    // Scale by 2^16 to keep fractional difficulties; diff1 << 16 still fits
+    const uint64_t nScaled = std::max<uint64_t>(1, dDifficulty * 65536);
+    return (Diff1Target(algo) << 16) / nScaled;
+}
+
+class StratumServer final : public CValidationInterface
+{
+public:
+    StratumServer(struct event_base* baseIn, const CScript& scriptPubKeyIn, double dDifficultyIn);
+    ~StratumServer();
+
+    bool Bind(const CService& addr);
+    /** Build a job on the event thread, clean if the tip changed */
+    void RequestJob() { event_active(evJob, 0, 0); }
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override;
+    void TransactionAddedToMempool(const CTransactionRef& ptx, int64_t nAcceptTime) override;
+
+private:
+    static void AcceptCallback(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* addr, int addrlen, void* ctx);
+    static void ReadCallback(struct bufferevent* bev, void* ctx);
+    static void EventCallback(struct bufferevent* bev, short what, void* ctx);
+    static void JobCallback(evutil_socket_t, short, void* ctx);
+
+    void UpdateJob();
+    std::shared_ptr<StratumJob> CreateJob();
+    /** Handle one request; returns false if the client should be dropped */
+    bool HandleLine(StratumClient& client, const std::string& strLine);
+    UniValue Subscribe(StratumClient& client);
+    UniValue Submit(StratumClient& client, const UniValue& params);
+    void Send(StratumClient& client, const UniValue& msg);
+    void SendWork(StratumClient& client, bool fClean);
+    void Disconnect(struct bufferevent* bev);
+
+    struct event_base* base;
+    struct event* evJob;
+    const CScript scriptPubKey;
+    const double dDifficulty;
+    std::vector<struct evconnlistener*> vListeners;
+    std::map<struct bufferevent*, StratumClient> mapClients;
+    std::map<std::string, std::shared_ptr<StratumJob>> mapJobs;
+    std::deque<std::string> dequeJobIds;
+    std::shared_ptr<StratumJob> currentJob;
+    uint32_t nNextExtraNonce1;
+    uint64_t nNextJobId;
+    std::atomic<bool> fNewTip;
+};
+
+StratumServer::StratumServer(struct event_base* baseIn, const CScript& scriptPubKeyIn, double dDifficultyIn) :
+    base(baseIn), scriptPubKey(scriptPubKeyIn), dDifficulty(dDifficultyIn),
+    nNextExtraNonce1(GetRand(std::numeric_limits<uint32_t>::max())), nNextJobId(0), fNewTip(true)
+{
+    evJob = event_new(base, -1, 0, JobCallback, this);
+    assert(evJob);
+}
+
+StratumServer::~StratumServer()
+{
+    for (auto& pair : mapClients)
+        bufferevent_free(pair.first);
+    for (struct evconnlistener* listener : vListeners)
+        evconnlistener_free(listener);
+    event_free(evJob);
+}
+
+bool StratumServer::Bind(const CService& addr)
+{
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!addr.GetSockAddr((struct sockaddr*)&sockaddr, &len)) {
+        LogPrintf("stratum: Cannot bind to %s\n", addr.ToString());
+        return false;
+    }
+    struct evconnlistener* listener = evconnlistener_new_bind(base, AcceptCallback, this,
+        LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1, (struct sockaddr*)&sockaddr, len);
+    if (!listener) {
+        LogPrintf("stratum: Binding to %s failed\n", addr.ToString());
+        return false;
+    }
+    LogPrintf("stratum: Listening on %s\n", addr.ToString());
+    vListeners.push_back(listener);
+    return true;
+}
+
+void StratumServer::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    if (fInitialDownload)
+        return;
+    fNewTip = true;
+    RequestJob();
+}
+
+void StratumServer::TransactionAddedToMempool(const CTransactionRef& ptx, int64_t nAcceptTime)
+{
+    RequestJob();
+}
+
+void StratumServer::AcceptCallback(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* addr, int addrlen, void* ctx)
+{
+    StratumServer* self = (StratumServer*)ctx;
+    struct bufferevent* bev = bufferevent_socket_new(self->base, fd, BEV_OPT_CLOSE_ON_FREE);
+    if (!bev) {
+        evutil_closesocket(fd);
+        return;
+    }
+
+    CService peer;
+    peer.SetSockAddr(addr);
+    StratumClient& client = self->mapClients[bev];
+    client.bev = bev;
+    client.strPeer = peer.ToString();
+    client.nExtraNonce1 = self->nNextExtraNonce1++;
+    client.fSubscribed = false;
+    client.fAuthorized = false;
+    LogPrint(BCLog::STRATUM, "stratum: Connection from %s\n", client.strPeer);
+
+    bufferevent_setcb(bev, ReadCallback, nullptr, EventCallback, self);
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+}
+
+void StratumServer::ReadCallback(struct bufferevent* bev, void* ctx)
+{
+    StratumServer* self = (StratumServer*)ctx;
+    auto it = self->mapClients.find(bev);
+    if (it == self->mapClients.end())
+        return;
+
+    struct evbuffer* input = bufferevent_get_input(bev);
+    size_t n_read_out = 0;
+    char* line;
+    //  If there is not a whole line to read, evbuffer_readln returns nullptr
+    while ((line = evbuffer_readln(input, &n_read_out, EVBUFFER_EOL_CRLF)) != nullptr) {
+        std::string s(line, n_read_out);
+        free(line);
+        if (s.empty())
+            continue;
+        if (!self->HandleLine(it->second, s)) {
+            self->Disconnect(bev);
+            return;
+        }
+    }
+    if (evbuffer_get_length(input) > MAX_LINE_LENGTH) {
+        LogPrint(BCLog::STRATUM, "stratum: Disconnecting %s because MAX_LINE_LENGTH exceeded\n", it->second.strPeer);
+        self->Disconnect(bev);
+    }
+}
+
+void StratumServer::EventCallback(struct bufferevent* bev, short what, void* ctx)
+{
+    StratumServer* self = (StratumServer*)ctx;
+    if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR))
+        self->Disconnect(bev);
+}
+
+void StratumServer::JobCallback(evutil_socket_t, short, void* ctx)
+{
+    ((StratumServer*)ctx)->UpdateJob();
+}
+
+void StratumServer::Disconnect(struct bufferevent* bev)
+{
+    auto it = mapClients.find(bev);
+    if (it == mapClients.end())
+        return;
+    LogPrint(BCLog::STRATUM, "stratum: %s disconnected\n", it->second.strPeer);
+    mapClients.erase(it);
+    bufferevent_free(bev);
+}
+
+void StratumServer::UpdateJob()
+{
+    if (IsInitialBlockDownload())
+        return;
+
+    bool fClean = fNewTip.exchange(false) || !currentJob;
+    if (!fClean) {
+        {
+            LOCK(cs_main);
+            fClean = currentJob->block.hashPrevBlock != chainActive.Tip()->GetBlockHash();
+        }
+        if (!fClean) {
+            if (mempool.GetTransactionsUpdated() == currentJob->nTransactionsUpdated)
+                return;
+            // Only pick up new transactions every so often; miners restart work for every job
+            const int64_t nWait = currentJob->nCreated + STRATUM_JOB_REFRESH_INTERVAL - GetTime();
+            if (nWait > 0) {
+                struct timeval tv = {nWait, 0};
+                evtimer_add(evJob, &tv);
+                return;
+            }
+        }
+    }
+
+    std::shared_ptr<StratumJob> job = CreateJob();
+    if (!job)
+        return;
+    if (fClean) {
+        mapJobs.clear();
+        dequeJobIds.clear();
+    }
+    mapJobs.emplace(job->strId, job);
+    dequeJobIds.push_back(job->strId);
+    if (dequeJobIds.size() > MAX_JOBS) {
+        mapJobs.erase(dequeJobIds.front());
+        dequeJobIds.pop_front();
+    }
+    currentJob = job;
+
+    LogPrint(BCLog::STRATUM, "stratum: New job %s with %u transactions%s\n", job->strId,
+        job->block.vtx.size(), fClean ? ", clean" : "");
+    for (auto& pair : mapClients) {
+        if (pair.second.fAuthorized)
+            SendWork(pair.second, fClean);
+    }
+}
+
+std::shared_ptr<StratumJob> StratumServer::CreateJob()
+{
+    std::shared_ptr<StratumJob> job = std::make_shared<StratumJob>();
+    job->nTransactionsUpdated = mempool.GetTransactionsUpdated();
+    job->nCreated = GetTime();
+
+    std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(Params()).CreateNewBlock(scriptPubKey, miningAlgo);
+    if (!pblocktemplate) {
+        LogPrintf("stratum: Could not create a block template\n");
+        return nullptr;
+    }
+    job->block = pblocktemplate->block;
+    job->strId = strprintf("%x", ++nNextJobId);
+
+    int nHeight;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator it = mapBlockIndex.find(job->block.hashPrevBlock);
+        if (it == mapBlockIndex.end())
+            return nullptr;
+        nHeight = it->second->nHeight + 1;
+        job->nMinTime = it->second->GetMedianTimePast() + 1;
+    }
+
+    // Serialize the coinbase with two different extranonce placeholders to
+    // find where the extranonces go
+    CMutableTransaction coinbaseTx(*job->block.vtx[0]);
+    std::vector<unsigned char> vSerialized[2];
+    for (int i = 0; i < 2; i++) {
+        std::vector<unsigned char> vPlaceholder(EXTRANONCE1_SIZE + EXTRANONCE2_SIZE, i ? 0xff : 0x00);
+        coinbaseTx.vin[0].scriptSig = (CScript() << nHeight << vPlaceholder) + COINBASE_FLAGS;
+        if (coinbaseTx.vin[0].scriptSig.size() > 100) {
+            LogPrintf("stratum: Coinbase scriptSig too large\n");
+            return nullptr;
+        }
+        CVectorWriter(SER_NETWORK, PROTOCOL_VERSION, vSerialized[i], 0) << coinbaseTx;
+    }
+    const size_t nOffset = std::mismatch(vSerialized[0].begin(), vSerialized[0].end(), vSerialized[1].begin()).first - vSerialized[0].begin();
+    job->vCoinbase1.assign(vSerialized[0].begin(), vSerialized[0].begin() + nOffset);
+    job->vCoinbase2.assign(vSerialized[0].begin() + nOffset + EXTRANONCE1_SIZE + EXTRANONCE2_SIZE, vSerialized[0].end());
+
+    // The coinbase is leaf 0, so its siblings do not depend on it
+    std::vector<uint256> vLevel;
+    for (const auto& tx : job->block.vtx)
+        vLevel.push_back(tx->GetHash());
+    while (vLevel.size() > 1) {
+        job->vMerkleBranch.push_back(vLevel[1]);
+        if (vLevel.size() & 1)
+            vLevel.push_back(vLevel.back());
+        std::vector<uint256> vNext;
+        for (size_t i = 0; i < vLevel.size(); i += 2)
+            vNext.push_back(Hash(vLevel[i].begin(), vLevel[i].end(), vLevel[i + 1].begin(), vLevel[i + 1].end()));
+        vLevel.swap(vNext);
+    }
+    return job;
+}
+
+void StratumServer::Send(StratumClient& client, const UniValue& msg)
+{
+    const std::string str = msg.write() + "\n";
+    evbuffer_add(bufferevent_get_output(client.bev), str.data(), str.size());
+}
+
+void StratumServer::SendWork(StratumClient& client, bool fClean)
+{
+    if (!currentJob)
+        return;
+    const StratumJob& job = *currentJob;
+
+    UniValue difficulty(UniValue::VARR);
+    difficulty.push_back(dDifficulty);
+    UniValue setDifficulty(UniValue::VOBJ);
+    setDifficulty.pushKV("id", NullUniValue);
+    setDifficulty.pushKV("method", "mining.set_difficulty");
+    setDifficulty.pushKV("params", difficulty);
+    Send(client, setDifficulty);
+
+    UniValue branch(UniValue::VARR);
+    for (const uint256& hash : job.vMerkleBranch)
+        branch.push_back(HexStr(hash.begin(), hash.end()));
+    UniValue params(UniValue::VARR);
+    params.push_back(job.strId);
+    params.push_back(PrevHashHex(job.block.hashPrevBlock));
+    params.push_back(HexStr(job.vCoinbase1));
+    params.push_back(HexStr(job.vCoinbase2));
+    params.push_back(branch);
+    params.push_back(strprintf("%08x", (uint32_t)job.block.nVersion));
+    params.push_back(strprintf("%08x", job.block.nBits));
+    params.push_back(strprintf("%08x", job.block.nTime));
+    params.push_back(fClean);
+    UniValue notify(UniValue::VOBJ);
+    notify.pushKV("id", NullUniValue);
+    notify.pushKV("method", "mining.notify");
+    notify.pushKV("params", params);
+    Send(client, notify);
+}
+
+bool StratumServer::HandleLine(StratumClient& client, const std::string& strLine)
+{
+    UniValue request;
+    if (!request.read(strLine) || !request.isObject()) {
+        LogPrint(BCLog::STRATUM, "stratum: Malformed request from %s\n", client.strPeer);
+        return false;
+    }
+    const UniValue& id = find_value(request, "id");
+    const UniValue& method = find_value(request, "method");
+    const UniValue& params = find_value(request, "params");
+
+    UniValue result = NullUniValue;
+    UniValue error = NullUniValue;
+    bool fSendWork = false;
+    try {
+        if (!method.isStr()) {
+            throw StratumError(20, "Missing method");
+        } else if (method.get_str() == "mining.subscribe") {
+            result = Subscribe(client);
+        } else if (method.get_str() == "mining.authorize") {
+            // Blocks always pay -stratumaddress, so any worker name is accepted
+            if (!client.fSubscribed)
+                throw StratumError(25, "Not subscribed");
+            fSendWork = !client.fAuthorized;
+            client.fAuthorized = true;
+            result = true;
+        } else if (method.get_str() == "mining.extranonce.subscribe") {
+            // The extranonce of a connection never changes
+            result = true;
+        } else if (method.get_str() == "mining.submit") {
+            result = Submit(client, params);
+        } else {
+            throw StratumError(20, "Method not found");
+        }
+    } catch (const UniValue& e) {
+        error = e;
+        result = NullUniValue;
+    } catch (const std::exception& e) {
+        error = StratumError(20, e.what());
+        result = NullUniValue;
+    }
+
+    UniValue reply(UniValue::VOBJ);
+    reply.pushKV("id", id);
+    reply.pushKV("result", result);
+    reply.pushKV("error", error);
+    Send(client, reply);
+
+    if (fSendWork)
+        SendWork(client, true);
+    return true;
+}
+
+UniValue StratumServer::Subscribe(StratumClient& client)
+{
+    unsigned char extraNonce1[EXTRANONCE1_SIZE];
+    WriteBE32(extraNonce1, client.nExtraNonce1);
+    const std::string strExtraNonce1 = HexStr(extraNonce1, extraNonce1 + EXTRANONCE1_SIZE);
+    client.fSubscribed = true;
+
+    UniValue subscriptions(UniValue::VARR);
+    for (const char* name : {"mining.set_difficulty", "mining.notify"}) {
+        UniValue subscription(UniValue::VARR);
+        subscription.push_back(name);
+        subscription.push_back(strExtraNonce1);
+        subscriptions.push_back(subscription);
+    }
+    UniValue result(UniValue::VARR);
+    result.push_back(subscriptions);
+    result.push_back(strExtraNonce1);
+    result.push_back((int)EXTRANONCE2_SIZE);
+    return result;
+}
+
+UniValue StratumServer::Submit(StratumClient& client, const UniValue& params)
+{
+    if (!client.fAuthorized)
+        throw StratumError(24, "Unauthorized worker");
+    if (!params.isArray() || params.size() < 5 || !params[1].isStr() || !params[2].isStr())
+        throw StratumError(20, "Invalid parameters");
+
+    auto it = mapJobs.find(params[1].get_str());
+    if (it == mapJobs.end())
+        throw StratumError(21, "Job not found");
+    StratumJob& job = *it->second;
+
+    const std::vector<unsigned char> vExtraNonce2 = ParseHex(params[2].get_str());
+    uint32_t nTime, nNonce;
+    if (!IsHex(params[2].get_str()) || vExtraNonce2.size() != EXTRANONCE2_SIZE)
+        throw StratumError(20, "Invalid extranonce2");
+    if (!ParseHex32(params[3], nTime) || !ParseHex32(params[4], nNonce))
+        throw StratumError(20, "Invalid ntime or nonce");
+    if (nTime < job.nMinTime || nTime > GetAdjustedTime() + MAX_FUTURE_BLOCK_TIME)
+        throw StratumError(20, "ntime out of range");
+
+    std::vector<unsigned char> vCoinbase(job.vCoinbase1);
+    vCoinbase.resize(vCoinbase.size() + EXTRANONCE1_SIZE);
+    WriteBE32(vCoinbase.data() + vCoinbase.size() - EXTRANONCE1_SIZE, client.nExtraNonce1);
+    vCoinbase.insert(vCoinbase.end(), vExtraNonce2.begin(), vExtraNonce2.end());
+    vCoinbase.insert(vCoinbase.end(), job.vCoinbase2.begin(), job.vCoinbase2.end());
+    CMutableTransaction coinbaseTx;
+    CDataStream(vCoinbase, SER_NETWORK, PROTOCOL_VERSION) >> coinbaseTx;
+
+    CBlockHeader header = job.block.GetBlockHeader();
+    header.hashMerkleRoot = coinbaseTx.GetHash();
+    for (const uint256& hash : job.vMerkleBranch)
+        header.hashMerkleRoot = Hash(header.hashMerkleRoot.begin(), header.hashMerkleRoot.end(), hash.begin(), hash.end());
+    header.nTime = nTime;
+    header.nNonce = nNonce;
+
+    const uint256 hashShare = header.GetHash();
+    if (job.setShares.count(hashShare))
+        throw StratumError(22, "Duplicate share");
+
+    // GhostRider takes its schedule from hashPrevBlock; it is cached per
+    // thread, so every share of the same tip reuses it
+    const int algo = header.GetAlgo();
+    const uint256 hashPoW = header.GetPOWHash(algo);
+    const arith_uint256 blockTarget = arith_uint256().SetCompact(header.nBits);
+    const arith_uint256 shareTarget = std::max(ShareTarget(algo, dDifficulty), blockTarget);
+    if (UintToArith256(hashPoW) > shareTarget)
+        throw StratumError(23, "Low difficulty share");
+    // Only shares that cost their work are remembered, and only so many; a block is never turned down
+    const bool fBlock = CheckProofOfWork(hashPoW, header.nBits, Params().GetConsensus());
+    if (!fBlock && job.setShares.size() >= MAX_JOB_SHARES)
+        throw StratumError(21, "Too many shares for job");
+    job.setShares.insert(hashShare);
+    LogPrint(BCLog::STRATUM, "stratum: Share from %s for job %s accepted\n", client.strPeer, job.strId);
+
+    if (fBlock) {
+        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>(job.block);
+        pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
+        pblock->hashMerkleRoot = header.hashMerkleRoot;
+        pblock->nTime = header.nTime;
+        pblock->nNonce = header.nNonce;
+        LogPrintf("stratum: Block %s found by %s\n", pblock->GetHash().ToString(), client.strPeer);
+        if (!ProcessNewBlock(Params(), pblock, true, nullptr))
+            LogPrintf("stratum: Block %s was not accepted\n", pblock->GetHash().ToString());
+    }
+    return true;
+}
+
+struct event_base* stratumBase = nullptr;
+StratumServer* stratumServer = nullptr;
+std::thread stratumThread;
+
+} // namespace
+
+bool StartStratumServer()
+{
+    assert(!stratumBase);
+
+    CBitcoinAddress address(gArgs.GetArg("-stratumaddress", ""));
+    if (!address.IsValid()) {
+        LogPrintf("stratum: -stratumaddress must be set to the address mined blocks pay to\n");
+        return false;
+    }
+    const double dDifficulty = atof(gArgs.GetArg("-stratumdifficulty", strprintf("%g", DEFAULT_STRATUM_DIFFICULTY)).c_str());
+    if (!(dDifficulty > 0)) {
+        LogPrintf("stratum: -stratumdifficulty must be positive\n");
+        return false;
+    }
+
+#ifdef WIN32
+    evthread_use_windows_threads();
+#else
+    evthread_use_pthreads();
+#endif
+    stratumBase = event_base_new();
+    if (!stratumBase) {
+        LogPrintf("stratum: Unable to create event_base\n");
+        return false;
+    }
+    stratumServer = new StratumServer(stratumBase, GetScriptForDestination(address.Get()), dDifficulty);
+
+    for (const std::string& strBind : gArgs.GetArgs("-stratumbind")) {
+        int port = DEFAULT_STRATUM_PORT;
+        std::string host;
+        SplitHostPort(strBind, port, host);
+        CService addrBind;
+        if (!Lookup(host.c_str(), addrBind, port, false) || !stratumServer->Bind(addrBind)) {
+            LogPrintf("stratum: Unable to bind to %s\n", strBind);
+            return false;
+        }
+    }
+
+    RegisterValidationInterface(stratumServer);
+    stratumServer->RequestJob();
+    stratumThread = std::thread(&TraceThread<std::function<void()>>, "stratum", std::function<void()>([] {
+        event_base_dispatch(stratumBase);
+    }));
+    return true;
+}
+
+void InterruptStratumServer()
+{
+    if (stratumBase) {
+        LogPrintf("stratum: Thread interrupt\n");
+        event_base_loopbreak(stratumBase);
+    }
+}
+
+void StopStratumServer()
+{
+    if (stratumServer)
+        UnregisterValidationInterface(stratumServer);
+    if (stratumBase) {
+        event_base_loopbreak(stratumBase);
+        if (stratumThread.joinable())
+            stratumThread.join();
+    }
+    delete stratumServer;
+    stratumServer = nullptr;
+    if (stratumBase) {
+        event_base_free(stratumBase);
+        stratumBase = nullptr;
+    }
+}
@@ -0,0 +1,24 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/**
+ * Stratum v1 mining server, so that miners get new work pushed to them
+ * instead of polling getblocktemplate.
+ */
+#ifndef BITCOIN_STRATUM_H
+#define BITCOIN_STRATUM_H
+
+#include <stdint.h>
+
+static const uint16_t DEFAULT_STRATUM_PORT = 3333;
+static const double DEFAULT_STRATUM_DIFFICULTY = 1.0;
+/** Minimum number of seconds between jobs that only pick up new mempool transactions */
+static const int64_t STRATUM_JOB_REFRESH_INTERVAL = 10;
+
+/** Start the Stratum server on the -stratumbind addresses; false on error */
+bool StartStratumServer();
+void InterruptStratumServer();
+void StopStratumServer();
+
+#endif // BITCOIN_STRATUM_H
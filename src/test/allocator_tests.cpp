@@ -4,9 +4,12 @@
 
 #include <util.h>
 
+#include <support/allocators/pool.h>
 #include <support/allocators/secure.h>
 #include <test/test_but.h>
 
+#include <unordered_map>
+
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(allocator_tests, BasicTestingSetup)
@@ -231,4 +234,78 @@ BOOST_AUTO_TEST_CASE(lockedpool_tests_live)
     BOOST_CHECK(pool.stats().used == initial.used);
 }
 
+BOOST_AUTO_TEST_CASE(poolresource_tests)
+{
+    // Chunks of 64 bytes, blocks of up to 16 bytes in steps of 8
+    PoolResource<16, 8> resource(64);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes(), 64U);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 0U);
+
+    // Blocks are handed out back to back, rounded up to the alignment
+    char* a = static_cast<char*>(resource.Allocate(8, 8));
+    char* b = static_cast<char*>(resource.Allocate(5, 1));
+    char* c = static_cast<char*>(resource.Allocate(16, 8));
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    BOOST_CHECK(b == a + 8);
+    BOOST_CHECK(c == b + 8);
+
+    // A freed block is reused by the next allocation of the same size only
+    resource.Deallocate(b, 5, 1);
+    char* d = static_cast<char*>(resource.Allocate(16, 8));
+    BOOST_CHECK(d == c + 16);
+    BOOST_CHECK(resource.Allocate(8, 8) == b);
+
+    // A new chunk is only allocated once the first one is used up
+    char* e = static_cast<char*>(resource.Allocate(16, 8));
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    BOOST_CHECK(e == d + 16);
+    char* f = static_cast<char*>(resource.Allocate(16, 8));
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+    BOOST_CHECK(f != e + 16);
+
+    // Anything larger or more aligned than the pool serves bypasses it
+    void* g = resource.Allocate(17, 8);
+    void* h = resource.Allocate(8, 16);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+    resource.Deallocate(g, 17, 8);
+    resource.Deallocate(h, 8, 16);
+}
+
+BOOST_AUTO_TEST_CASE(poolallocator_unordered_map)
+{
+    typedef std::pair<const int, int> Value;
+    typedef PoolAllocator<Value, sizeof(Value) + sizeof(void*) * 4> Allocator;
+    typedef std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, Allocator> Map;
+
+    Allocator::ResourceType resource(1024);
+    {
+        Map map(0, std::hash<int>(), std::equal_to<int>(), &resource);
+        for (int i = 0; i < 1000; i++)
+            map[i] = i * 2;
+        BOOST_CHECK_EQUAL(map.size(), 1000U);
+        const size_t nChunks = resource.NumAllocatedChunks();
+        BOOST_CHECK(nChunks > 1);
+
+        // Erasing while iterating, as BatchWrite does, and refilling reuses the freed nodes
+        for (Map::iterator it = map.begin(); it != map.end();) {
+            if (it->first % 2) {
+                it = map.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        BOOST_CHECK_EQUAL(map.size(), 500U);
+        for (int i = 1; i < 1000; i += 2)
+            map[i] = i * 2;
+        BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), nChunks);
+        for (int i = 0; i < 1000; i++)
+            BOOST_CHECK_EQUAL(map.at(i), i * 2);
+
+        // A copy shares the pool
+        Map copy(map);
+        BOOST_CHECK(copy.get_allocator() == map.get_allocator());
+        BOOST_CHECK_EQUAL(copy.size(), 1000U);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
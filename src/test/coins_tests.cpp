@@ -2,8 +2,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <chainparams.h>
 #include <coins.h>
 #include <script/standard.h>
+#include <txdb.h>
 #include <uint256.h>
 #include <undo.h>
 #include <utilstrencodings.h>
@@ -586,7 +588,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource);
     InsertCoinsMapEntry(map, value, flags);
     view.BatchWrite(map, {});
 }
@@ -770,6 +773,41 @@ BOOST_AUTO_TEST_CASE(ccoins_add)
     CheckAddCoin(VALUE2, VALUE3, VALUE3, DIRTY|FRESH, DIRTY|FRESH, true );
 }
 
+void CheckCacheFetchedCoin(CAmount cache_value, CAmount fetch_value, CAmount expected_value, char cache_flags, char expected_flags)
+{
+    SingleEntryCacheTest test(ABSENT, cache_value, cache_flags);
+    BOOST_CHECK_EQUAL(test.cache.HaveEntryInCache(OUTPOINT), cache_value != ABSENT);
+
+    Coin coin;
+    SetCoinsValue(fetch_value, coin);
+    test.cache.CacheFetchedCoin(OUTPOINT, std::move(coin));
+    test.cache.SelfTest();
+
+    CAmount result_value;
+    char result_flags;
+    GetCoinsMapEntry(test.cache.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, expected_value);
+    BOOST_CHECK_EQUAL(result_flags, expected_flags);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_cache_fetched)
+{
+    /* Check CacheFetchedCoin behavior, handing the cache a coin read from its
+     * base view elsewhere (as the coin prefetch threads do), and checking the
+     * resulting entry in the cache. What the cache has always wins.
+     *
+     *                     Cache   Fetch   Result  Cache        Result
+     *                     Value   Value   Value   Flags        Flags
+     */
+    CheckCacheFetchedCoin(ABSENT, PRUNED, ABSENT, NO_ENTRY   , NO_ENTRY   );
+    CheckCacheFetchedCoin(ABSENT, VALUE1, VALUE1, NO_ENTRY   , 0          );
+    for (char flags : FLAGS) {
+        CheckCacheFetchedCoin(PRUNED, VALUE1, PRUNED, flags, flags);
+        CheckCacheFetchedCoin(VALUE2, VALUE1, VALUE2, flags, flags);
+        CheckCacheFetchedCoin(VALUE2, PRUNED, VALUE2, flags, flags);
+    }
+}
+
 void CheckWriteCoins(CAmount parent_value, CAmount child_value, CAmount expected_value, char parent_flags, char child_flags, char expected_flags)
 {
     SingleEntryCacheTest test(ABSENT, parent_value, parent_flags);
@@ -855,4 +893,74 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_FIXTURE_TEST_CASE(ccoins_background_writer, TestingSetup)
+{
+    CCoinsViewDB db(1 << 20, true, true);
+    CCoinsViewBackgroundWriter writer(&db, true);
+    CCoinsViewCache cache(&writer);
+
+    const COutPoint a(InsecureRand256(), 0), b(InsecureRand256(), 1), c(InsecureRand256(), 2);
+    Coin coin;
+    coin.out.nValue = VALUE1;
+    coin.nHeight = 1;
+
+    // Whether the thread has written a flush yet or not, lookups see it
+    cache.AddCoin(a, Coin(coin), false);
+    cache.AddCoin(b, Coin(coin), false);
+    const uint256 block1 = InsecureRand256();
+    cache.SetBestBlock(block1);
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    // Once BatchWrite returned, a crash is replayed: the database is marked or already written
+    BOOST_CHECK(db.GetBestBlock() == block1 || db.GetHeadBlocks() == std::vector<uint256>({block1, uint256()}));
+    BOOST_CHECK(writer.HaveCoin(a));
+    BOOST_CHECK(writer.HaveCoin(b));
+    BOOST_CHECK(writer.GetBestBlock() == block1);
+
+    // The next flush waits for the first one and spends a coin of it
+    BOOST_CHECK(cache.SpendCoin(a));
+    cache.AddCoin(c, Coin(coin), false);
+    const uint256 block2 = InsecureRand256();
+    cache.SetBestBlock(block2);
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(db.GetBestBlock() == block2 || db.GetHeadBlocks() == std::vector<uint256>({block2, block1}));
+    Coin result;
+    BOOST_CHECK(!writer.GetCoin(a, result));
+    BOOST_CHECK(writer.GetCoin(c, result) && result.out.nValue == VALUE1);
+    BOOST_CHECK(writer.GetBestBlock() == block2);
+
+    // Once the write is done, the database has it all and no transition marker is left
+    BOOST_CHECK(writer.WaitForWrite());
+    BOOST_CHECK_EQUAL(writer.DynamicMemoryUsage(), 0U);
+    BOOST_CHECK(!db.HaveCoin(a));
+    BOOST_CHECK(db.HaveCoin(b));
+    BOOST_CHECK(db.HaveCoin(c));
+    BOOST_CHECK(db.GetBestBlock() == block2);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(ccoins_background_writer_replay, TestChain100Setup)
+{
+    FlushStateToDisk();
+    const uint256 hashOld = pcoinsdbview->GetBestBlock();
+    BOOST_CHECK(hashOld == chainActive.Tip()->GetBlockHash());
+
+    const CBlock block = CreateAndProcessBlock({}, coinbaseKey);
+    const COutPoint coinbase(block.vtx[0]->GetHash(), 0);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == block.GetHash());
+    BOOST_CHECK(!pcoinsdbview->HaveCoin(coinbase));
+
+    // A crash right after BatchWrite handed a flush to the writer thread:
+    // the marker is on disk, none of the coins are
+    BOOST_CHECK(pcoinsdbview->WriteHeadBlocks(block.GetHash()));
+    BOOST_CHECK(pcoinsdbview->GetBestBlock().IsNull());
+    BOOST_CHECK(pcoinsdbview->GetHeadBlocks() == std::vector<uint256>({block.GetHash(), hashOld}));
+
+    // At startup the block is replayed instead of the coins staying behind the rest of the state
+    BOOST_CHECK(ReplayBlocks(Params(), pcoinsdbview));
+    BOOST_CHECK(pcoinsdbview->GetBestBlock() == block.GetHash());
+    BOOST_CHECK(pcoinsdbview->GetHeadBlocks().empty());
+    BOOST_CHECK(pcoinsdbview->HaveCoin(coinbase));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
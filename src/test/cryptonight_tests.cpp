@@ -0,0 +1,99 @@
+// Copyright (c) 2020 The But developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cryptonote/cryptonight_aesni.h>
+#include <cryptonote/cryptonight_dark.h>
+#include <cryptonote/cryptonight_dark_lite.h>
+#include <cryptonote/cryptonight_fast.h>
+#include <cryptonote/cryptonight_lite.h>
+#include <cryptonote/cryptonight_soft_shell.h>
+#include <cryptonote/cryptonight_turtle.h>
+#include <cryptonote/cryptonight_turtle_lite.h>
+#include <utilstrencodings.h>
+#include <test/test_but.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(cryptonight_tests, BasicTestingSetup)
+
+typedef void (*CryptonightFn)(const char* input, char* output, uint32_t len, int variant);
+
+static const CryptonightFn GR_VARIANTS[6] = {
+    cryptonightdark_hash,
+    cryptonightdarklite_hash,
+    cryptonightfast_hash,
+    cryptonightlite_hash,
+    cryptonightturtle_hash,
+    cryptonightturtlelite_hash
+};
+
+static std::string HashVariant(CryptonightFn fn, const std::vector<unsigned char>& input, int variant)
+{
+    unsigned char output[32];
+    fn((const char*)input.data(), (char*)output, input.size(), variant);
+    return HexStr(output, output + sizeof(output));
+}
+
+BOOST_AUTO_TEST_CASE(cryptonight_ghostrider_variants)
+{
+    // Variant 1 as used by GhostRider, in the order of cnHash()
+    const char* expected[6] = {
+        "2d6127626f90d68d30866e0a2ccb84bce36948b289c5b6386cabcea59c0fc18a",
+        "240cd0fb3870838e9695b44ce2990eb498099b1bae1737f5a1db70567313bbe1",
+        "7b9695dc17f0ced9b99446f688f93607fd8461ac82d5d5bd81df589b8803483f",
+        "fce4a8682ec56f30aa1c63b55f0412be152d8a68b7fcc2d30b5dd1a52b571e17",
+        "f7a24d5bf5ebce0cb1cb7653b416d981b31931e1e1b1ee07e8135e5e7f1ee936",
+        "d4f0f89fd06433a608c9c146e889d83b243da42be83242c3c7a7d196bebb84c3"
+    };
+    std::vector<unsigned char> input(64);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = i * 7 + 3;
+    }
+
+    const int aesni = cryptonight_aesni_enabled;
+    cryptonight_aesni_enabled = 0;
+    for (int i = 0; i < 6; i++) {
+        BOOST_CHECK_EQUAL(HashVariant(GR_VARIANTS[i], input, 1), expected[i]);
+    }
+    cryptonight_aesni_enabled = aesni;
+}
+
+BOOST_AUTO_TEST_CASE(cryptonight_aesni_crosscheck)
+{
+    (void) cryptonight_detect_aesni();
+    if (!cryptonight_aesni_enabled) {
+        BOOST_TEST_MESSAGE("AES-NI not available, skipping cross-check");
+        return;
+    }
+
+    // The AES-NI path must agree with the portable one for every variant
+    std::vector<unsigned char> input(76);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = i * 5 + 1;
+    }
+    for (int variant = 0; variant <= 2; variant++) {
+        for (int i = 0; i < 6; i++) {
+            cryptonight_aesni_enabled = 0;
+            std::string portable = HashVariant(GR_VARIANTS[i], input, variant);
+            cryptonight_aesni_enabled = 1;
+            BOOST_CHECK_EQUAL(HashVariant(GR_VARIANTS[i], input, variant), portable);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(cryptonight_soft_shell_parameters)
+{
+    // Soft Shell with run time parameters matching a fixed variant must hash the same
+    std::vector<unsigned char> input(80);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = i * 3 + 11;
+    }
+    for (int variant = 0; variant <= 2; variant++) {
+        unsigned char output[32];
+        cryptonight_soft_shell_hash((const char*)input.data(), (char*)output, input.size(), variant, 262144, 131072);
+        BOOST_CHECK_EQUAL(HexStr(output, output + sizeof(output)), HashVariant(cryptonightturtlelite_hash, input, variant));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,9 +3,13 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <dbwrapper.h>
+#include <index/addressindex.h>
 #include <uint256.h>
 #include <random.h>
+#include <spentindex.h>
 #include <test/test_but.h>
+#include <txdb.h>
+#include <validation.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -319,4 +323,44 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
 
 
 
+BOOST_FIXTURE_TEST_CASE(address_balance_index_enable, TestChain100Setup)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    uint160 hashBytes;
+    const int type = GetIndexAddress(scriptPubKey, hashBytes);
+    BOOST_REQUIRE_EQUAL(type, 1);
+
+    auto build = [](bool fBalances) {
+        fAddressBalanceIndex = fBalances;
+        AddressIndex index;
+        BOOST_REQUIRE(index.Start());
+        BOOST_CHECK(index.BlockUntilSyncedToHeight(-1, 10000));
+        index.Stop();
+    };
+    fAddressIndex = true;
+    build(false);
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > entries;
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hashBytes, type, entries));
+    BOOST_CHECK(!entries.empty());
+    CAmount nBalance = 0, nReceived = 0;
+    for (const auto& entry : entries) {
+        nBalance += entry.second;
+        nReceived += std::max<CAmount>(entry.second, 0);
+    }
+    CAddressBalanceValue value;
+    BOOST_CHECK(pblocktree->ReadAddressBalance(hashBytes, type, value));
+    BOOST_CHECK(value.IsNull());
+
+    // Switching the balances on for the address index that is already there counts every block once
+    build(true);
+    BOOST_CHECK(pblocktree->ReadAddressBalance(hashBytes, type, value));
+    BOOST_CHECK_EQUAL(value.balance, nBalance);
+    BOOST_CHECK_EQUAL(value.received, nReceived);
+    BOOST_CHECK(nBalance > 0);
+
+    fAddressIndex = DEFAULT_ADDRESSINDEX;
+    fAddressBalanceIndex = DEFAULT_ADDRESSBALANCEINDEX;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,10 +2,13 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <crypto/algos/Lyra2Z/Lyra2.h>
+#include <crypto/common.h>
 #include <hash.h>
 #include <utilstrencodings.h>
 #include <test/test_but.h>
 
+#include <algorithm>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -149,4 +152,137 @@ BOOST_AUTO_TEST_CASE(siphash)
     BOOST_CHECK_EQUAL(SipHashUint256(1, 2, ss.GetHash()), 0x79751e980c2a0a35ULL);
 }
 
+BOOST_AUTO_TEST_CASE(ghostrider_schedule)
+{
+    // All-zero nibbles pick index 0 first and fill up the rest in order
+    BOOST_CHECK_EQUAL(GetGhostRiderSchedule(uint256()).ToString(),
+        "BlakeBmwGroestlJhKeccakCNDarkSkeinLuffaCubehashShaviteSimdCNDarkliteEchoJamsiFugueShabalWhirlpoolCNFast");
+
+    uint256 prev;
+    for (int i = 0; i < 32; i++) {
+        *(prev.begin() + i) = i * 31;
+    }
+    GhostRiderSchedule schedule;
+    ComputeGhostRiderSchedule(prev, schedule);
+
+    // Every core algorithm runs exactly once and the three CryptoNight variants differ
+    int coreSeen = 0;
+    for (int i = 0; i < GhostRiderSchedule::ROUNDS; i++) {
+        if (GhostRiderSchedule::IsCryptonightRound(i)) {
+            BOOST_CHECK(schedule.algo[i] < GhostRiderSchedule::CN_VARIANTS);
+        } else {
+            BOOST_CHECK(schedule.algo[i] < GhostRiderSchedule::CORE_ALGOS);
+            coreSeen |= 1 << schedule.algo[i];
+        }
+    }
+    BOOST_CHECK_EQUAL(coreSeen, 0x7fff);
+    BOOST_CHECK(schedule.algo[5] != schedule.algo[11] && schedule.algo[11] != schedule.algo[17] && schedule.algo[5] != schedule.algo[17]);
+    BOOST_CHECK(memcmp(GetGhostRiderSchedule(prev).algo, schedule.algo, sizeof(schedule.algo)) == 0);
+
+    std::vector<unsigned char> header(80);
+    for (size_t i = 0; i < header.size(); i++) {
+        header[i] = i * 13;
+    }
+    const uint256 hash = HashGR(header.begin(), header.end(), schedule);
+    BOOST_CHECK_EQUAL(hash.ToString(), "4c692df0d16967f0e5f70dd5ec915233ef114cbd9e6d219af3681ed677206d04");
+    BOOST_CHECK(HashGR(header.begin(), header.end(), prev) == hash);
+}
+
+BOOST_AUTO_TEST_CASE(ghostrider_midstate)
+{
+    std::vector<unsigned char> header(80);
+    for (size_t i = 0; i < header.size(); i++) {
+        header[i] = i * 7 + 5;
+    }
+
+    // Every core algorithm finished from a 76 byte midstate matches a full hash
+    for (int algo = 0; algo < 16; algo++) {
+        uint512 full, resumed;
+        coreHash(header.data(), &full, header.size(), algo);
+        CoreHashMidstate midstate;
+        midstate.Init(algo, header.data(), 76);
+        midstate.Finalize(header.data() + 76, 4, &resumed);
+        BOOST_CHECK(full == resumed);
+    }
+
+    uint256 prev;
+    for (int i = 0; i < 32; i++) {
+        *(prev.begin() + i) = i * 17 + 3;
+    }
+    GhostRiderMidstate grMidstate;
+    grMidstate.Init(header.data(), prev);
+    // The nonce is the header field value, whatever the host byte order
+    const uint32_t nonces[3] = {0, 1, 0x12345678};
+    uint256 batched[3];
+    HashGRBatch(grMidstate, nonces, batched, 3);
+    for (int i = 0; i < 3; i++) {
+        WriteLE32(header.data() + 76, nonces[i]);
+        const uint256 expected = HashGR(header.begin(), header.end(), prev);
+        BOOST_CHECK(HashGR(grMidstate, nonces[i]) == expected);
+        BOOST_CHECK(batched[i] == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(corehash_batch)
+{
+    uint512 inputs[21], outputs[21], expected;
+    for (int i = 0; i < 21; i++) {
+        for (int j = 0; j < 64; j++) {
+            *(inputs[i].begin() + j) = i * 11 + j * 3;
+        }
+    }
+
+    // Every batch size, so that 8-way, 4-way and scalar remainders all get used
+    for (int algo = 0; algo < 16; algo++) {
+        for (size_t n = 0; n <= 21; n++) {
+            coreHashN(inputs, outputs, n, algo);
+            for (size_t i = 0; i < n; i++) {
+                coreHash(&inputs[i], &expected, 64, algo);
+                BOOST_CHECK(outputs[i] == expected);
+            }
+        }
+        uint512 inplace[21];
+        std::copy(inputs, inputs + 21, inplace);
+        coreHashN(inplace, inplace, 21, algo);
+        BOOST_CHECK(std::equal(inplace, inplace + 21, outputs));
+    }
+
+    // GhostRider of headers on different parents matches one at a time
+    std::vector<unsigned char> headers(80 * 10);
+    for (size_t i = 0; i < headers.size(); i++) {
+        headers[i] = i * 5 + 1;
+    }
+    const void* pheaders[10];
+    GhostRiderSchedule schedules[10];
+    uint256 hashes[10];
+    for (int i = 0; i < 10; i++) {
+        uint256 prev;
+        *prev.begin() = i;
+        *(prev.end() - 1) = i * 37;
+        pheaders[i] = &headers[80 * i];
+        schedules[i] = GetGhostRiderSchedule(prev);
+    }
+    HashGRBatch(pheaders, 80, schedules, hashes, 10);
+    for (int i = 0; i < 10; i++) {
+        BOOST_CHECK(hashes[i] == HashGR(headers.begin() + 80 * i, headers.begin() + 80 * (i + 1), schedules[i]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(lyra2_workspace)
+{
+    unsigned char input[80];
+    for (int i = 0; i < 80; i++) {
+        input[i] = i;
+    }
+    unsigned char hash[32];
+
+    // Block header parameters, then a smaller matrix and the large one again on the same thread's workspace
+    BOOST_CHECK_EQUAL(LYRA2(hash, 32, input, 80, input, 80, 2, 330, 256), 0);
+    BOOST_CHECK_EQUAL(HexStr(hash, hash + 32), "bbc07308856eef2305237fd2aa662c6573d2e173fddee568788bc30048d54ab0");
+    BOOST_CHECK_EQUAL(LYRA2(hash, 32, input, 32, input, 32, 8, 8, 8), 0);
+    BOOST_CHECK_EQUAL(HexStr(hash, hash + 32), "7bf350a4ca416352e2a4ff6d77d2b07aec78e1f4a4044f3752bff2b77f00d456");
+    BOOST_CHECK_EQUAL(LYRA2(hash, 32, input, 80, input, 80, 2, 330, 256), 0);
+    BOOST_CHECK_EQUAL(HexStr(hash, hash + 32), "bbc07308856eef2305237fd2aa662c6573d2e173fddee568788bc30048d54ab0");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
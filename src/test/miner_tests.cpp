@@ -13,6 +13,7 @@
 #include <miner.h>
 #include <policy/policy.h>
 #include <pubkey.h>
+#include <script/sign.h>
 #include <script/standard.h>
 #include <txmempool.h>
 #include <uint256.h>
@@ -531,4 +532,58 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     fCheckpointsEnabled = true;
 }
 
+BOOST_FIXTURE_TEST_CASE(template_manager, TestChain100Setup)
+{
+    CBlockTemplateManager manager(Params());
+    RegisterValidationInterface(&manager);
+
+    // One set of transactions, with the header of each algorithm
+    unsigned int nTransactionsUpdated;
+    std::shared_ptr<CBlockTemplate> shaTemplate = manager.GetBlockTemplate(ALGO_SHA256D, nTransactionsUpdated);
+    std::shared_ptr<CBlockTemplate> grTemplate = manager.GetBlockTemplate(ALGO_GHOSTRIDER, nTransactionsUpdated);
+    BOOST_CHECK_EQUAL(shaTemplate->block.GetAlgo(), ALGO_SHA256D);
+    BOOST_CHECK_EQUAL(grTemplate->block.GetAlgo(), ALGO_GHOSTRIDER);
+    BOOST_CHECK(shaTemplate->block.vtx[0]->GetHash() == grTemplate->block.vtx[0]->GetHash());
+    BOOST_CHECK(manager.GetBlockTemplate(ALGO_SHA256D, nTransactionsUpdated) == shaTemplate);
+
+    // A new mempool transaction is appended and its fee goes to the coinbase
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const CAmount nFee = CENT;
+    CMutableTransaction spend;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(coinbaseTxns[0].GetHash(), 0);
+    spend.vout.resize(1);
+    spend.vout[0].nValue = coinbaseTxns[0].vout[0].nValue - nFee;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(AcceptToMemoryPool(mempool, state, MakeTransactionRef(spend), false, nullptr, true, 0));
+    }
+
+    std::shared_ptr<CBlockTemplate> appended = manager.GetBlockTemplate(ALGO_SHA256D, nTransactionsUpdated);
+    BOOST_CHECK_EQUAL(appended->block.vtx.size(), shaTemplate->block.vtx.size() + 1);
+    BOOST_CHECK(appended->block.vtx.back()->GetHash() == spend.GetHash());
+    BOOST_CHECK_EQUAL(appended->block.vtx[0]->GetValueOut(), shaTemplate->block.vtx[0]->GetValueOut() + nFee);
+    BOOST_CHECK_EQUAL(nTransactionsUpdated, mempool.GetTransactionsUpdated());
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(TestBlockValidity(state, Params(), appended->block, chainActive.Tip(), false, false));
+    }
+
+    // A new tip starts over
+    CreateAndProcessBlock({spend}, scriptPubKey);
+    std::shared_ptr<CBlockTemplate> next = manager.GetBlockTemplate(ALGO_SHA256D, nTransactionsUpdated);
+    BOOST_CHECK(next->block.hashPrevBlock == chainActive.Tip()->GetBlockHash());
+    BOOST_CHECK_EQUAL(next->block.vtx.size(), 1);
+
+    UnregisterValidationInterface(&manager);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,11 +4,20 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <consensus/validation.h>
+#include <crypto/pow_scratch.h>
 #include <pow.h>
+#include <powalgo.h>
+#include <powcache.h>
 #include <random.h>
+#include <streams.h>
 #include <util.h>
+#include <validation.h>
 #include <test/test_but.h>
 
+#include <functional>
+#include <thread>
+
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(pow_tests, BasicTestingSetup)
@@ -203,4 +212,387 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(pow_hash_memo)
+{
+    CBlockHeader header;
+    header.nVersion = BLOCK_VERSION_DEFAULT | BLOCK_VERSION_BUTKSCRYPT;
+    header.nTime = 1600000000;
+    header.nBits = 0x1e0ffff0;
+
+    for (int algo : {ALGO_BUTKSCRYPT, ALGO_SCRYPT, ALGO_GHOSTRIDER}) {
+        const uint256 hash = header.GetPOWHash(algo);
+        BOOST_CHECK(header.GetPOWHash(algo) == hash);
+
+        // A copy hashes the same, and any change to the header misses the memo
+        CBlockHeader copy = header;
+        BOOST_CHECK(copy.GetPOWHash(algo) == hash);
+        copy.nNonce++;
+        const uint256 changed = copy.GetPOWHash(algo);
+        BOOST_CHECK(changed != hash);
+        BOOST_CHECK(CBlockHeader(copy).GetPOWHash(algo) == changed);
+        copy.nNonce--;
+        BOOST_CHECK(copy.GetPOWHash(algo) == hash);
+    }
+    // Switching algorithm misses too
+    BOOST_CHECK(header.GetPOWHash(ALGO_BUTKSCRYPT) != header.GetPOWHash(ALGO_GHOSTRIDER));
+}
+
+BOOST_AUTO_TEST_CASE(scan_nonces)
+{
+    CBlockHeader header;
+    header.nVersion = BLOCK_VERSION_DEFAULT;
+    header.hashPrevBlock = GetRandHash();
+    header.hashMerkleRoot = GetRandHash();
+    header.nTime = 1600000000;
+    header.nBits = 0x1e0ffff0;
+    header.nNonce = 0xfffffffb;
+
+    // Ten nonces, wrapping around, so GhostRider needs more than one batch
+    const uint32_t nCount = 10;
+    for (int algo : {ALGO_BUTKSCRYPT, ALGO_SHA256D, ALGO_LYRA2, ALGO_GHOSTRIDER, ALGO_YESPOWER, ALGO_SCRYPT}) {
+        std::vector<uint256> hashes;
+        CBlockHeader copy = header;
+        for (uint32_t i = 0; i < nCount; i++, copy.nNonce++)
+            hashes.push_back(copy.GetPOWHash(algo));
+        const size_t best = std::min_element(hashes.begin(), hashes.end(), [](const uint256& a, const uint256& b) {
+            return UintToArith256(a) < UintToArith256(b);
+        }) - hashes.begin();
+
+        uint32_t nNonce;
+        uint256 hash;
+        BOOST_CHECK(ScanNonces(header, header.nNonce, nCount, UintToArith256(hashes[best]), algo, nNonce, hash));
+        BOOST_CHECK_EQUAL(nNonce, header.nNonce + (uint32_t)best);
+        BOOST_CHECK(hash == hashes[best]);
+
+        BOOST_CHECK(ScanNonces(header, header.nNonce, nCount, ~arith_uint256(), algo, nNonce, hash));
+        BOOST_CHECK_EQUAL(nNonce, header.nNonce);
+        BOOST_CHECK(hash == hashes[0]);
+
+        BOOST_CHECK(!ScanNonces(header, header.nNonce, nCount, UintToArith256(hashes[best]) - 1, algo, nNonce, hash));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pow_algorithm_registry)
+{
+    std::string strError;
+    BOOST_CHECK_MESSAGE(PowAlgorithmsSelfTest(strError), strError);
+
+    const std::vector<PowAlgorithm>& vAlgorithms = GetPowAlgorithms();
+    BOOST_CHECK_EQUAL(vAlgorithms.size(), (size_t)NUM_ALGOSV4);
+    for (size_t i = 0; i < vAlgorithms.size(); i++) {
+        const PowAlgorithm& pa = vAlgorithms[i];
+        BOOST_CHECK_EQUAL(pa.algo, (int)i);
+        BOOST_CHECK(GetPowAlgorithm(pa.algo) == &pa);
+        BOOST_CHECK(GetPowAlgorithmByName(pa.name) == &pa);
+        for (const std::string& strAlias : pa.vAliases)
+            BOOST_CHECK(GetPowAlgorithmByName(strAlias) == &pa);
+        BOOST_CHECK(GetPowAlgorithmByVersion(BLOCK_VERSION_DEFAULT | pa.nVersionBits) == &pa);
+        BOOST_CHECK_EQUAL(GetAlgoByVersion(BLOCK_VERSION_DEFAULT | pa.nVersionBits), pa.algo);
+        BOOST_CHECK_EQUAL(GetAlgoName(pa.algo), pa.name);
+        BOOST_CHECK(!pa.strBackend.empty());
+    }
+    BOOST_CHECK(GetPowAlgorithm(-1) == nullptr);
+    BOOST_CHECK(GetPowAlgorithm(vAlgorithms.size()) == nullptr);
+    BOOST_CHECK(GetPowAlgorithmByName("SHA256") == GetPowAlgorithm(ALGO_SHA256D));
+    BOOST_CHECK(GetPowAlgorithmByName("x11") == nullptr);
+    int nKnownVersions = 0;
+    for (int32_t nAlgoBits = 0; nAlgoBits <= BLOCK_VERSION_ALGO; nAlgoBits += (1 << 11))
+        nKnownVersions += GetPowAlgorithmByVersion(BLOCK_VERSION_DEFAULT | nAlgoBits) != nullptr;
+    BOOST_CHECK_EQUAL(nKnownVersions, NUM_ALGOSV4);
+
+    // The weights feed the chain work and must never change
+    BOOST_CHECK_EQUAL(GetAlgoWeight(ALGO_BUTKSCRYPT), 140000U);
+    BOOST_CHECK_EQUAL(GetAlgoWeight(ALGO_SHA256D), 500U);
+    BOOST_CHECK_EQUAL(GetAlgoWeight(ALGO_LYRA2), 600000U);
+    BOOST_CHECK_EQUAL(GetAlgoWeight(ALGO_GHOSTRIDER), 600000U);
+    BOOST_CHECK_EQUAL(GetAlgoWeight(ALGO_YESPOWER), 14U);
+    BOOST_CHECK_EQUAL(GetAlgoWeight(ALGO_SCRYPT), 120000U);
+}
+
+BOOST_AUTO_TEST_CASE(pow_scratch_allocator)
+{
+    for (int fHugePages = 0; fHugePages <= 1; fHugePages++) {
+        pow_scratch_set_hugepages(fHugePages);
+        size_t nBefore[POW_SCRATCH_NUM_MODES];
+        pow_scratch_usage(nBefore);
+
+        pow_scratch_t scratch;
+        BOOST_CHECK_EQUAL(pow_scratch_alloc(&scratch, 131072 + 63), 0);
+        BOOST_CHECK(scratch.base_size >= scratch.size);
+        BOOST_CHECK_EQUAL((uintptr_t)scratch.aligned % 64, 0U);
+        if (!fHugePages)
+            BOOST_CHECK(scratch.mode != POW_SCRATCH_HUGETLB);
+        memset(scratch.aligned, 0xa5, scratch.size);
+
+        // Every algorithm hashes the same, whatever backs its scratchpad
+        std::string strError;
+        BOOST_CHECK_MESSAGE(PowAlgorithmsSelfTest(strError), strError);
+
+        // The self-test leaves this thread's own scratchpads allocated, so compare around the free
+        size_t nDuring[POW_SCRATCH_NUM_MODES];
+        pow_scratch_usage(nDuring);
+        BOOST_CHECK(nDuring[scratch.mode] >= nBefore[scratch.mode] + scratch.base_size);
+        const pow_scratch_mode_t mode = scratch.mode;
+        const size_t nBaseSize = scratch.base_size;
+        pow_scratch_free(&scratch);
+        BOOST_CHECK(scratch.base == nullptr);
+        size_t nAfter[POW_SCRATCH_NUM_MODES];
+        pow_scratch_usage(nAfter);
+        BOOST_CHECK_EQUAL(nAfter[mode], nDuring[mode] - nBaseSize);
+
+        // Scratchpads smaller than a huge page never take one
+        BOOST_CHECK_EQUAL(pow_scratch_alloc(&scratch, 131072 + 63), 0);
+        BOOST_CHECK_EQUAL(scratch.mode, POW_SCRATCH_NORMAL);
+        pow_scratch_free(&scratch);
+    }
+    pow_scratch_set_hugepages(POW_SCRATCH_DEFAULT_HUGEPAGES);
+
+    // A thread that hashed with every algorithm gives its scratchpads back when it exits
+    size_t nBefore[POW_SCRATCH_NUM_MODES];
+    pow_scratch_usage(nBefore);
+    std::string strError;
+    bool fSelfTest = false;
+    std::thread thread([&] { fSelfTest = PowAlgorithmsSelfTest(strError); });
+    thread.join();
+    BOOST_CHECK_MESSAGE(fSelfTest, strError);
+    size_t nAfter[POW_SCRATCH_NUM_MODES];
+    pow_scratch_usage(nAfter);
+    for (int mode = 0; mode < POW_SCRATCH_NUM_MODES; mode++)
+        BOOST_CHECK_EQUAL(nAfter[mode], nBefore[mode]);
+}
+
+BOOST_AUTO_TEST_CASE(pow_cache)
+{
+    ClearPowCache();
+    gArgs.ForceSetArg("-powcachesize", "2");
+    InitPowCache();
+
+    CBlockHeader header;
+    header.nVersion = BLOCK_VERSION_DEFAULT | BLOCK_VERSION_YESPOWER;
+    header.hashPrevBlock = GetRandHash();
+    header.nTime = 1600000000;
+    header.nBits = 0x1e0ffff0;
+
+    uint256 hash;
+    BOOST_CHECK(!LookupPowCache(header, hash));
+    const uint256 hashPoW = header.GetPOWHash(header.GetAlgo());
+    InsertPowCache(header, hashPoW);
+    BOOST_CHECK(LookupPowCache(CBlockHeader(header), hash));
+    BOOST_CHECK(hash == hashPoW);
+    BOOST_CHECK(GetPowHashCached(CBlockHeader(header)) == hashPoW);
+
+    // A sibling with the same hashPrevBlock is a different entry
+    CBlockHeader sibling = header;
+    sibling.nNonce++;
+    BOOST_CHECK(!LookupPowCache(sibling, hash));
+    BOOST_CHECK(GetPowHashCached(sibling) == sibling.GetPOWHash(sibling.GetAlgo()));
+    InsertPowCache(sibling, sibling.GetPOWHash(sibling.GetAlgo()));
+
+    // The least recently used header is evicted first
+    BOOST_CHECK(LookupPowCache(header, hash));
+    CBlockHeader third = sibling;
+    third.nNonce++;
+    InsertPowCache(third, third.GetPOWHash(third.GetAlgo()));
+    BOOST_CHECK(LookupPowCache(header, hash));
+    BOOST_CHECK(!LookupPowCache(sibling, hash));
+    BOOST_CHECK(LookupPowCache(third, hash));
+
+    // SHA256d headers are cheaper to hash than to look up
+    CBlockHeader sha = header;
+    sha.nVersion = BLOCK_VERSION_DEFAULT | BLOCK_VERSION_SHA256D;
+    InsertPowCache(sha, sha.GetPOWHash(sha.GetAlgo()));
+    BOOST_CHECK(!LookupPowCache(sha, hash));
+
+    PowCacheStats stats;
+    GetPowCacheStats(stats);
+    BOOST_CHECK_EQUAL(stats.nEntries, 2U);
+    BOOST_CHECK_EQUAL(stats.nMaxEntries, 2U);
+    BOOST_CHECK_EQUAL(stats.nHits, 5U);
+    BOOST_CHECK_EQUAL(stats.nMisses, 4U);
+
+    gArgs.ForceSetArg("-powcachesize", std::to_string(DEFAULT_POW_CACHE_SIZE));
+    InitPowCache();
+    ClearPowCache();
+}
+
+BOOST_AUTO_TEST_CASE(block_index_pow_hash)
+{
+    CBlockHeader header;
+    header.nVersion = BLOCK_VERSION_DEFAULT | BLOCK_VERSION_GHOSTRIDER;
+    header.nTime = 1600000000;
+    header.nBits = 0x1e0ffff0;
+    const uint256 hashBlock = header.GetHash();
+    const uint256 hashPoW = header.GetPOWHash(ALGO_GHOSTRIDER);
+
+    CBlockIndex index(header);
+    index.phashBlock = &hashBlock;
+    BOOST_CHECK(index.hashPoW.IsNull());
+    BOOST_CHECK(index.GetBlockPoWHash() == hashPoW);
+
+    // The stored hash is what gets persisted and what GetBlockPoWHash() reports
+    index.hashPoW = hashPoW;
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << CDiskBlockIndex(&index);
+    CDiskBlockIndex diskindex;
+    ss >> diskindex;
+    BOOST_CHECK(diskindex.hashBlockShared == hashBlock);
+    BOOST_CHECK(diskindex.hashPOWShared == hashPoW);
+
+    index.hashPoW = uint256S("0x1234");
+    BOOST_CHECK(index.GetBlockPoWHash() == uint256S("0x1234"));
+}
+
+BOOST_AUTO_TEST_CASE(same_algo_pointers)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    static const int versions[] = {BLOCK_VERSION_BUTKSCRYPT, BLOCK_VERSION_SHA256D, BLOCK_VERSION_GHOSTRIDER, BLOCK_VERSION_YESPOWER, BLOCK_VERSION_LYRA2, BLOCK_VERSION_SCRYPT};
+    std::vector<CBlockIndex> blocks(2000);
+    for (unsigned int i = 0; i < blocks.size(); i++) {
+        blocks[i].pprev = i ? &blocks[i - 1] : nullptr;
+        blocks[i].nHeight = i;
+        blocks[i].nTime = 1269211443 + i * params.nPowTargetSpacing;
+        // One algorithm is mined only every few hundred blocks
+        const int nVersionAlgo = i % 300 == 7 ? BLOCK_VERSION_SCRYPT : versions[InsecureRandRange(5)];
+        blocks[i].nVersion = BLOCK_VERSION_DEFAULT | nVersionAlgo;
+        blocks[i].BuildSkip();
+    }
+
+    for (int j = 0; j < 1000; j++) {
+        const CBlockIndex* pindex = &blocks[InsecureRandRange(blocks.size())];
+        const int algo = GetAlgoByVersion(versions[InsecureRandRange(6)]);
+        const CBlockIndex* pexpect = pindex;
+        while (pexpect && pexpect->GetAlgo() != algo)
+            pexpect = pexpect->pprev;
+        BOOST_CHECK(GetLastBlockIndexForAlgo(pindex, params, algo) == pexpect);
+        BOOST_CHECK(pindex->GetLastAlgo(algo) == pexpect);
+        BOOST_CHECK(pindex->pprevAlgo[algo] == (pexpect == pindex ? pindex->pprevSameAlgo : pexpect));
+
+        const CBlockIndex* pprevExpect = pindex->pprev;
+        while (pprevExpect && pprevExpect->GetAlgo() != pindex->GetAlgo())
+            pprevExpect = pprevExpect->pprev;
+        BOOST_CHECK(pindex->pprevSameAlgo == pprevExpect);
+    }
+}
+
+
+BOOST_FIXTURE_TEST_CASE(process_new_block_headers, TestChain100Setup)
+{
+    const CChainParams& chainparams = Params();
+    const Consensus::Params& params = chainparams.GetConsensus();
+    static const int versions[] = {BLOCK_VERSION_GHOSTRIDER, BLOCK_VERSION_BUTKSCRYPT, BLOCK_VERSION_GHOSTRIDER, BLOCK_VERSION_SHA256D, BLOCK_VERSION_GHOSTRIDER, BLOCK_VERSION_YESPOWER};
+    CBlockIndex* pindexTip;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+    }
+
+    // A chain of n headers on top of the tip, of which header nBad has too little work
+    auto makeHeaders = [&](uint32_t nTime, size_t n, size_t nBad) {
+        std::vector<CBlockHeader> headers(n);
+        // Index entries for the headers, so that each gets the nBits of its own parent
+        std::vector<CBlockIndex> indexes(n);
+        std::vector<uint256> hashes(n);
+        for (size_t i = 0; i < n; i++) {
+            CBlockIndex* pindexPrev = i ? &indexes[i - 1] : pindexTip;
+            CBlockHeader& header = headers[i];
+            header.nVersion = BLOCK_VERSION_DEFAULT | versions[i % 6];
+            header.hashPrevBlock = pindexPrev->GetBlockHash();
+            header.nTime = nTime + i;
+            header.nBits = GetNextWorkRequired(pindexPrev, &header, params, header.GetAlgo());
+            while (CheckProofOfWork(header.GetPOWHash(header.GetAlgo()), header.nBits, params) != (i != nBad))
+                ++header.nNonce;
+
+            hashes[i] = header.GetHash();
+            indexes[i] = CBlockIndex(header);
+            indexes[i].phashBlock = &hashes[i];
+            indexes[i].pprev = pindexPrev;
+            indexes[i].nHeight = pindexPrev->nHeight + 1;
+            indexes[i].BuildSkip();
+        }
+        return headers;
+    };
+
+    // Enough headers for several runs on the header check threads
+    ClearPowCache();
+    std::vector<CBlockHeader> headers = makeHeaders(pindexTip->nTime + 1, 40, 40);
+    CValidationState state;
+    const CBlockIndex* pindexLast = nullptr;
+    CBlockHeader first_invalid;
+    BOOST_CHECK(ProcessNewBlockHeaders(headers, state, chainparams, &pindexLast, &first_invalid));
+    BOOST_CHECK(state.IsValid());
+    BOOST_REQUIRE(pindexLast != nullptr);
+    BOOST_CHECK_EQUAL(pindexLast->nHeight, pindexTip->nHeight + 40);
+    {
+        LOCK(cs_main);
+        for (const CBlockHeader& header : headers) {
+            BlockMap::const_iterator mi = mapBlockIndex.find(header.GetHash());
+            BOOST_REQUIRE(mi != mapBlockIndex.end());
+            BOOST_CHECK(mi->second->hashPoW == header.GetPOWHash(header.GetAlgo()));
+        }
+    }
+
+    // The headers in front of one with too little work are accepted, the rest is not
+    ClearPowCache();
+    headers = makeHeaders(pindexTip->nTime + 1000, 40, 25);
+    state = CValidationState();
+    BOOST_CHECK(!ProcessNewBlockHeaders(headers, state, chainparams, &pindexLast, &first_invalid));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+    BOOST_CHECK(first_invalid.GetHash() == headers[25].GetHash());
+    {
+        LOCK(cs_main);
+        for (size_t i = 0; i < headers.size(); i++) {
+            BOOST_CHECK_EQUAL(mapBlockIndex.count(headers[i].GetHash()), i < 25 ? 1U : 0U);
+        }
+    }
+}
+
+
+BOOST_FIXTURE_TEST_CASE(verify_index_pow, TestChain100Setup)
+{
+    const CChainParams& chainparams = Params();
+    FlushStateToDisk();
+    int nLastFile = 0;
+    BOOST_CHECK(pblocktree->ReadLastBlockFile(nLastFile));
+    auto reload = [&]() {
+        UnloadBlockIndex();
+        return LoadBlockIndex(chainparams);
+    };
+    // Store the block index entry of hashBlock with its proof of work hash changed by f
+    auto rewrite = [&](const uint256& hashBlock, std::function<void(uint256&)> f) {
+        LOCK(cs_main);
+        CBlockIndex* pindex = mapBlockIndex.at(hashBlock);
+        f(pindex->hashPoW);
+        return pblocktree->WriteBatchSync({}, nLastFile, {pindex});
+    };
+
+    fVerifyIndexPow = true;
+    BOOST_CHECK(reload());
+    uint256 hashBlock, hashPoW;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(mapBlockIndex.size(), 101U);
+        for (const BlockMap::value_type& entry : mapBlockIndex) {
+            if (entry.second->nHeight == 50) {
+                hashBlock = entry.first;
+                hashPoW = entry.second->hashPoW;
+            }
+        }
+    }
+    BOOST_REQUIRE(!hashPoW.IsNull());
+
+    // A stored proof of work hash that does not match the header is only noticed with -verifyindexpow
+    BOOST_CHECK(rewrite(hashBlock, [](uint256& hash) { *hash.begin() ^= 1; }));
+    BOOST_CHECK(!reload());
+    fVerifyIndexPow = false;
+    BOOST_CHECK(reload());
+
+    fVerifyIndexPow = true;
+    BOOST_CHECK(rewrite(hashBlock, [&](uint256& hash) { hash = hashPoW; }));
+    BOOST_CHECK(reload());
+    fVerifyIndexPow = DEFAULT_VERIFYINDEXPOW;
+
+    BOOST_CHECK(LoadChainTip(chainparams));
+    BOOST_CHECK_EQUAL(chainActive.Height(), 100);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,7 @@
 #include <crypto/sha256.h>
 #include <fs.h>
 #include <key.h>
+#include <powalgo.h>
 #include <validation.h>
 #include <miner.h>
 #include <net_processing.h>
@@ -50,6 +51,7 @@ extern void noui_connect();
 BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
 {
         SHA256AutoDetect();
+        PowAlgorithmsAutoDetect();
         RandomInit();
         ECC_Start();
         BLSInit();
@@ -107,6 +109,8 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
         nScriptCheckThreads = 3;
         for (int i=0; i < nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i < nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadHeaderPowCheck);
         peerLogic.reset(new PeerLogicValidation(connman, scheduler));
 }
 
@@ -14,9 +14,12 @@
 #include <util.h>
 #include <ui_interface.h>
 #include <init.h>
+#include <warnings.h>
 
 #include <stdint.h>
 
+#include <functional>
+
 #include <boost/thread.hpp>
 
 static const char DB_COIN = 'C';
@@ -25,9 +28,11 @@ static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_ADDRESSINDEX = 'a';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSBALANCEINDEX = 'v';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_INDEX_LOCATOR = 'L';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
@@ -87,22 +92,53 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
-    CDBBatch batch(db);
-    size_t count = 0;
-    size_t changed = 0;
-    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
-    int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
-    assert(!hashBlock.IsNull());
+    return WriteCoins(mapCoins, hashBlock, &mapCoins);
+}
+
+bool CCoinsViewDB::WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    return WriteCoins(mapCoins, hashBlock, nullptr);
+}
+
+static void SimulateCrash(int crash_simulate)
+{
+    static FastRandomContext rng;
+    if (crash_simulate && rng.randrange(crash_simulate) == 0) {
+        LogPrintf("Simulating a crash. Goodbye.\n");
+        _Exit(0);
+    }
+}
 
+uint256 CCoinsViewDB::GetOldTip(const uint256 &hashBlock) const {
     uint256 old_tip = GetBestBlock();
     if (old_tip.IsNull()) {
-        // We may be in the middle of replaying.
+        // We may be in the middle of replaying, or of a write WriteHeadBlocks started.
         std::vector<uint256> old_heads = GetHeadBlocks();
         if (old_heads.size() == 2) {
             assert(old_heads[0] == hashBlock);
             old_tip = old_heads[1];
         }
     }
+    return old_tip;
+}
+
+bool CCoinsViewDB::WriteHeadBlocks(const uint256 &hashBlock) {
+    assert(!hashBlock.IsNull());
+    CDBBatch batch(db);
+    batch.Erase(DB_BEST_BLOCK);
+    batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, GetOldTip(hashBlock)});
+    // Synced, as other databases may be committed ahead of the coins after this
+    return db.WriteBatch(batch, true);
+}
+
+bool CCoinsViewDB::WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock, CCoinsMap *pmapErase) {
+    CDBBatch batch(db);
+    size_t count = 0;
+    size_t changed = 0;
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
+    assert(!hashBlock.IsNull());
+
+    uint256 old_tip = GetOldTip(hashBlock);
 
     // In the first batch, mark the database as being in the middle of a
     // transition from old_tip to hashBlock.
@@ -111,7 +147,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, old_tip});
 
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             CoinEntry entry(&it->first);
             if (it->second.coin.IsSpent())
@@ -121,19 +157,14 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        CCoinsMap::const_iterator itOld = it++;
+        if (pmapErase)
+            pmapErase->erase(itOld);
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
             batch.Clear();
-            if (crash_simulate) {
-                static FastRandomContext rng;
-                if (rng.randrange(crash_simulate) == 0) {
-                    LogPrintf("Simulating a crash. Goodbye.\n");
-                    _Exit(0);
-                }
-            }
+            SimulateCrash(crash_simulate);
         }
     }
 
@@ -152,6 +183,181 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
+CCoinsViewBackgroundWriter::CCoinsViewBackgroundWriter(CCoinsViewDB* dbIn, bool fBackgroundIn) :
+    db(dbIn), fBackground(fBackgroundIn), nPendingUsage(0), fWriteFailed(false), fStop(false)
+{
+    if (fBackground) {
+        thread = std::thread(&TraceThread<std::function<void()> >, "coinsflush",
+            std::function<void()>(std::bind(&CCoinsViewBackgroundWriter::ThreadWrite, this)));
+    }
+}
+
+CCoinsViewBackgroundWriter::~CCoinsViewBackgroundWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStop = true;
+    }
+    cond.notify_all();
+    // A flush handed over before is written before the thread exits
+    if (thread.joinable())
+        thread.join();
+}
+
+std::shared_ptr<const CCoinsViewBackgroundWriter::PendingWrite> CCoinsViewBackgroundWriter::GetPending() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return pending;
+}
+
+void CCoinsViewBackgroundWriter::ThreadWrite()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    while (true) {
+        cond.wait(lock, [this] { return fStop || (pending && !fWriteFailed); });
+        if (!pending || fWriteFailed)
+            return;
+
+        // The pending map stays readable for lookups while it is written
+        std::shared_ptr<const PendingWrite> write = pending;
+        lock.unlock();
+        // BatchWrite left the database marked as moving to the new tip; crash before any coins are written
+        SimulateCrash(gArgs.GetArg("-dbcrashratio", 0));
+        const int64_t nStart = GetTimeMicros();
+        bool fOk = false;
+        try {
+            fOk = db->WriteCoins(write->coins, write->hashBlock);
+        } catch (const std::runtime_error& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+        LogPrint(BCLog::COINDB, "Background write of %u coins for block %s took %.2fms\n",
+            (unsigned int)write->coins.size(), write->hashBlock.ToString(), (GetTimeMicros() - nStart) * 0.001);
+
+        if (!fOk) {
+            // Same as AbortNode: whatever validation does next must not build on the lost write
+            const std::string strMessage = "Failed to write to coin database";
+            SetMiscWarning(strMessage);
+            LogPrintf("*** %s\n", strMessage);
+            uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details"),
+                "", CClientUIInterface::MSG_ERROR);
+            StartShutdown();
+        }
+
+        lock.lock();
+        if (fOk) {
+            pending.reset();
+            nPendingUsage = 0;
+        } else {
+            // Keep pending, lookups have to see it still
+            fWriteFailed = true;
+        }
+        cond.notify_all();
+        // Free the written coins without holding cs
+        lock.unlock();
+        write.reset();
+        lock.lock();
+    }
+}
+
+bool CCoinsViewBackgroundWriter::GetCoin(const COutPoint &outpoint, Coin &coin) const
+{
+    std::shared_ptr<const PendingWrite> write = GetPending();
+    if (write) {
+        CCoinsMap::const_iterator it = write->coins.find(outpoint);
+        if (it != write->coins.end()) {
+            // A spent entry is a coin that the write erases from the database
+            if (it->second.coin.IsSpent())
+                return false;
+            coin = it->second.coin;
+            return true;
+        }
+    }
+    return db->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewBackgroundWriter::HaveCoin(const COutPoint &outpoint) const
+{
+    std::shared_ptr<const PendingWrite> write = GetPending();
+    if (write) {
+        CCoinsMap::const_iterator it = write->coins.find(outpoint);
+        if (it != write->coins.end())
+            return !it->second.coin.IsSpent();
+    }
+    return db->HaveCoin(outpoint);
+}
+
+uint256 CCoinsViewBackgroundWriter::GetBestBlock() const
+{
+    // The database has no best block while it is being written
+    std::shared_ptr<const PendingWrite> write = GetPending();
+    if (write)
+        return write->hashBlock;
+    return db->GetBestBlock();
+}
+
+std::vector<uint256> CCoinsViewBackgroundWriter::GetHeadBlocks() const
+{
+    return db->GetHeadBlocks();
+}
+
+bool CCoinsViewBackgroundWriter::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock)
+{
+    if (!WaitForWrite())
+        return false;
+    if (!fBackground)
+        return db->BatchWrite(mapCoins, hashBlock);
+
+    // Before the caller goes on to commit anything that builds on these coins
+    if (!db->WriteHeadBlocks(hashBlock))
+        return false;
+
+    std::shared_ptr<PendingWrite> write = std::make_shared<PendingWrite>();
+    write->hashBlock = hashBlock;
+    write->coins.reserve(mapCoins.size());
+    size_t nCoinsUsage = 0;
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+        // Entries that are not dirty hold what the database has already
+        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+            CCoinsCacheEntry& entry = write->coins.emplace(std::piecewise_construct, std::forward_as_tuple(it->first), std::forward_as_tuple(std::move(it->second.coin))).first->second;
+            entry.flags = CCoinsCacheEntry::DIRTY;
+            nCoinsUsage += entry.coin.DynamicMemoryUsage();
+        }
+        CCoinsMap::iterator itOld = it++;
+        mapCoins.erase(itOld);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        nPendingUsage = memusage::DynamicUsage(write->coins) + nCoinsUsage;
+        pending = std::move(write);
+    }
+    cond.notify_all();
+    return true;
+}
+
+CCoinsViewCursor *CCoinsViewBackgroundWriter::Cursor() const
+{
+    return db->Cursor();
+}
+
+size_t CCoinsViewBackgroundWriter::EstimateSize() const
+{
+    return db->EstimateSize();
+}
+
+bool CCoinsViewBackgroundWriter::WaitForWrite()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    cond.wait(lock, [this] { return !pending || fWriteFailed; });
+    return !fWriteFailed;
+}
+
+size_t CCoinsViewBackgroundWriter::DynamicMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return nPendingUsage;
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe), mapHasTxIndexCache(10000, 20000) {
 }
 
@@ -278,6 +484,16 @@ bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     return Read(std::make_pair(DB_SPENTINDEX, key), value);
 }
 
+void CBlockTreeDB::SpentIndexToBatch(CDBBatch &batch, const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > &vect) {
+    for (const auto& entry : vect) {
+        if (entry.second.IsNull()) {
+            batch.Erase(std::make_pair(DB_SPENTINDEX, entry.first));
+        } else {
+            batch.Write(std::make_pair(DB_SPENTINDEX, entry.first), entry.second);
+        }
+    }
+}
+
 bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
@@ -342,6 +558,74 @@ bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKe
     return WriteBatch(batch);
 }
 
+void CBlockTreeDB::AddressIndexesToBatch(CDBBatch &batch, const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, bool fErase,
+                                         const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &addressUnspentIndex,
+                                         bool fBalanceIndex) {
+    std::map<CAddressBalanceKey, CAddressBalanceValue> mapBalanceDeltas;
+    for (const auto& entry : addressIndex) {
+        if (fErase) {
+            batch.Erase(std::make_pair(DB_ADDRESSINDEX, entry.first));
+        } else {
+            batch.Write(std::make_pair(DB_ADDRESSINDEX, entry.first), entry.second);
+        }
+        if (fBalanceIndex) {
+            // Same sums getaddressbalance takes over the address index entries
+            CAddressBalanceValue& delta = mapBalanceDeltas[CAddressBalanceKey(entry.first.type, entry.first.hashBytes)];
+            const CAmount nReceived = entry.second > 0 ? entry.second : 0;
+            delta.balance += fErase ? -entry.second : entry.second;
+            delta.received += fErase ? -nReceived : nReceived;
+        }
+    }
+    for (const auto& entry : addressUnspentIndex) {
+        if (entry.second.IsNull()) {
+            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first));
+        } else {
+            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first), entry.second);
+        }
+    }
+    for (const auto& entry : mapBalanceDeltas) {
+        // Not found leaves the totals of a new address at zero
+        CAddressBalanceValue value;
+        Read(std::make_pair(DB_ADDRESSBALANCEINDEX, entry.first), value);
+        value.balance += entry.second.balance;
+        value.received += entry.second.received;
+        if (value.IsNull()) {
+            batch.Erase(std::make_pair(DB_ADDRESSBALANCEINDEX, entry.first));
+        } else {
+            batch.Write(std::make_pair(DB_ADDRESSBALANCEINDEX, entry.first), value);
+        }
+    }
+}
+
+bool CBlockTreeDB::EraseAddressBalances() {
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_ADDRESSBALANCEINDEX, CAddressBalanceKey()));
+
+    CDBBatch batch(*this);
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressBalanceKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSBALANCEINDEX) {
+            break;
+        }
+        batch.Erase(key);
+        if (batch.SizeEstimate() > (1 << 24)) {
+            if (!WriteBatch(batch)) {
+                return false;
+            }
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value) {
+    value.SetNull();
+    Read(std::make_pair(DB_ADDRESSBALANCEINDEX, CAddressBalanceKey(type, addressHash)), value);
+    return true;
+}
+
 bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                                     int start, int end) {
@@ -376,6 +660,14 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
+void CBlockTreeDB::TimestampIndexToBatch(CDBBatch &batch, const CTimestampIndexKey &timestampIndex, bool fErase) {
+    if (fErase) {
+        batch.Erase(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex));
+    } else {
+        batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
+    }
+}
+
 bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
     CDBBatch batch(*this);
     batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
@@ -402,6 +694,14 @@ bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned i
     return true;
 }
 
+void CBlockTreeDB::WriteIndexLocator(CDBBatch &batch, const std::string &name, const CBlockLocator &locator) {
+    batch.Write(std::make_pair(DB_INDEX_LOCATOR, name), locator);
+}
+
+bool CBlockTreeDB::ReadIndexLocator(const std::string &name, CBlockLocator &locator) {
+    return Read(std::make_pair(DB_INDEX_LOCATOR, name), locator);
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -441,9 +741,8 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
                 pindexNew->nNonce         = diskindex.nNonce;
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
-                // TODO: replace this check with something faster
-             //  if  (!CheckProofOfWork(diskindex.hashPOWShared, pindexNew->nBits, consensusParams))
-            //       return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
+                pindexNew->hashPoW        = diskindex.hashPOWShared;
+                // Rehashing every header here is far too slow to do serially; see -verifyindexpow
 
                 pcursor->Next();
             } else {
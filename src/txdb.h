@@ -13,8 +13,12 @@
 #include <spentindex.h>
 #include <sync.h>
 
+#include <condition_variable>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -28,6 +32,8 @@ static constexpr int MAX_BLOCK_COINSDB_USAGE = 10;
 static const int64_t nDefaultDbCache = 300;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -backgroundflush default
+static const bool DEFAULT_BACKGROUND_FLUSH = true;
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
@@ -80,11 +86,20 @@ public:
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    //! Write like BatchWrite, but leave mapCoins as it is, so that other threads can read it meanwhile
+    bool WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock);
+    //! Mark the database as moving to hashBlock, as the first batch of a write does, and sync that to disk
+    bool WriteHeadBlocks(const uint256 &hashBlock);
     CCoinsViewCursor *Cursor() const override;
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
+
+private:
+    bool WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock, CCoinsMap *pmapErase);
+    //! The best block a write to hashBlock starts from, also when a marked write is resumed
+    uint256 GetOldTip(const uint256 &hashBlock) const;
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -109,6 +124,77 @@ private:
     friend class CCoinsViewDB;
 };
 
+/**
+ * CCoinsView between pcoinsTip and the coin database that writes flushes to
+ * the database in a thread of its own, so that cs_main is not held for the
+ * length of a database write.
+ *
+ * BatchWrite moves the dirty entries of the flushed cache into a pending map,
+ * hands that to the writer thread and returns, so the flushed cache is empty
+ * and in use again straight away. Until the write is committed, lookups go to
+ * the pending map before the database. Only one flush is written at a time;
+ * BatchWrite waits for the previous one to be committed first.
+ *
+ * Before it returns, BatchWrite marks the database as moving from its old
+ * best block to the new one with CCoinsViewDB::WriteHeadBlocks, synced to
+ * disk. The writer thread then uses CCoinsViewDB::WriteCoins, which marks the
+ * database as consistent with the new best block in its last batch. A crash
+ * at any point after BatchWrite returned is therefore recovered at startup by
+ * ReplayBlocks, as one during a synchronous flush always was, also when the
+ * caller has committed other state for the new best block, like EvoDB, in
+ * the meantime. The block index those best blocks refer to is written by the
+ * caller before BatchWrite.
+ *
+ * Without fBackground, BatchWrite writes to the database itself.
+ */
+class CCoinsViewBackgroundWriter : public CCoinsView
+{
+private:
+    /** The coins of a flush that is being written; nobody changes them until the write is done */
+    struct PendingWrite {
+        CCoinsMapMemoryResource resource;
+        CCoinsMap coins;
+        uint256 hashBlock;
+
+        PendingWrite() : coins(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource) {}
+    };
+
+    CCoinsViewDB* db;
+    const bool fBackground;
+
+    mutable std::mutex cs;
+    std::condition_variable cond;
+    //! Flush handed to the writer thread and not committed yet, if any (guarded by cs)
+    std::shared_ptr<const PendingWrite> pending;
+    //! Size of the pending map for DynamicMemoryUsage (guarded by cs)
+    size_t nPendingUsage;
+    //! Whether a background write failed; the database state is unknown after that (guarded by cs)
+    bool fWriteFailed;
+    bool fStop;
+    std::thread thread;
+
+    std::shared_ptr<const PendingWrite> GetPending() const;
+    void ThreadWrite();
+
+public:
+    CCoinsViewBackgroundWriter(CCoinsViewDB* dbIn, bool fBackgroundIn);
+    ~CCoinsViewBackgroundWriter();
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    uint256 GetBestBlock() const override;
+    std::vector<uint256> GetHeadBlocks() const override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    //! Cursor over the database; it does not see a flush that is still being written
+    CCoinsViewCursor *Cursor() const override;
+    size_t EstimateSize() const override;
+
+    /** Wait until the flush being written, if any, is committed. Returns false if a write failed. */
+    bool WaitForWrite();
+    /** Memory held by the flush being written */
+    size_t DynamicMemoryUsage() const;
+};
+
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CDBWrapper
 {
@@ -132,15 +218,32 @@ public:
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
     bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
     bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
+    void SpentIndexToBatch(CDBBatch &batch, const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > &vect);
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
     bool ReadAddressUnspentIndex(uint160 addressHash, int type,
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
     bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
+    /**
+     * Add the address index entries of a block (or with fErase, their removal) and its
+     * unspent index changes to batch, keeping the per-address balance totals in step with
+     * the entries if fBalanceIndex. The totals are read from the database, so batches of
+     * consecutive blocks must be written in order.
+     */
+    void AddressIndexesToBatch(CDBBatch &batch, const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, bool fErase,
+                               const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &addressUnspentIndex,
+                               bool fBalanceIndex);
+    bool EraseAddressBalances();
+    /** Balance and total received of an address; zero if it never appeared in the index */
+    bool ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value);
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                           int start = 0, int end = 0);
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
+    void TimestampIndexToBatch(CDBBatch &batch, const CTimestampIndexKey &timestampIndex, bool fErase);
+    /** Block the named background index has processed the active chain up to, see index/base.h */
+    void WriteIndexLocator(CDBBatch &batch, const std::string &name, const CBlockLocator &locator);
+    bool ReadIndexLocator(const std::string &name, CBlockLocator &locator);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &vect);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
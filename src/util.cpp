@@ -38,6 +38,9 @@
 
 #define _POSIX_C_SOURCE 200112L
 
+#include <pthread.h>
+#include <sched.h>
+
 #endif // __linux__
 
 #include <algorithm>
@@ -279,6 +282,7 @@ const CLogCategoryDesc LogCategories[] =
     {BCLog::MNSYNC, "mnsync"},
     {BCLog::PRIVATESEND, "privatesend"},
     {BCLog::SPORK, "spork"},
+    {BCLog::STRATUM, "stratum"},
     //End But
 
 };
@@ -301,7 +305,8 @@ bool GetLogCategory(uint64_t *f, const std::string *str)
                 | BCLog::MNPAYMENTS
                 | BCLog::MNSYNC
                 | BCLog::PRIVATESEND
-                | BCLog::SPORK;
+                | BCLog::SPORK
+                | BCLog::STRATUM;
             return true;
         }
         for (unsigned int i = 0; i < ARRAYLEN(LogCategories); i++) {
@@ -1124,3 +1129,23 @@ void SetThreadPriority(int nPriority)
 #endif // PRIO_THREAD
 #endif // WIN32
 }
+
+bool SetThreadAffinity(int nCpu)
+{
+    if (nCpu < 0)
+        return false;
+#ifdef WIN32
+    if (nCpu >= (int)(8 * sizeof(DWORD_PTR)))
+        return false;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << nCpu) != 0;
+#elif defined(__linux__)
+    if (nCpu >= CPU_SETSIZE)
+        return false;
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(nCpu, &cpuset);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0;
+#else
+    return false;
+#endif
+}
@@ -139,6 +139,7 @@ namespace BCLog {
         MNSYNC      = ((uint64_t)1 << 40),
         PRIVATESEND = ((uint64_t)1 << 41),
         SPORK       = ((uint64_t)1 << 42),
+        STRATUM     = ((uint64_t)1 << 43),
         //End But
 
         ALL         = ~(uint64_t)0,
@@ -407,5 +408,7 @@ std::string IntVersionToString(uint32_t nVersion);
 std::string SafeIntVersionToString(uint32_t nVersion);
 
 void SetThreadPriority(int nPriority);
+/** Pin the calling thread to one CPU; returns false where this is not supported */
+bool SetThreadAffinity(int nCpu);
 
 #endif // BITCOIN_UTIL_H
@@ -24,6 +24,7 @@
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <pow.h>
+#include <powcache.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <reverse_iterator.h>
@@ -84,6 +85,7 @@ std::atomic_bool fImporting(false);
 bool fReindex = false;
 bool fTxIndex = true;
 bool fAddressIndex = false;
+bool fAddressBalanceIndex = false;
 bool fFutureIndex = false;
 bool fTimestampIndex = false;
 bool fSpentIndex = false;
@@ -93,6 +95,9 @@ bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
 bool fRequireStandard = true;
 unsigned int nBytesPerSigOp = DEFAULT_BYTES_PER_SIGOP;
 bool fCheckBlockIndex = false;
+bool fCheckBlockReadPow = DEFAULT_CHECKBLOCKREADPOW;
+bool fVerifyIndexPow = DEFAULT_VERIFYINDEXPOW;
+bool fPrefetchCoins = DEFAULT_PREFETCHCOINS;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
@@ -218,6 +223,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 CCoinsViewDB *pcoinsdbview = nullptr;
+CCoinsViewBackgroundWriter *pcoinswriter = nullptr;
 CCoinsViewCache *pcoinsTip = nullptr;
 CBlockTreeDB *pblocktree = nullptr;
 
@@ -865,6 +871,17 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     return true;
 }
 
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value)
+{
+    if (!fAddressBalanceIndex)
+        return error("address balance index not enabled");
+
+    if (!pblocktree->ReadAddressBalance(addressHash, type, value))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
 /** Return transaction in txOut, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus::Params& consensusParams, uint256 &hashBlock, bool fAllowSlow)
 {
@@ -955,7 +972,7 @@ static bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMes
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+static bool ReadBlockFromDiskUnchecked(CBlock& block, const CDiskBlockPos& pos)
 {
     block.SetNull();
 
@@ -972,6 +989,14 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
     }
 
+    return true;
+}
+
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+{
+    if (!ReadBlockFromDiskUnchecked(block, pos))
+        return false;
+
     // Check the header
     if (!CheckProofOfWork(block.GetPOWHash(block.GetAlgo()), block.nBits, consensusParams))
         return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
@@ -979,13 +1004,31 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
     return true;
 }
 
+static bool HeaderMatchesIndex(const CBlockHeader& block, const CBlockIndex* pindex)
+{
+    return block.nVersion == pindex->nVersion &&
+           block.hashPrevBlock == (pindex->pprev ? pindex->pprev->GetBlockHash() : uint256()) &&
+           block.hashMerkleRoot == pindex->hashMerkleRoot &&
+           block.nTime == pindex->nTime &&
+           block.nBits == pindex->nBits &&
+           block.nNonce == pindex->nNonce;
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
-    if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams))
+    const CDiskBlockPos pos = pindex->GetBlockPos();
+    if (!ReadBlockFromDiskUnchecked(block, pos))
         return false;
-    if (block.GetHash() != pindex->GetBlockHash())
+    if (!HeaderMatchesIndex(block, pindex) || block.GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
-                pindex->ToString(), pindex->GetBlockPos().ToString());
+                pindex->ToString(), pos.ToString());
+
+    // The header is the one the index was built from, so its proof of work was already
+    // hashed and checked on acceptance; only redo that if asked to or if we don't have it.
+    const uint256 hashPoW = (fCheckBlockReadPow || pindex->hashPoW.IsNull()) ? block.GetPOWHash(block.GetAlgo()) : pindex->hashPoW;
+    if (!CheckProofOfWork(hashPoW, block.nBits, consensusParams))
+        return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
+
     return true;
 }
 
@@ -1438,6 +1481,18 @@ bool AbortNode(CValidationState& state, const std::string& strMessage, const std
 
 } // namespace
 
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    CDiskBlockPos pos;
+    {
+        LOCK(cs_main);
+        pos = pindex->GetUndoPos();
+    }
+    if (pos.IsNull())
+        return error("%s: no undo data available for block %s", __func__, pindex->GetBlockHash().ToString());
+    return UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash());
+}
+
 enum DisconnectResult
 {
     DISCONNECT_OK,      // All good.
@@ -1510,10 +1565,6 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
         return DISCONNECT_FAILED;
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
-
     if (!UndoSpecialTxsInBlock(block, pindex)) {
         return DISCONNECT_FAILED;
     }
@@ -1524,41 +1575,6 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
         uint256 hash = tx.GetHash();
         bool is_coinbase = tx.IsCoinBase();
 
-        if (fAddressIndex) {
-
-            for (unsigned int k = tx.vout.size(); k-- > 0;) {
-                const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, hash, k, false), out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, k), CAddressUnspentValue()));
-                } else {
-                    continue;
-                }
-
-            }
-
-        }
-
         // Check that all outputs are available and match the outputs in the block itself
         // exactly.
         for (size_t o = 0; o < tx.vout.size(); o++) {
@@ -1581,49 +1597,9 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
             }
             for (unsigned int j = tx.vin.size(); j-- > 0;) {
                 const COutPoint &out = tx.vin[j].prevout;
-                int undoHeight = txundo.vprevout[j].nHeight;
                 int res = ApplyTxInUndo(std::move(txundo.vprevout[j]), view, out);
                 if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
                 fClean = fClean && res != DISCONNECT_UNCLEAN;
-
-                const CTxIn input = tx.vin[j];
-
-                if (fSpentIndex) {
-                    // undo and delete the spent index
-                    spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue()));
-                }
-
-                if (fAddressIndex) {
-                    const Coin &coin = view.AccessCoin(tx.vin[j].prevout);
-                    const CTxOut &prevout = coin.out;
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undoHeight)));
-
-
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undoHeight)));
-
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, hash, j, false), prevout.nValue));
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, j), CAddressUnspentValue()));
-                    } else {
-                        continue;
-                    }
-                }
-
             }
             // At this point, all of txundo.vprevout should have been moved out.
         }
@@ -1632,24 +1608,6 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
-    if (fSpentIndex) {
-        if (!pblocktree->UpdateSpentIndex(spentIndex)) {
-            AbortNode("Failed to delete spent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-
-    if (fAddressIndex) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            AbortNode("Failed to delete address index");
-            return DISCONNECT_FAILED;
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            AbortNode("Failed to write address unspent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-
     evoDb->WriteBestBlock(pindex->pprev->GetBlockHash());
 
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
@@ -1706,38 +1664,9 @@ int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Para
             nVersion |= VersionBitsMask(params, (Consensus::DeploymentPos)i);
         }
     }
-    switch (algo)
-    {
-        case ALGO_BUTKSCRYPT:
-        nVersion |= BLOCK_VERSION_BUTKSCRYPT;
-        break;
-        case ALGO_SHA256D:
-        nVersion |= BLOCK_VERSION_SHA256D;
-        break;
-        case ALGO_GHOSTRIDER:
-        nVersion |= BLOCK_VERSION_GHOSTRIDER;
-        break;
-        case ALGO_YESPOWER:
-        if (pindexPrev->nHeight < params.v2DiffChangeHeight)
-            nVersion |= BLOCK_VERSION_BUTKSCRYPT;
-        else
-            nVersion |= BLOCK_VERSION_YESPOWER;
-        break;
-        case ALGO_LYRA2:
-        if (pindexPrev->nHeight < params.AlgoChangeHeight)
-            nVersion |= BLOCK_VERSION_BUTKSCRYPT;
-        else
-            nVersion |= BLOCK_VERSION_LYRA2;
-		break;
-        case ALGO_SCRYPT:
-        if (pindexPrev->nHeight < params.nSwitchHeight)
-            nVersion |= BLOCK_VERSION_BUTKSCRYPT;
-        else
-            nVersion |= BLOCK_VERSION_SCRYPT;
-        break;
-        default:
-        break;
-    }
+    // Algorithms that are not active yet mine ButKScrypt versions
+    if (const PowAlgorithm* pa = GetPowAlgorithm(algo))
+        nVersion |= pa->IsActive(pindexPrev->nHeight, params) ? pa->nVersionBits : BLOCK_VERSION_BUTKSCRYPT;
     return nVersion;
 }
 
@@ -1933,9 +1862,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     std::vector<std::pair<uint256, CDiskTxPos> > vPos;
     vPos.reserve(block.vtx.size());
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
 
     std::vector<PrecomputedTransactionData> txdata;
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
@@ -1946,7 +1872,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *(block.vtx[i]);
-        const uint256 txhash = tx.GetHash();
 
         nInputs += tx.vin.size();
 
@@ -1974,47 +1899,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                 return state.DoS(100, error("%s: contains a non-BIP68-final transaction", __func__),
                                  REJECT_INVALID, "bad-txns-nonfinal");
             }
-
-            if (fAddressIndex || fSpentIndex)
-            {
-                for (size_t j = 0; j < tx.vin.size(); j++) {
-                    const CTxIn input = tx.vin[j];
-                    const Coin& coin = view.AccessCoin(tx.vin[j].prevout);
-                    const CTxOut &prevout = coin.out;
-                    uint160 hashBytes;
-                    int addressType;
-
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        hashBytes = uint160(std::vector<unsigned char>(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22));
-                        addressType = 2;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        hashBytes = uint160(std::vector<unsigned char>(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23));
-                        addressType = 1;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        hashBytes = Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1);
-                        addressType = 1;
-                    } else {
-                        hashBytes.SetNull();
-                        addressType = 0;
-                    }
-
-                    if (fAddressIndex && addressType > 0) {
-                        // record spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
-
-                        // remove address from unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                    }
-
-                    if (fSpentIndex) {
-                        // add the spent index to determine the txid and input that spent an output
-                        // and to find the amount and address from an input
-                        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, pindex->nHeight, prevout.nValue, addressType, hashBytes)));
-                    }
-                }
-
-            }
-
         }
 
         // GetTransactionSigOpCount counts 2 types of sigops:
@@ -2037,39 +1921,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             control.Add(vChecks);
         }
 
-        if (fAddressIndex) {
-            for (unsigned int k = 0; k < tx.vout.size(); k++) {
-                const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, txhash, k, false), out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-                } else {
-                    continue;
-                }
-
-            }
-        }
-
         CTxUndo undoDummy;
         if (i > 0) {
             blockundo.vtxundo.push_back(CTxUndo());
@@ -2187,24 +2038,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         if (!pblocktree->WriteTxIndex(vPos))
             return AbortNode(state, "Failed to write transaction index");
 
-    if (fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
-    }
-
-    if (fSpentIndex)
-        if (!pblocktree->UpdateSpentIndex(spentIndex))
-            return AbortNode(state, "Failed to write transaction index");
-
-    if (fTimestampIndex)
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
-
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
@@ -2306,8 +2139,12 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                 }
             }
             // Finally remove any pruned files
-            if (fFlushForPrune)
+            if (fFlushForPrune) {
+                // A crash during a background write replays its blocks, which must still be there
+                if (pcoinswriter && !pcoinswriter->WaitForWrite())
+                    return AbortNode(state, "Failed to write to coin database");
                 UnlinkPrunedFiles(setFilesToPrune);
+            }
             nLastWrite = nNow;
         }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
@@ -2320,11 +2157,19 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
             // Flush the chainstate (which may refer to block index entries).
+            // With pcoinswriter this only waits for its previous write, marks the
+            // coin database as moving to the new tip, so that a crash from here on
+            // is replayed even if EvoDB below is ahead of the coins, and hands the
+            // dirty coins over to its thread, which writes them after the block
+            // index above is on disk.
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
         if (!evoDb->CommitRootTransaction()) {
             return AbortNode(state, "Failed to commit EvoDB");
         }
+            // Shutdown and the callers that read the coin database directly need the write done
+            if (mode == FLUSH_STATE_ALWAYS && pcoinswriter && !pcoinswriter->WaitForWrite())
+                return AbortNode(state, "Failed to write to coin database");
             nLastFlush = nNow;
         }
     }
@@ -2477,6 +2322,9 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
+static uint64_t nPrefetchCoins = 0;
+static uint64_t nPrefetchCached = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -2547,6 +2395,107 @@ public:
     }
 };
 
+/**
+ * Reads a run of coins from the coins database on a prefetch thread. LevelDB
+ * reads are safe to do concurrently, also with the background write of a
+ * flush, whose coins pcoinswriter looks up before the database. Nothing hands
+ * a new flush to pcoinswriter meanwhile, as PrefetchBlockCoins() holds cs_main
+ * while it waits.
+ */
+class CCoinPrefetch
+{
+private:
+    const CCoinsView* pview;
+    const COutPoint* poutpoints;
+    Coin* pcoins;
+    size_t nCount;
+
+public:
+    CCoinPrefetch() : pview(nullptr), poutpoints(nullptr), pcoins(nullptr), nCount(0) {}
+    CCoinPrefetch(const CCoinsView* pviewIn, const COutPoint* poutpointsIn, Coin* pcoinsIn, size_t nCountIn) :
+        pview(pviewIn), poutpoints(poutpointsIn), pcoins(pcoinsIn), nCount(nCountIn) {}
+
+    /** Fails on a database error, which is left to ConnectBlock() to run into and report */
+    bool operator()()
+    {
+        try {
+            for (size_t i = 0; i < nCount; i++)
+                pview->GetCoin(poutpoints[i], pcoins[i]);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+            return false;
+        }
+        return true;
+    }
+
+    void swap(CCoinPrefetch& check)
+    {
+        std::swap(pview, check.pview);
+        std::swap(poutpoints, check.poutpoints);
+        std::swap(pcoins, check.pcoins);
+        std::swap(nCount, check.nCount);
+    }
+};
+
+static CCheckQueue<CCoinPrefetch> coinprefetchqueue(8);
+
+void ThreadCoinPrefetch() {
+    RenameThread("but-prefetch");
+    coinprefetchqueue.Thread();
+}
+
+/**
+ * Read the coins that block spends and that are neither created in the block
+ * nor cached in pcoinsTip from the coins database across the prefetch threads,
+ * and cache them in view, so that ConnectBlock() finds its inputs in memory
+ * instead of waiting on one database read after another. The coins of a block
+ * that turns out invalid are dropped with view rather than kept in pcoinsTip.
+ */
+static void PrefetchBlockCoins(const CBlock& block, CCoinsViewCache& view, size_t& nCoins, size_t& nCached, size_t& nRead)
+{
+    AssertLockHeld(cs_main);
+    nCoins = nCached = nRead = 0;
+    const CCoinsView* pview = pcoinswriter ? static_cast<const CCoinsView*>(pcoinswriter) : pcoinsdbview;
+    if (!fPrefetchCoins || nScriptCheckThreads == 0 || !pview || block.vtx.size() < 2)
+        return;
+
+    std::set<uint256> setBlockTxids;
+    for (const auto& tx : block.vtx)
+        setBlockTxids.insert(tx->GetHash());
+
+    std::vector<COutPoint> vOutpoints;
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        for (const CTxIn& txin : block.vtx[i]->vin) {
+            if (setBlockTxids.count(txin.prevout.hash))
+                continue;
+            nCoins++;
+            if (pcoinsTip->HaveEntryInCache(txin.prevout)) {
+                nCached++;
+                continue;
+            }
+            vOutpoints.push_back(txin.prevout);
+        }
+    }
+    if (vOutpoints.empty())
+        return;
+
+    std::vector<Coin> vCoins(vOutpoints.size());
+    const size_t nPerCheck = std::max<size_t>(1, std::min<size_t>(COIN_PREFETCH_BATCH, vOutpoints.size() / nScriptCheckThreads));
+    std::vector<CCoinPrefetch> vChecks;
+    for (size_t i = 0; i < vOutpoints.size(); i += nPerCheck)
+        vChecks.emplace_back(pview, &vOutpoints[i], &vCoins[i], std::min(nPerCheck, vOutpoints.size() - i));
+    CCheckQueueControl<CCoinPrefetch> control(&coinprefetchqueue);
+    control.Add(vChecks);
+    if (!control.Wait())
+        return;
+
+    for (size_t i = 0; i < vOutpoints.size(); i++) {
+        if (!vCoins[i].IsSpent())
+            nRead++;
+        view.CacheFetchedCoin(vOutpoints[i], std::move(vCoins[i]));
+    }
+}
+
 /**
  * Connect a new block to chainActive. pblock is either nullptr or a pointer to a CBlock
  * corresponding to pindexNew, to bypass loading it again from disk.
@@ -2576,6 +2525,13 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
         auto dbTx = evoDb->BeginTransaction();
 
         CCoinsViewCache view(pcoinsTip);
+        size_t nCoins, nCached, nRead;
+        PrefetchBlockCoins(blockConnecting, view, nCoins, nCached, nRead);
+        int64_t nTime2p = GetTimeMicros(); nTimePrefetch += nTime2p - nTime2;
+        nPrefetchCoins += nCoins; nPrefetchCached += nCached;
+        LogPrint(BCLog::BENCHMARK, "  - Prefetch %u coins (%u cached, %u read): %.2fms [%.2fs, %.1f%% cached]\n", nCoins, nCached, nRead,
+            (nTime2p - nTime2) * 0.001, nTimePrefetch * 0.000001, nPrefetchCoins ? 100.0 * nPrefetchCached / nPrefetchCoins : 0.0);
+
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
@@ -2583,8 +2539,8 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
                 InvalidBlockFound(pindexNew, state);
             return error("ConnectTip(): ConnectBlock %s failed with %s", pindexNew->GetBlockHash().ToString(), FormatStateMessage(state));
         }
-        nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
-        LogPrint(BCLog::BENCHMARK, "  - Connect total: %.2fms [%.2fs]\n", (nTime3 - nTime2) * 0.001, nTimeConnectTotal * 0.000001);
+        nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2p;
+        LogPrint(BCLog::BENCHMARK, "  - Connect total: %.2fms [%.2fs]\n", (nTime3 - nTime2p) * 0.001, nTimeConnectTotal * 0.000001);
         bool flushed = view.Flush();
         assert(flushed);
         dbTx->Commit();
@@ -3003,7 +2959,8 @@ bool ResetBlockFailureFlags(CBlockIndex *pindex) {
     return true;
 }
 
-static CBlockIndex* AddToBlockIndex(const CBlockHeader& block, enum BlockStatus nStatus = BLOCK_VALID_TREE)
+/** pPowHash, if given, is block.GetPOWHash(block.GetAlgo()) as already computed by the caller */
+static CBlockIndex* AddToBlockIndex(const CBlockHeader& block, enum BlockStatus nStatus = BLOCK_VALID_TREE, const uint256* pPowHash = nullptr)
 {
     // Check for duplicate
     uint256 hash = block.GetHash();
@@ -3018,6 +2975,7 @@ static CBlockIndex* AddToBlockIndex(const CBlockHeader& block, enum BlockStatus
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
     pindexNew->nSequenceId = 0;
+    pindexNew->hashPoW = pPowHash ? *pPowHash : block.GetPOWHash(block.GetAlgo());
     BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
     BlockMap::iterator miPrev = mapBlockIndex.find(block.hashPrevBlock);
@@ -3182,26 +3140,19 @@ static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos,
     return true;
 }
 
-static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
+/** pPowHash, if given, is block.GetPOWHash(block.GetAlgo()) computed by the caller */
+static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, const uint256* pPowHash = nullptr)
 {
 
-   if (block.nVersion > 4) { 
-        switch (block.nVersion & BLOCK_VERSION_ALGO)
-        {
-            case BLOCK_VERSION_BUTKSCRYPT:
-            case BLOCK_VERSION_SHA256D:
-            case BLOCK_VERSION_LYRA2:
-            case BLOCK_VERSION_GHOSTRIDER:
-            case BLOCK_VERSION_YESPOWER:
-            case BLOCK_VERSION_SCRYPT:
-                break;
-            default:
-                return state.DoS(50, false, REJECT_INVALID, "unknown-algo", false, "unknown proof of work algorithm");
-        }
-   }
+   if (block.nVersion > 4 && !GetPowAlgorithmByVersion(block.nVersion))
+        return state.DoS(50, false, REJECT_INVALID, "unknown-algo", false, "unknown proof of work algorithm");
     // Check proof of work matches claimed amount
-    if (fCheckPOW && !CheckProofOfWork(block.GetPOWHash(block.GetAlgo()), block.nBits, consensusParams))
-        return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
+    if (fCheckPOW) {
+        const uint256 hashPoW = pPowHash ? *pPowHash : GetPowHashCached(block);
+        if (!CheckProofOfWork(hashPoW, block.nBits, consensusParams))
+            return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
+        InsertPowCache(block, hashPoW);
+    }
 
     // Check DevNet
     if (!consensusParams.hashDevnetGenesisBlock.IsNull() &&
@@ -3397,11 +3348,12 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     return true;
 }
 
-static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+/** pPowHash, if given, is block.GetPOWHash(block.GetAlgo()) computed ahead of time without cs_main */
+static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, const uint256* pPowHash = nullptr)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
-    uint256 hash = block.GetPOWHash(block.GetAlgo()); //block.GetHash();
+    uint256 hash = pPowHash ? *pPowHash : GetPowHashCached(block); //block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = nullptr;
 
@@ -3418,7 +3370,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), true, &hash))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -3456,13 +3408,13 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
 
         if (llmq::chainLocksHandler->HasConflictingChainLock(pindexPrev->nHeight + 1, hash)) {
             if (pindex == nullptr) {
-                AddToBlockIndex(block, BLOCK_CONFLICT_CHAINLOCK);
+                AddToBlockIndex(block, BLOCK_CONFLICT_CHAINLOCK, &hash);
             }
             return state.DoS(10, error("%s: header %s conflicts with chainlock", __func__, hash.ToString()), REJECT_INVALID, "bad-chainlock");
         }
     }
     if (pindex == nullptr)
-        pindex = AddToBlockIndex(block);
+        pindex = AddToBlockIndex(block, BLOCK_VALID_TREE, &hash);
 
     if (ppindex)
         *ppindex = pindex;
@@ -3475,15 +3427,130 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
     return true;
 }
 
+/**
+ * Computes the PoW hashes of a run of consecutive headers and checks them
+ * against their nBits. This runs on the header check threads before cs_main
+ * is taken, so that AcceptBlockHeader() only has to look the hashes up.
+ * GhostRider headers are hashed together with HashGRBatch(), and headers
+ * whose proof of work was verified before come from the PoW cache.
+ */
+class CHeaderPowCheck
+{
+private:
+    const CBlockHeader* pheaders;
+    uint256* phashes;
+    char* pfHashed;
+    size_t nCount;
+    const Consensus::Params* pparams;
+
+public:
+    CHeaderPowCheck() : pheaders(nullptr), phashes(nullptr), pfHashed(nullptr), nCount(0), pparams(nullptr) {}
+    CHeaderPowCheck(const CBlockHeader* pheadersIn, uint256* phashesIn, char* pfHashedIn, size_t nCountIn, const Consensus::Params& params) :
+        pheaders(pheadersIn), phashes(phashesIn), pfHashed(pfHashedIn), nCount(nCountIn), pparams(&params) {}
+
+    /** Fails on a header with too little work, so that the queue skips what is left of the message */
+    bool operator()()
+    {
+        std::vector<const void*> vGRInputs;
+        std::vector<GhostRiderSchedule> vGRSchedules;
+        std::vector<size_t> vGRIndexes;
+        for (size_t i = 0; i < nCount; i++) {
+            const CBlockHeader& header = pheaders[i];
+            if (LookupPowCache(header, phashes[i])) {
+                pfHashed[i] = 1;
+                continue;
+            }
+            if (header.GetAlgo() == ALGO_GHOSTRIDER) {
+                vGRInputs.push_back(BEGIN(header.nVersion));
+                vGRSchedules.push_back(GetGhostRiderSchedule(header.hashPrevBlock));
+                vGRIndexes.push_back(i);
+                continue;
+            }
+            phashes[i] = header.GetPOWHash(header.GetAlgo());
+            pfHashed[i] = 1;
+            if (!CheckProofOfWork(phashes[i], header.nBits, *pparams))
+                return false;
+        }
+
+        if (!vGRIndexes.empty()) {
+            std::vector<uint256> vGRHashes(vGRIndexes.size());
+            HashGRBatch(vGRInputs.data(), 80, vGRSchedules.data(), vGRHashes.data(), vGRIndexes.size());
+            for (size_t j = 0; j < vGRIndexes.size(); j++) {
+                const size_t i = vGRIndexes[j];
+                phashes[i] = vGRHashes[j];
+                pfHashed[i] = 1;
+                if (!CheckProofOfWork(phashes[i], pheaders[i].nBits, *pparams))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    void swap(CHeaderPowCheck& check)
+    {
+        std::swap(pheaders, check.pheaders);
+        std::swap(phashes, check.phashes);
+        std::swap(pfHashed, check.pfHashed);
+        std::swap(nCount, check.nCount);
+        std::swap(pparams, check.pparams);
+    }
+};
+
+static CCheckQueue<CHeaderPowCheck> headerpowcheckqueue(8);
+
+void ThreadHeaderPowCheck() {
+    RenameThread("but-powcheck");
+    headerpowcheckqueue.Thread();
+}
+
+/**
+ * Compute the PoW hashes of headers into vPowHashes across the header check
+ * threads. vfHashed[i] tells whether vPowHashes[i] was filled in: once a
+ * header is found to have too little work the rest of the message is not
+ * hashed, as it would only be rejected anyway.
+ */
+static void ComputeHeaderPowHashes(const std::vector<CBlockHeader>& headers, std::vector<uint256>& vPowHashes, std::vector<char>& vfHashed, const Consensus::Params& consensusParams)
+{
+    vPowHashes.assign(headers.size(), uint256());
+    vfHashed.assign(headers.size(), 0);
+    if (headers.empty())
+        return;
+
+    if (headers.size() == 1 || nScriptCheckThreads == 0) {
+        CHeaderPowCheck check(headers.data(), vPowHashes.data(), vfHashed.data(), headers.size(), consensusParams);
+        check();
+        return;
+    }
+
+    // Small runs keep all threads busy, but GhostRider needs several headers
+    // per run to fill the lanes of HashGRBatch()
+    const size_t nPerCheck = std::max<size_t>(4, std::min<size_t>(HEADER_POW_CHECK_BATCH, headers.size() / nScriptCheckThreads));
+    std::vector<CHeaderPowCheck> vChecks;
+    for (size_t i = 0; i < headers.size(); i += nPerCheck) {
+        const size_t nCount = std::min(nPerCheck, headers.size() - i);
+        vChecks.emplace_back(&headers[i], &vPowHashes[i], &vfHashed[i], nCount, consensusParams);
+    }
+    CCheckQueueControl<CHeaderPowCheck> control(&headerpowcheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
     if (first_invalid != nullptr) first_invalid->SetNull();
+
+    // The expensive part of header validation needs no lock
+    std::vector<uint256> vPowHashes;
+    std::vector<char> vfHashed;
+    ComputeHeaderPowHashes(headers, vPowHashes, vfHashed, chainparams.GetConsensus());
+
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        for (size_t i = 0; i < headers.size(); i++) {
+            const CBlockHeader& header = headers[i];
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!AcceptBlockHeader(header, state, chainparams, &pindex, vfHashed[i] ? &vPowHashes[i] : nullptr)) {
                 if (first_invalid) *first_invalid = header;
                 return false;
             }
@@ -3867,6 +3934,63 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
     return pindexNew;
 }
 
+/**
+ * Rehash every header in the block index across the header check threads and
+ * compare against the stored proof of work hash. Entries must be sorted by
+ * height and have their pprev links in place.
+ */
+static bool VerifyBlockIndexPow(const std::vector<std::pair<int, CBlockIndex*> >& vSortedByHeight, const Consensus::Params& consensusParams)
+{
+    static const size_t nBatchSize = 4096;
+    const int64_t nStart = GetTimeMillis();
+    LogPrintf("Verifying proof of work of %u block index entries\n", vSortedByHeight.size());
+    uiInterface.ShowProgress(_("Verifying block index..."), 0);
+
+    std::vector<const CBlockIndex*> vIndexes;
+    std::vector<CBlockHeader> vHeaders;
+    std::vector<uint256> vPowHashes;
+    std::vector<char> vfHashed;
+    int reportDone = 0;
+    LogPrintf("[0%%]...");
+    for (size_t nPos = 0; nPos < vSortedByHeight.size(); ) {
+        boost::this_thread::interruption_point();
+
+        vIndexes.clear();
+        vHeaders.clear();
+        for (; nPos < vSortedByHeight.size() && vIndexes.size() < nBatchSize; nPos++) {
+            const CBlockIndex* pindex = vSortedByHeight[nPos].second;
+            // The genesis block is hardcoded and never had its proof of work checked
+            if (pindex->pprev == nullptr)
+                continue;
+            vIndexes.push_back(pindex);
+            vHeaders.push_back(pindex->GetBlockHeader());
+        }
+        ComputeHeaderPowHashes(vHeaders, vPowHashes, vfHashed, consensusParams);
+
+        // A failed check stops the remaining ones, but the header that failed was hashed
+        for (size_t i = 0; i < vIndexes.size(); i++) {
+            if (!vfHashed[i])
+                continue;
+            if (vPowHashes[i] != vIndexes[i]->hashPoW || !CheckProofOfWork(vPowHashes[i], vIndexes[i]->nBits, consensusParams)) {
+                uiInterface.ShowProgress("", 100);
+                return error("%s: CheckProofOfWork failed: %s", __func__, vIndexes[i]->ToString());
+            }
+        }
+
+        const int percentageDone = std::max(1, std::min(99, (int)(nPos * 100 / vSortedByHeight.size())));
+        if (reportDone < percentageDone/10) {
+            // report every 10% step
+            LogPrintf("[%d%%]...", percentageDone);
+            reportDone = percentageDone/10;
+        }
+        uiInterface.ShowProgress(_("Verifying block index..."), percentageDone);
+    }
+    LogPrintf("[DONE].\n");
+    LogPrintf("Verified block index proof of work in %dms\n", GetTimeMillis() - nStart);
+    uiInterface.ShowProgress("", 100);
+    return true;
+}
+
 bool static LoadBlockIndexDB(const CChainParams& chainparams)
 {
     if (!pblocktree->LoadBlockIndexGuts(chainparams.GetConsensus(), InsertBlockIndex))
@@ -3921,6 +4045,9 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
             pindexBestHeader = pindex;
     }
 
+    if (fVerifyIndexPow && !VerifyBlockIndexPow(vSortedByHeight, chainparams.GetConsensus()))
+        return false;
+
     // Load block file info
     pblocktree->ReadLastBlockFile(nLastBlockFile);
     vinfoBlockFile.resize(nLastBlockFile + 1);
@@ -3970,17 +4097,15 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadFlag("txindex", fTxIndex);
     LogPrintf("%s: transaction index %s\n", __func__, fTxIndex ? "enabled" : "disabled");
 
-    // Check whether we have an address index
-    pblocktree->ReadFlag("addressindex", fAddressIndex);
-    LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
-
-    // Check whether we have a timestamp index
-    pblocktree->ReadFlag("timestampindex", fTimestampIndex);
-    LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
-
-    // Check whether we have a spent index
-    pblocktree->ReadFlag("spentindex", fSpentIndex);
-    LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
+    // The address, timestamp and spent indexes are built by their own threads
+    // (see index/base.h), which adopt an index earlier versions built inside
+    // ConnectBlock; one that is switched off now would go stale, so forget it
+    for (const auto& index : {std::make_pair("addressindex", fAddressIndex), std::make_pair("timestampindex", fTimestampIndex),
+                              std::make_pair("spentindex", fSpentIndex)}) {
+        bool fLegacy = false;
+        if (!index.second && pblocktree->ReadFlag(index.first, fLegacy) && fLegacy)
+            pblocktree->WriteFlag(index.first, false);
+    }
 
     // Check whether we have a future index
    pblocktree->ReadFlag("futureindex", fFutureIndex);
@@ -4228,6 +4353,7 @@ void UnloadBlockIndex()
     pindexBestHeader = nullptr;
     mempool.clear();
     mapBlocksUnlinked.clear();
+    mapPrevBlockIndex.clear();
     vinfoBlockFile.clear();
     nLastBlockFile = 0;
     nBlockSequenceId = 1;
@@ -4267,18 +4393,6 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         // Use the provided setting for -txindex in the new database
         fTxIndex = gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX);
         pblocktree->WriteFlag("txindex", fTxIndex);
-
-        // Use the provided setting for -addressindex in the new database
-        fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
-        pblocktree->WriteFlag("addressindex", fAddressIndex);
-
-        // Use the provided setting for -timestampindex in the new database
-        fTimestampIndex = gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
-        pblocktree->WriteFlag("timestampindex", fTimestampIndex);
-
-        // Use the provided setting for -spentindex in the new database
-        fSpentIndex = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
-        pblocktree->WriteFlag("spentindex", fSpentIndex);
     }
     return true;
 }
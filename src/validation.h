@@ -34,8 +34,10 @@
 #include <atomic>
 
 class CBlockIndex;
+class CBlockUndo;
 class CBlockTreeDB;
 class CChainParams;
+class CCoinsViewBackgroundWriter;
 class CCoinsViewDB;
 class CInv;
 class CConnman;
@@ -83,6 +85,10 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Most headers one header check thread hashes in one go (see ThreadHeaderPowCheck) */
+static const size_t HEADER_POW_CHECK_BATCH = 32;
+/** Most coins one prefetch thread reads in one go (see ThreadCoinPrefetch) */
+static const size_t COIN_PREFETCH_BATCH = 16;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -133,8 +139,12 @@ static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const unsigned int DEFAULT_BYTES_PER_SIGOP = 20;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
+static const bool DEFAULT_CHECKBLOCKREADPOW = false;
+static const bool DEFAULT_VERIFYINDEXPOW = false;
+static const bool DEFAULT_PREFETCHCOINS = true;
 static const bool DEFAULT_TXINDEX = true;
 static const bool DEFAULT_ADDRESSINDEX = false;
+static const bool DEFAULT_ADDRESSBALANCEINDEX = false;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
 static const bool DEFAULT_SPENTINDEX = false;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
@@ -177,12 +187,20 @@ extern bool fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
 extern bool fAddressIndex;
+/** Keep per-address balance totals next to the address index, so getaddressbalance is a point lookup */
+extern bool fAddressBalanceIndex;
 extern bool fTimestampIndex;
 extern bool fSpentIndex;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern unsigned int nBytesPerSigOp;
 extern bool fCheckBlockIndex;
+/** Rehash the proof of work of every block read from disk instead of trusting the block index */
+extern bool fCheckBlockReadPow;
+/** Rehash all headers in the block index at startup and check them against the stored proof of work */
+extern bool fVerifyIndexPow;
+/** Read the coins a block spends on the prefetch threads before connecting it */
+extern bool fPrefetchCoins;
 extern bool fCheckpointsEnabled;
 extern size_t nCoinCacheUsage;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
@@ -285,6 +303,10 @@ bool LoadChainTip(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the thread that hashes incoming headers ahead of ProcessNewBlockHeaders */
+void ThreadHeaderPowCheck();
+/** Run an instance of the coin prefetch thread */
+void ThreadCoinPrefetch();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
@@ -416,6 +438,7 @@ bool GetAddressIndex(uint160 addressHash, int type,
                      int start = 0, int end = 0);
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value);
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
 
@@ -423,6 +446,8 @@ void InitScriptExecutionCache();
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read the undo data of a block that was connected once; takes cs_main for the position */
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -464,6 +489,9 @@ extern CChain chainActive;
 /** Global variable that points to the coins database (protected by cs_main) */
 extern CCoinsViewDB *pcoinsdbview;
 
+/** Global variable that points to the layer over pcoinsdbview that writes flushes of pcoinsTip in the background, if any */
+extern CCoinsViewBackgroundWriter *pcoinswriter;
+
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
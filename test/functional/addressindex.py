@@ -26,7 +26,8 @@ class AddressIndexTest(BitcoinTestFramework):
         self.start_node(1, ["-addressindex"])
         # Nodes 2/3 are used for testing
         self.start_node(2, ["-addressindex", "-relaypriority=0"])
-        self.start_node(3, ["-addressindex"])
+        # Node 3 answers getaddressbalance from the balance index instead of the address history
+        self.start_node(3, ["-addressindex", "-addressbalanceindex"])
         connect_nodes(self.nodes[0], 1)
         connect_nodes(self.nodes[0], 2)
         connect_nodes(self.nodes[0], 3)
@@ -35,15 +36,18 @@ class AddressIndexTest(BitcoinTestFramework):
         self.sync_all()
 
     def run_test(self):
-        self.log.info("Test that settings can't be changed without -reindex...")
+        self.log.info("Test that the index can be switched off and on without -reindex...")
         self.stop_node(1)
-        self.assert_start_raises_init_error(1, ["-addressindex=0"], 'You need to rebuild the database using -reindex to change -addressindex')
-        self.start_node(1, ["-addressindex=0", "-reindex"])
+        self.start_node(1, ["-addressindex=0"])
         connect_nodes(self.nodes[0], 1)
         self.sync_all()
         self.stop_node(1)
-        self.assert_start_raises_init_error(1, ["-addressindex"], 'You need to rebuild the database using -reindex to change -addressindex')
-        self.start_node(1, ["-addressindex", "-reindex"])
+        self.start_node(1, ["-addressindex"])
+        connect_nodes(self.nodes[0], 1)
+        self.sync_all()
+        self.stop_node(1)
+        self.assert_start_raises_init_error(1, ["-addressindex=0", "-addressbalanceindex"], '-addressbalanceindex requires -addressindex')
+        self.start_node(1, ["-addressindex"])
         connect_nodes(self.nodes[0], 1)
         self.sync_all()
 
@@ -144,6 +148,7 @@ class AddressIndexTest(BitcoinTestFramework):
         self.log.info("Testing balances...")
         balance0 = self.nodes[1].getaddressbalance("93bVhahvUKmQu8gu9g3QnPPa2cxFK98pMB")
         assert_equal(balance0["balance"], 45 * 100000000 + 21)
+        assert_equal(self.nodes[3].getaddressbalance("93bVhahvUKmQu8gu9g3QnPPa2cxFK98pMB"), balance0)
 
         # Check that balances are correct after spending
         self.log.info("Testing balances after spending...")
@@ -166,6 +171,7 @@ class AddressIndexTest(BitcoinTestFramework):
         self.sync_all()
         balance1 = self.nodes[1].getaddressbalance(address2)
         assert_equal(balance1["balance"], amount)
+        assert_equal(self.nodes[3].getaddressbalance(address2), balance1)
 
         tx = CTransaction()
         tx.vin = [CTxIn(COutPoint(int(spending_txid, 16), 0))]
@@ -181,6 +187,9 @@ class AddressIndexTest(BitcoinTestFramework):
 
         balance2 = self.nodes[1].getaddressbalance(address2)
         assert_equal(balance2["balance"], change_amount)
+        assert_equal(self.nodes[3].getaddressbalance(address2), balance2)
+        assert_equal(self.nodes[3].getaddressbalance({"addresses": [address2, "93bVhahvUKmQu8gu9g3QnPPa2cxFK98pMB"]}),
+                     self.nodes[1].getaddressbalance({"addresses": [address2, "93bVhahvUKmQu8gu9g3QnPPa2cxFK98pMB"]}))
 
         # Check that deltas are returned correctly
         deltas = self.nodes[1].getaddressdeltas({"addresses": [address2], "start": 0, "end": 200})
@@ -220,6 +229,7 @@ class AddressIndexTest(BitcoinTestFramework):
 
         balance4 = self.nodes[1].getaddressbalance(address2)
         assert_equal(balance4, balance1)
+        assert_equal(self.nodes[3].getaddressbalance(address2), balance1)
 
         utxos2 = self.nodes[1].getaddressutxos({"addresses": [address2]})
         assert_equal(len(utxos2), 1)
@@ -240,6 +250,23 @@ class AddressIndexTest(BitcoinTestFramework):
         assert_equal(utxos3[1]["height"], 264)
         assert_equal(utxos3[2]["height"], 265)
 
+        # Check that an index switched on for a node with a chain is built while it runs
+        self.log.info("Testing building the index on a running node...")
+        self.stop_node(1)
+        self.start_node(1, ["-addressindex=0"])
+        connect_nodes(self.nodes[0], 1)
+        self.nodes[2].sendtoaddress(address2, 25)
+        self.nodes[2].generate(1)
+        self.sync_all()
+        self.stop_node(1)
+        self.start_node(1, ["-addressindex", "-addressbalanceindex"])
+        connect_nodes(self.nodes[0], 1)
+        self.sync_all()
+        assert_equal(self.nodes[1].getaddressbalance(address2), self.nodes[3].getaddressbalance(address2))
+        assert_equal(self.nodes[1].getaddressutxos({"addresses": [address2]}), self.nodes[3].getaddressutxos({"addresses": [address2]}))
+        wait_until(lambda: self.nodes[1].getindexinfo()["addressindex"]["synced"], timeout=10)
+        assert_equal(self.nodes[1].getindexinfo()["addressindex"]["best_block_height"], self.nodes[1].getblockcount())
+
         # Check mempool indexing
         self.log.info("Testing mempool indexing...")
 
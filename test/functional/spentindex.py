@@ -35,15 +35,13 @@ class SpentIndexTest(BitcoinTestFramework):
         self.sync_all()
 
     def run_test(self):
-        self.log.info("Test that settings can't be changed without -reindex...")
+        self.log.info("Test that the index can be switched off and on without -reindex...")
         self.stop_node(1)
-        self.assert_start_raises_init_error(1, ["-spentindex=0"], 'You need to rebuild the database using -reindex to change -spentindex')
-        self.start_node(1, ["-spentindex=0", "-reindex"])
+        self.start_node(1, ["-spentindex=0"])
         connect_nodes(self.nodes[0], 1)
         self.sync_all()
         self.stop_node(1)
-        self.assert_start_raises_init_error(1, ["-spentindex"], 'You need to rebuild the database using -reindex to change -spentindex')
-        self.start_node(1, ["-spentindex", "-reindex"])
+        self.start_node(1, ["-spentindex"])
         connect_nodes(self.nodes[0], 1)
         self.sync_all()
 
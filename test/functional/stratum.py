@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The But developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the Stratum v1 mining server (-stratumbind).
+
+A minimal Stratum client subscribes and authorizes, builds the coinbase and
+header of the pushed job, grinds a SHA256d nonce and submits it. The block
+must be accepted and a fresh job pushed for the new tip.
+"""
+
+import json
+import socket
+import struct
+
+from test_framework.mininode import sha256
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+
+def sha256d(data):
+    return sha256(sha256(data))
+
+def bits_to_target(nbits):
+    return (nbits & 0xffffff) << (8 * ((nbits >> 24) - 3))
+
+class StratumClient(object):
+    def __init__(self, port):
+        self.sock = socket.create_connection(("127.0.0.1", port), timeout=30)
+        self.buf = b""
+        self.next_id = 1
+        self.notifications = []
+
+    def close(self):
+        self.sock.close()
+
+    def readline(self):
+        while b"\n" not in self.buf:
+            data = self.sock.recv(4096)
+            assert data, "stratum connection closed"
+            self.buf += data
+        line, self.buf = self.buf.split(b"\n", 1)
+        return json.loads(line.decode())
+
+    def request(self, method, params):
+        msg_id = self.next_id
+        self.next_id += 1
+        self.sock.sendall((json.dumps({"id": msg_id, "method": method, "params": params}) + "\n").encode())
+        while True:
+            msg = self.readline()
+            if msg.get("id") == msg_id:
+                return msg
+            self.notifications.append(msg)
+
+    def wait_for_notify(self):
+        while True:
+            msg = self.notifications.pop(0) if self.notifications else self.readline()
+            if msg.get("method") == "mining.notify":
+                return msg["params"]
+
+class StratumTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(1)  # leave initial block download
+        address = node.getnewaddress()
+        port = rpc_port(MAX_NODES)
+
+        self.log.info("Starting without -stratumaddress should fail")
+        self.stop_node(0)
+        self.assert_start_raises_init_error(0, ["-stratumbind=127.0.0.1:%d" % port], "Unable to start Stratum server")
+
+        self.start_node(0, ["-algo=sha256d", "-stratumbind=127.0.0.1:%d" % port, "-stratumaddress=%s" % address])
+        node = self.nodes[0]
+        client = StratumClient(port)
+
+        self.log.info("Subscribe and authorize")
+        assert_equal(client.request("mining.authorize", ["worker", "x"])["error"][0], 25)
+        result = client.request("mining.subscribe", ["test"])["result"]
+        extranonce1 = hex_str_to_bytes(result[1])
+        assert_equal(result[2], 4)
+        assert_equal(client.request("mining.authorize", ["worker", "x"])["result"], True)
+        job = client.wait_for_notify()
+        assert_equal(job[8], True)
+
+        self.log.info("Unknown jobs are rejected")
+        assert_equal(client.request("mining.submit", ["worker", "nojob", "00000000", job[7], "00000000"])["error"][0], 21)
+
+        self.log.info("Mine a block from the pushed job")
+        job_id, prevhash, coinb1, coinb2, branch, version, nbits, ntime = job[:8]
+        extranonce2 = b"\x00\x00\x00\x01"
+        coinbase = hex_str_to_bytes(coinb1) + extranonce1 + extranonce2 + hex_str_to_bytes(coinb2)
+        merkle_root = sha256d(coinbase)
+        for h in branch:
+            merkle_root = sha256d(merkle_root + hex_str_to_bytes(h))
+        prev = hex_str_to_bytes(prevhash)
+        prev = b"".join(prev[i:i + 4][::-1] for i in range(0, 32, 4))
+        target = bits_to_target(int(nbits, 16))
+        header = struct.pack("<I", int(version, 16)) + prev + merkle_root + struct.pack("<II", int(ntime, 16), int(nbits, 16))
+        nonce = 0
+        while int.from_bytes(sha256d(header + struct.pack("<I", nonce)), "little") > target:
+            nonce += 1
+
+        height = node.getblockcount()
+        params = ["worker", job_id, bytes_to_hex_str(extranonce2), ntime, "%08x" % nonce]
+        assert_equal(client.request("mining.submit", params)["result"], True)
+        wait_until(lambda: node.getblockcount() == height + 1)
+        block = node.getblock(node.getbestblockhash())
+        assert_equal(node.gettransaction(block["tx"][0])["details"][0]["address"], address)
+
+        self.log.info("A new tip pushes a clean job")
+        job = client.wait_for_notify()
+        assert_equal(job[8], True)
+        assert job[0] != job_id
+
+        self.log.info("Shares for jobs of an old tip are rejected")
+        assert_equal(client.request("mining.submit", params)["error"][0], 21)
+        client.close()
+
+if __name__ == '__main__':
+    StratumTest().main()
@@ -124,6 +124,7 @@ BASE_SCRIPTS= [
     'nulldummy.py',
     'import-rescan.py',
     'mining.py',
+    'stratum.py',
     'rpcnamedargs.py',
     'listsinceblock.py',
     'p2p-leaktests.py',